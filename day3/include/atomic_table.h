@@ -0,0 +1,132 @@
+#ifndef ATOMIC_TABLE_H
+#define ATOMIC_TABLE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <mutex>
+
+// ============================================
+// 以锁地址为键的定长开放寻址表
+// 查找完全无锁（热路径使用），插入/删除由内部互斥锁串行化（配置接口、慢路径使用）。
+// 键 0 表示空槽，键 1 表示已删除（锁地址至少按 4 字节对齐，不会与之冲突）。
+// 查找最多探测 max_probe_ + 1 个槽位（max_probe_ 是插入时出现过的最大探测距离），
+// 删除留下的墓碑再多也不会让未命中的查找扫完整张表；
+// 删除时紧挨空槽的墓碑链直接还原为空槽。
+// ============================================
+template <size_t Capacity>
+class AtomicAddrTable {
+public:
+    static const uint64_t kEmpty = 0;
+    static const uint64_t kTombstone = 1;
+
+    AtomicAddrTable() : max_probe_(0), size_(0) {
+        static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+        for (size_t i = 0; i < Capacity; i++) {
+            keys_[i].store(kEmpty, std::memory_order_relaxed);
+            values_[i].store(0, std::memory_order_relaxed);
+        }
+    }
+
+    // 无锁查找，返回槽位下标；不存在时返回 -1
+    long find(uint64_t key) const {
+        size_t h = hash(key);
+        size_t probes = max_probe_.load(std::memory_order_acquire) + 1;
+        for (size_t i = 0; i < probes; i++) {
+            size_t idx = (h + i) & (Capacity - 1);
+            uint64_t k = keys_[idx].load(std::memory_order_acquire);
+            if (k == key) {
+                return static_cast<long>(idx);
+            }
+            if (k == kEmpty) {
+                return -1;
+            }
+        }
+        return -1;
+    }
+
+    // 查找值，不存在时返回 default_value
+    uint64_t get(uint64_t key, uint64_t default_value = 0) const {
+        long idx = find(key);
+        return idx < 0 ? default_value : values_[idx].load(std::memory_order_relaxed);
+    }
+
+    // 插入或更新；表满时返回 false
+    bool put(uint64_t key, uint64_t value) {
+        std::lock_guard<std::mutex> guard(mutex_);
+        long idx = find(key);
+        if (idx >= 0) {
+            values_[idx].store(value, std::memory_order_relaxed);
+            return true;
+        }
+        size_t h = hash(key);
+        for (size_t i = 0; i < Capacity; i++) {
+            size_t slot = (h + i) & (Capacity - 1);
+            uint64_t k = keys_[slot].load(std::memory_order_relaxed);
+            if (k == kEmpty || k == kTombstone) {
+                // 先放宽探测上限、写值，再发布键：无锁读者看到键时一定能找到它、看到值
+                if (i > max_probe_.load(std::memory_order_relaxed)) {
+                    max_probe_.store(i, std::memory_order_release);
+                }
+                values_[slot].store(value, std::memory_order_relaxed);
+                keys_[slot].store(key, std::memory_order_release);
+                size_++;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // 删除；返回是否存在
+    bool erase(uint64_t key) {
+        std::lock_guard<std::mutex> guard(mutex_);
+        long idx = find(key);
+        if (idx < 0) {
+            return false;
+        }
+        values_[idx].store(0, std::memory_order_relaxed);
+        size_t next = (static_cast<size_t>(idx) + 1) & (Capacity - 1);
+        if (keys_[next].load(std::memory_order_relaxed) != kEmpty) {
+            keys_[idx].store(kTombstone, std::memory_order_release);
+        } else {
+            // 后面是空槽：没有探测链经过这里，连同前面相邻的墓碑一起还原为空槽
+            size_t slot = static_cast<size_t>(idx);
+            keys_[slot].store(kEmpty, std::memory_order_release);
+            for (size_t i = 1; i < Capacity; i++) {
+                slot = (slot + Capacity - 1) & (Capacity - 1);
+                if (keys_[slot].load(std::memory_order_relaxed) != kTombstone) {
+                    break;
+                }
+                keys_[slot].store(kEmpty, std::memory_order_release);
+            }
+        }
+        size_--;
+        return true;
+    }
+
+    // 直接访问槽位中的值（配合 find 使用，可做原子累加等）
+    std::atomic<uint64_t>& value_at(long idx) { return values_[idx]; }
+
+    size_t size() const {
+        std::lock_guard<std::mutex> guard(mutex_);
+        return size_;
+    }
+
+    static size_t capacity() { return Capacity; }
+
+private:
+    static size_t hash(uint64_t key) {
+        key ^= key >> 33;
+        key *= 0xff51afd7ed558ccdull;
+        key ^= key >> 33;
+        return static_cast<size_t>(key);
+    }
+
+    std::atomic<uint64_t> keys_[Capacity];
+    std::atomic<uint64_t> values_[Capacity];
+    std::atomic<size_t> max_probe_;       // 已插入键的最大探测距离（只增不减）
+    size_t size_;
+    mutable std::mutex mutex_;
+};
+
+#endif // ATOMIC_TABLE_H
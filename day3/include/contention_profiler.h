@@ -0,0 +1,178 @@
+#ifndef CONTENTION_PROFILER_H
+#define CONTENTION_PROFILER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <list>
+#include <map>
+#include <mutex>
+#include <vector>
+#include "thread_registry.h"
+#include "heavy_hitters.h"
+
+class ReportWriter;
+
+// ============================================
+// 对数分桶直方图（HDR 风格）
+// 每个 2 的幂区间再分 4 个子桶，相对误差不超过 25%，覆盖 0 ~ 2^37 ns（约 137 秒）
+// ============================================
+struct LatencyHistogram {
+    static const size_t kSubBuckets = 4;
+    static const size_t kBuckets = 148;
+
+    uint64_t counts[kBuckets];
+
+    LatencyHistogram() { clear(); }
+    void clear();
+
+    static size_t bucket_of(uint64_t value_ns) {
+        if (value_ns < kSubBuckets) {
+            return static_cast<size_t>(value_ns);
+        }
+        int msb = 63 - __builtin_clzll(value_ns);
+        size_t bucket = static_cast<size_t>(msb - 1) * kSubBuckets +
+                        static_cast<size_t>((value_ns >> (msb - 2)) & (kSubBuckets - 1));
+        return bucket < kBuckets ? bucket : kBuckets - 1;
+    }
+
+    // 桶的下界（纳秒）
+    static uint64_t bucket_lower(size_t bucket) {
+        if (bucket < kSubBuckets) {
+            return bucket;
+        }
+        size_t msb = bucket / kSubBuckets + 1;
+        return static_cast<uint64_t>(kSubBuckets + bucket % kSubBuckets) << (msb - 2);
+    }
+
+    uint64_t total() const;
+    void merge(const LatencyHistogram& other);
+    // 百分位数（0~100），返回所在桶的下界
+    uint64_t percentile(double p) const;
+};
+
+// ============================================
+// 单把锁（或单个锁类别）的合并统计
+// ============================================
+struct LockContentionStats {
+    uint64_t key;              // 锁地址；by_class 时为类别 ID
+    bool is_class;
+    uint64_t acquisitions;     // 获取次数
+    uint64_t contended;        // 发生竞争（等待超过阈值）的获取次数
+    uint64_t wait_total_ns;
+    uint64_t hold_total_ns;
+    uint64_t max_wait_ns;
+    uint64_t max_hold_ns;
+    LatencyHistogram wait_hist;
+    LatencyHistogram hold_hist;
+
+    LockContentionStats()
+        : key(0), is_class(false), acquisitions(0), contended(0),
+          wait_total_ns(0), hold_total_ns(0), max_wait_ns(0), max_hold_ns(0) {}
+
+    // 累加另一份统计（键不变）
+    void merge(const LockContentionStats& other);
+};
+
+// ============================================
+// 锁竞争剖析器
+// on_lock_before 与 on_lock_after 之间正好是真实 pthread_mutex_lock 的等待时间。
+// 计数器按线程分片：每个线程只写自己的分片（单写者，relaxed 存储，无 RMW），
+// 读取时才把所有分片合并。
+// ============================================
+class ContentionProfiler {
+public:
+    static const size_t kShardEntries = 64;   // 每线程可跟踪的不同锁数量（2 的幂）
+    // 已退出线程的汇总最多单独保留的锁数（每条约 2.4 KB，上限约 2.5 MB）；
+    // 超出时最久没有线程退出并入的锁被合并进"其他锁"（地址 0，与分片的 overflow 相同）
+    static const size_t kMaxRetiredLocks = 1024;
+
+    ContentionProfiler();
+    ~ContentionProfiler();
+
+    void set_enabled(bool enabled) { enabled_.store(enabled); }
+    bool enabled() const { return enabled_.load(std::memory_order_relaxed); }
+
+    // 等待超过该值才算一次"竞争"（默认 1 微秒，无竞争的加锁通常只需几十纳秒）
+    void set_contention_threshold_ns(uint64_t ns) { contention_threshold_ns_.store(ns); }
+    uint64_t contention_threshold_ns() const { return contention_threshold_ns_.load(std::memory_order_relaxed); }
+
+    // 锁类别映射（由调用方提供，返回 0 表示未分类，否则为 类别ID + 1）
+    typedef uint64_t (*ClassLookup)(uint64_t lock_addr);
+
+    // ---------- 热路径（所属线程调用） ----------
+    void record_acquire(const ThreadSlot& slot, uint64_t lock_addr, uint64_t wait_ns,
+                        const char* site = nullptr);
+    void record_release(const ThreadSlot& slot, uint64_t lock_addr, uint64_t hold_ns);
+
+    // ---------- 读取（合并所有分片） ----------
+    std::vector<LockContentionStats> snapshot(ClassLookup by_class = nullptr) const;
+    // 按竞争次数（其次总等待时间）排序的前 n 把锁
+    std::vector<LockContentionStats> top_contended(size_t n, ClassLookup by_class = nullptr) const;
+    // 把前 n 把锁格式化成报告
+    void dump(ReportWriter& out, size_t n, ClassLookup by_class = nullptr) const;
+
+    // ---------- 重点锁（Space-Saving，固定内存） ----------
+    // 每线程分片只能跟踪 kShardEntries 把锁；进程里有上百万把锁时，
+    // 由竞争路径驱动的 Top-K 在固定内存内给出竞争最多的锁和调用位置（带误差上界）
+    std::vector<SpaceSaving::Item> heavy_hitter_locks(size_t n) const { return hot_locks_.top(n); }
+    // key 为调用位置字符串（const char*）的地址
+    std::vector<SpaceSaving::Item> heavy_hitter_sites(size_t n) const { return hot_sites_.top(n); }
+
+    // 线程退出时把其分片并入"已退出线程"汇总并清空，供序号复用
+    void retire_shard(uint32_t ordinal);
+
+    // 锁被销毁：丢弃它在各分片和汇总中的统计，槽位留作墓碑供之后的锁复用
+    // （锁已销毁，不会再有线程记录它；Top-K 本身是固定内存，不做清理）
+    void forget_lock(uint64_t lock_addr);
+
+private:
+    ContentionProfiler(const ContentionProfiler&) = delete;
+    ContentionProfiler& operator=(const ContentionProfiler&) = delete;
+
+    static const uint64_t kTombstone = 1;    // 已销毁的锁留下的槽位（锁地址不会是 1）
+
+    struct ShardEntry {
+        std::atomic<uint64_t> lock_addr;      // 0 表示空槽，kTombstone 表示可复用
+        std::atomic<uint64_t> acquisitions;
+        std::atomic<uint64_t> contended;
+        std::atomic<uint64_t> wait_total_ns;
+        std::atomic<uint64_t> hold_total_ns;
+        std::atomic<uint64_t> max_wait_ns;
+        std::atomic<uint64_t> max_hold_ns;
+        std::atomic<uint32_t> wait_hist[LatencyHistogram::kBuckets];
+        std::atomic<uint32_t> hold_hist[LatencyHistogram::kBuckets];
+    };
+
+    struct Shard {
+        ShardEntry entries[kShardEntries];
+        ShardEntry overflow;                  // 表满后其余锁的汇总
+        Shard();
+    };
+
+    Shard* shard_for(const ThreadSlot& slot);
+    ShardEntry* entry_for(Shard* shard, uint64_t lock_addr);
+    static void merge_entry(const ShardEntry& entry, LockContentionStats& stats);
+    static void reset_entry(ShardEntry& entry, uint64_t key = 0);   // 先清零计数，最后写键
+    // 已退出线程汇总中某把锁的条目（调用方持有 mutex_retired_），必要时淘汰最久未用的锁
+    LockContentionStats& retired_for(uint64_t lock_addr);
+
+    std::atomic<bool> enabled_;
+    std::atomic<uint64_t> contention_threshold_ns_;
+    std::atomic<Shard*> shards_[kMaxThreadSlots];
+    std::atomic<uint32_t> shard_limit_;      // 已分配分片的最大线程序号 + 1（序号是稠密的）
+    SpaceSaving hot_locks_;    // 竞争次数最多的锁
+    SpaceSaving hot_sites_;    // 竞争次数最多的加锁位置
+
+    struct RetiredEntry {
+        LockContentionStats stats;
+        std::list<uint64_t>::iterator lru;
+    };
+
+    mutable std::mutex mutex_retired_;
+    std::map<uint64_t, RetiredEntry> retired_;   // 已退出线程的累计统计（按锁地址，最多 kMaxRetiredLocks 条）
+    std::list<uint64_t> retired_lru_;            // 最近并入的锁在前
+    LockContentionStats retired_other_;          // 被淘汰的锁和各分片 overflow 的汇总
+};
+
+#endif // CONTENTION_PROFILER_H
@@ -2,20 +2,85 @@
 #define DEADLOCK_DETECTOR_H
 
 #include <pthread.h>
+#include <semaphore.h>
 #include <stdint.h>
 #include <map>
 #include <string>
 #include <mutex>
 #include <thread>      // 新增：C++11 线程
 #include <atomic>      // 新增：原子变量
+#include <condition_variable>
 #include <sys/syscall.h>
 #include <unistd.h>
 #include "graph.h"
+#include "report_sink.h"
+#include "lock_clock.h"
+#include "thread_registry.h"
+#include "hold_time.h"
+#include "contention_profiler.h"
+#include "detector_stats.h"
+#include "self_profile.h"
+#include "stats_segment.h"
+#include "trace_recorder.h"
+#include "reader_set.h"
+#include "thread_waits.h"
+#include "resource_tracker.h"
 
 inline uint64_t get_thread_id() {
     return static_cast<uint64_t>(syscall(SYS_gettid));
 }
 
+// ============================================
+// 线程等待记录：等待哪把锁、从什么时候开始等
+// ============================================
+struct WaitRecord {
+    uint64_t lock_addr;   // 正在等待的锁
+    uint64_t since_ns;    // 开始等待的时间（coarse_now_ns，纳秒）
+    bool shared;          // 等待读锁（只与写者互斥）
+    const std::atomic<uint64_t>* inline_owner;  // TrackedMutex 等：持有者记录在锁对象内
+    uint64_t spin_cpu_ns; // 自旋锁：登记等待时本线程的 CPU 时间，0 表示不是自旋等待
+
+    WaitRecord() : lock_addr(0), since_ns(0), shared(false), inline_owner(nullptr), spin_cpu_ns(0) {}
+    WaitRecord(uint64_t lock, uint64_t since, bool is_shared = false)
+        : lock_addr(lock), since_ns(since), shared(is_shared), inline_owner(nullptr), spin_cpu_ns(0) {}
+};
+
+// ============================================
+// 条件变量等待记录：在哪个条件变量上睡眠、关联的互斥锁、从什么时候开始
+// 睡眠期间互斥锁已释放，不进入等待图，只供看门狗报告
+// ============================================
+struct CondWaitRecord {
+    uint64_t cond_addr;
+    uint64_t mutex_addr;
+    uint64_t since_ns;    // coarse_now_ns
+    const char* site;
+
+    CondWaitRecord() : cond_addr(0), mutex_addr(0), since_ns(0), site(nullptr) {}
+    CondWaitRecord(uint64_t cond, uint64_t mutex, uint64_t since, const char* where)
+        : cond_addr(cond), mutex_addr(mutex), since_ns(since), site(where) {}
+};
+
+// 读写锁 → 当前读者（写者仍记录在 lock_owners_ 中）
+typedef std::map<uint64_t, ReaderSet> ReaderMap;
+
+// ============================================
+// 自适应检测间隔配置
+// 空闲时指数退避到 max_interval_ms，长等待堆积时收紧到 min_interval_ms，
+// 同时保证检测线程的 CPU 占用不超过 cpu_budget（占单核的比例）
+// ============================================
+struct AdaptiveIntervalConfig {
+    int min_interval_ms;   // 间隔下限
+    int max_interval_ms;   // 间隔上限
+    int long_wait_ms;      // 等待超过该时长视为"长等待"
+    double cpu_budget;     // 例如 0.005 表示最多占用单核的 0.5%
+
+    AdaptiveIntervalConfig()
+        : min_interval_ms(50),
+          max_interval_ms(5000),
+          long_wait_ms(200),
+          cpu_budget(0.005) {}
+};
+
 // ============================================
 // 死锁检测器（新增后台检测能力）
 // ============================================
@@ -26,10 +91,58 @@ public:
         return detector;
     }
 
-    // 钩子函数（保持不变）
-    void on_lock_before(uint64_t thread_id, uint64_t lock_addr);
-    void on_lock_after(uint64_t thread_id, uint64_t lock_addr);
+    // 钩子函数（site 为调用位置 "file:line"，由宏传入；shared 表示读写锁的读锁）
+    void on_lock_before(uint64_t thread_id, uint64_t lock_addr, const char* site = nullptr, bool shared = false);
+    void on_lock_after(uint64_t thread_id, uint64_t lock_addr, const char* site = nullptr, bool shared = false);
     void on_unlock_after(uint64_t thread_id, uint64_t lock_addr);
+    
+    // pthread 互斥锁加锁前：本线程已持有该锁时（O(1) 查本线程持有栈）按锁类型处理——
+    // 递归锁重入不会阻塞，不登记等待；检错锁会返回 EDEADLK；普通锁立即报告自死锁。
+    // timed 为 true（timedlock）时普通锁重入只会超时，不是死锁：只给出警告，也不登记等待
+    void on_mutex_lock_before(uint64_t thread_id, pthread_mutex_t* mutex, const char* site, bool timed = false);
+    
+    // pthread_mutex_init / destroy：每次初始化分配新的代号，地址被复用时据此区分前后两把锁；
+    // 销毁时清除该地址的全部状态（持有记录、预算 / 类别、竞争统计），检测器内存只随存活的锁增长
+    void on_mutex_init(uint64_t lock_addr, const char* site);
+    void on_mutex_destroy(uint64_t thread_id, uint64_t lock_addr, const char* site);
+    
+    // 锁的代号，0 表示未经 pthread_mutex_init 初始化（静态初始化器）或已销毁
+    uint64_t lock_generation(uint64_t lock_addr);
+    
+    // trylock 失败或 timedlock 超时：waited 为 true 时撤回 on_lock_before 登记的等待
+    void on_lock_failed(uint64_t thread_id, uint64_t lock_addr, const char* site, bool waited);
+    
+    // 条件变量等待：开始前登记条件等待，调用者确实持有互斥锁时释放其持有记录并返回 true；
+    // 结束时撤销条件等待，reacquired 为 true（成功或超时，已重新持有互斥锁）时才恢复持有记录
+    bool on_cond_wait_begin(uint64_t thread_id, uint64_t cond_addr, uint64_t mutex_addr, const char* site);
+    void on_cond_wait_end(uint64_t thread_id, uint64_t cond_addr, uint64_t mutex_addr, const char* site,
+                          bool reacquired);
+    
+    // 持有者内联在锁对象中的锁（见 tracked_mutex.h）：只有阻塞时才登记等待，
+    // owner 指向锁对象里的持有者字段，检测时直接读取，不维护 lock_owners_
+    void on_tracked_wait(uint64_t thread_id, uint64_t lock_addr, const std::atomic<uint64_t>* owner,
+                         const char* site = nullptr);
+    void on_tracked_acquired(uint64_t thread_id, uint64_t lock_addr, const char* site, bool waited);
+    void on_tracked_released(uint64_t thread_id, uint64_t lock_addr);
+
+    // 自旋锁：获取 / 释放只在本线程槽位记录持有（一次写入），不进入检测器的互斥锁；
+    // 连续 spin_wait_threshold() 次 trylock 失败后才登记等待，持有者在检测时扫描槽位得到
+    void on_spin_acquired(uint64_t lock_addr, const char* site);
+    void on_spin_released(uint64_t lock_addr);
+    void on_spin_wait_begin(uint64_t thread_id, uint64_t lock_addr, const char* site);
+    void on_spin_wait_end(uint64_t thread_id, uint64_t lock_addr);
+    
+    void set_spin_wait_threshold(uint32_t spins) { spin_wait_threshold_.store(spins); }
+    uint32_t spin_wait_threshold() const { return spin_wait_threshold_.load(std::memory_order_relaxed); }
+    
+    // pthread_join：等待期间在等待图中加入 等待者 → 目标线程 的边
+    void on_join_begin(uint64_t thread_id, pthread_t target, const char* site);
+    void on_join_end(uint64_t thread_id);
+
+    // 同步事件钩子（sync_kind 为 TraceSyncKind）：只在追踪开启时写入追踪文件，
+    // 供 ddtrace predict 判断 happens-before，排除不可能交错的锁序环
+    void on_sync_release(uint64_t object, uint16_t sync_kind, const char* site = nullptr);
+    void on_sync_acquire(uint64_t object, uint16_t sync_kind, const char* site = nullptr);
 
     // 检测接口（保持不变）
     bool check_deadlock();
@@ -49,25 +162,179 @@ public:
     // 查询检测线程是否正在运行
     bool is_running() const { return running_.load(); }
     
-    // 设置检测间隔（秒）
-    void set_interval(int seconds) { interval_seconds_ = seconds; }
+    // 设置检测间隔（秒），切换回固定间隔模式
+    void set_interval(int seconds) {
+        interval_seconds_ = seconds;
+        adaptive_.store(false);
+    }
+
+    // 启用自适应检测间隔（下一次检测起生效）
+    void set_adaptive(const AdaptiveIntervalConfig& config);
+
+    // 当前使用的检测间隔（毫秒）
+    int current_interval_ms() const { return current_interval_ms_.load(); }
+
+    // ========================================
+    // 宿主事件循环集成（不创建检测线程）
+    // 用法：把 event_fd() 加入宿主的 epoll，可读时调用 poll_once()。
+    // 不要与 start() 同时使用。
+    // ========================================
+    
+    // 返回按检测间隔周期触发的 timerfd（首次调用时创建）
+    int event_fd();
+    
+    // 关闭 timerfd 并丢弃进行中的分片扫描
+    void close_event_fd();
+    
+    // 非阻塞地推进一轮扫描：快照、建图、判环、看门狗各自占用单独的调用，
+    // 建图每次最多处理 max_waiters 个等待线程。max_waiters 只约束建图分片，
+    // 快照拷贝、判环（O(V + E)）和看门狗报告的开销不受它限制。返回 true 表示本次发现死锁。
+    bool poll_once(size_t max_waiters = 256);
+    
+    // 是否有未完成的分片扫描（为 true 时宿主应尽快再次调用 poll_once，
+    // 例如把下一次 epoll_wait 的超时设为 0）
+    bool poll_pending() const { return poll_phase_ != POLL_IDLE; }
+
+    // ========================================
+    // 长等待 / 饥饿看门狗
+    // 不构成环的长时间等待（例如持有者卡在 I/O 上）同样会被报告：
+    // 打印从等待者到根持有者的完整等待链，以及根持有者当前在做什么
+    // ========================================
+    
+    // 等待超过 budget_ms 毫秒即报告，0 表示关闭（默认关闭）
+    void set_wait_budget_ms(int budget_ms) { wait_budget_ms_.store(budget_ms); }
+
+    // ========================================
+    // 持锁时长预算
+    // 配置任意预算后，钩子记录获取时间；解锁时超预算的记录写入环形缓冲，
+    // 检测线程同时报告仍在持有且已超预算的锁
+    // ========================================
+    HoldTimeTracker& hold_time() { return hold_time_; }
+
+    // ========================================
+    // 锁竞争剖析
+    // 启用后统计每把锁的获取次数、竞争次数和等待/持有时长直方图；
+    // 锁类别沿用 hold_time().set_lock_class() 的设置
+    // ========================================
+    ContentionProfiler& profiler() { return profiler_; }
+    
+    // 竞争最严重的 n 把锁（by_class 为 true 时按锁类别合并）
+    std::vector<LockContentionStats> top_contended(size_t n, bool by_class = false);
+    
+    // 检测线程每隔 interval_ms 输出一次前 10 名，0 表示关闭
+    void set_profile_dump_interval_ms(int interval_ms) { profile_dump_interval_ms_.store(interval_ms); }
+
+    // ========================================
+    // 统计：钩子调用次数、检测耗时、快照规模、检测结果（按需汇总各分片）
+    // ========================================
+    DetectorStats stats() const;
+
+    // ========================================
+    // 检测器自身剖析：每轮检测的分阶段耗时、内部互斥锁持有时间、
+    // 图规模和快照拷贝量，最近 256 轮的 p50/p99/max
+    // ========================================
+    SelfProfileSummary self_profile() const { return self_profile_.summary(); }
+    
+    // 每 passes 轮输出一行汇总日志，0 表示关闭
+    void set_self_profile_log_every(int passes) { self_profile_log_every_.store(passes); }
+
+    // ========================================
+    // 共享内存统计段
+    // 每轮检测后把计数器、等待边、最久的等待和最近的死锁发布到命名共享内存，
+    // 供 ddstat 在另一个进程中只读查看（见 stats_segment.h）
+    // ========================================
+    
+    // 创建并开始发布，name 为空时使用 "/deadlock_detector.<pid>"；失败返回 false
+    bool publish_stats(const std::string& name = std::string());
+    
+    // 停止发布并删除段
+    void unpublish_stats();
+    
+    // 当前段名（未发布时为空）
+    std::string stats_segment_name();
+
+    // ========================================
+    // 锁事件追踪（飞行记录仪）
+    // trace().open(config) 后钩子把事件写入每线程环形文件，进程崩溃后仍可离线读取
+    // ========================================
+    TraceRecorder& trace() { return trace_; }
+
+    // ========================================
+    // 线程 → 线程 等待（pthread_join、线程池任务依赖）
+    // 线程池在工作线程 / 任务的生命周期处调用 thread_waits() 的接口，
+    // 这些边与锁等待边一起进入等待图（见 thread_waits.h）
+    // ========================================
+    ThreadWaitTracker& thread_waits() { return thread_waits_; }
+
+    // ========================================
+    // 多单位资源（信号量、计数资源池、屏障）
+    // 信号量和屏障由宏自动登记；自定义资源池通过 resources() 的 define / acquire / release 接入。
+    // 存在这类等待时检测改用资源分配图归约（见 graph.h）
+    // ========================================
+    ResourceTracker& resources() { return resources_; }
 
 private:
     DeadlockDetector() 
-        : running_(false), 
+        : reentered_locks_(0),
+          next_generation_(0),
+          live_mutex_count_(0),
+          running_(false), 
           interval_seconds_(1),
-          deadlock_detected_(false) {}
+          deadlock_detected_(false),
+          adaptive_(false),
+          current_interval_ms_(1000),
+          scan_cpu_ns_avg_(0),
+          last_wait_count_(0),
+          last_long_wait_count_(0),
+          last_oldest_wait_ns_(0),
+          timer_fd_(-1),
+          timer_armed_ms_(0),
+          poll_phase_(POLL_IDLE),
+          poll_long_wait_count_(0),
+          poll_oldest_wait_ns_(0),
+          poll_cpu_ns_(0),
+          wait_budget_ms_(0),
+          spin_wait_threshold_(1000),
+          profile_dump_interval_ms_(0),
+          last_profile_dump_ns_(0),
+          last_scan_ns_(0),
+          max_scan_ns_(0),
+          snapshot_owners_(0),
+          snapshot_waiters_(0),
+          max_snapshot_waiters_(0),
+          graph_nodes_(0),
+          self_profile_log_every_(0) {
+        // 先构造报告器，保证它比检测器晚析构（析构时 stop() 仍需输出）
+        AsyncReporter::instance();
+        ThreadRegistry::instance().set_exit_hook(&DeadlockDetector::thread_exit_hook);
+    }
     
     ~DeadlockDetector() {
+        ThreadRegistry::instance().set_exit_hook(nullptr);
         stop(); // 确保析构时停止检测线程
+        close_event_fd();
+        unpublish_stats();
     }
     
     DeadlockDetector(const DeadlockDetector&) = delete;
     DeadlockDetector& operator=(const DeadlockDetector&) = delete;
 
-    // 核心数据结构（保持不变）
+    // 核心数据结构
     std::map<uint64_t, uint64_t> lock_owners_;
-    std::map<uint64_t, uint64_t> thread_waiting_;
+    std::map<uint64_t, uint32_t> lock_recursion_;   // 递归锁的重入深度（不含第一次获取），与 lock_owners_ 共用锁
+    std::atomic<size_t> reentered_locks_;           // lock_recursion_ 的条目数，为 0 时解锁不必查表
+    ReaderMap rwlock_readers_;                  // 与 lock_owners_ 共用 mutex_lock_owners_
+    
+    // 存活的互斥锁（经 pthread_mutex_init 初始化、尚未销毁），与 lock_owners_ 共用锁
+    struct LockLifetime {
+        uint64_t generation;
+        const char* init_site;
+    };
+    std::map<uint64_t, LockLifetime> live_mutexes_;
+    uint64_t next_generation_;
+    std::atomic<size_t> live_mutex_count_;      // live_mutexes_ 的大小，供 stats() 无锁读取
+    std::map<uint64_t, WaitRecord> thread_waiting_;
+    std::map<uint64_t, CondWaitRecord> cond_waiting_;   // 与 thread_waiting_ 共用 mutex_thread_waiting_
     std::map<uint64_t, std::string> thread_stacks_;
 
     // ========================================
@@ -88,38 +355,429 @@ private:
     int interval_seconds_;               // 检测间隔（秒）
     std::atomic<bool> deadlock_detected_; // 是否已检测到死锁
     
+    // 可中断的休眠：stop() 时立即唤醒检测线程
+    std::mutex mutex_sleep_;
+    std::condition_variable cv_sleep_;
+    
+    // ========================================
+    // 自适应检测间隔
+    // ========================================
+    std::atomic<bool> adaptive_;              // 是否启用自适应间隔
+    AdaptiveIntervalConfig adaptive_config_;  // 受 mutex_sleep_ 保护
+    std::atomic<int> current_interval_ms_;    // 当前间隔（毫秒）
+    uint64_t scan_cpu_ns_avg_;                // 单次检测的 CPU 耗时（EWMA，仅检测线程访问）
+    
+    // 最近一次建图时观察到的等待压力，供 next_interval_ms 使用（受 mutex_graph_ 保护）
+    size_t last_wait_count_;                  // 等待中的线程数
+    size_t last_long_wait_count_;             // 长等待线程数
+    uint64_t last_oldest_wait_ns_;            // 最久的等待时长
+    
+    // ========================================
+    // 事件循环模式：分片扫描状态（仅由调用 poll_once 的线程访问）
+    // ========================================
+    int timer_fd_;
+    int timer_armed_ms_;
+    enum PollPhase { POLL_IDLE, POLL_BUILD, POLL_CYCLE, POLL_WATCHDOG };
+    PollPhase poll_phase_;
+    std::map<uint64_t, uint64_t> poll_lock_owners_;
+    ReaderMap poll_rwlock_readers_;
+    std::map<uint64_t, WaitRecord> poll_thread_waiting_;
+    std::map<uint64_t, WaitRecord>::const_iterator poll_next_;
+    DirectedGraph poll_graph_;
+    size_t poll_long_wait_count_;
+    uint64_t poll_oldest_wait_ns_;
+    uint64_t poll_cpu_ns_;                    // 本轮扫描所有调用累计的 CPU 时间
+    
+    // ========================================
+    // 长等待看门狗
+    // ========================================
+    std::atomic<int> wait_budget_ms_;
+    std::map<uint64_t, uint64_t> reported_long_waits_;  // 已报告的等待：线程 → 开始时间（受 mutex_graph_ 保护）
+    std::map<uint64_t, uint64_t> reported_cond_waits_;  // 已报告的条件变量等待（同上）
+    
+    // ========================================
+    // 自旋锁
+    // ========================================
+    std::atomic<uint32_t> spin_wait_threshold_;         // 登记等待前的 trylock 次数
+    
+    // ========================================
+    // 持锁时长预算
+    // ========================================
+    HoldTimeTracker hold_time_;
+    std::map<uint64_t, uint64_t> reported_long_holds_;  // 已报告的超时持有：锁 → 获取时间（受 mutex_graph_ 保护）
+    
+    // ========================================
+    // 锁竞争剖析
+    // ========================================
+    ContentionProfiler profiler_;
+    std::atomic<int> profile_dump_interval_ms_;
+    uint64_t last_profile_dump_ns_;                     // 受 mutex_graph_ 保护
+    
+    // ========================================
+    // 锁事件追踪
+    // ========================================
+    TraceRecorder trace_;
+    
+    // ========================================
+    // 线程 → 线程 等待
+    // ========================================
+    ThreadWaitTracker thread_waits_;
+    ResourceTracker resources_;
+    
+    // ========================================
+    // 统计
+    // ========================================
+    ShardedStats stats_;                       // 钩子热路径计数（分片）
+    std::atomic<uint64_t> last_scan_ns_;       // 以下只由检测线程写
+    std::atomic<uint64_t> max_scan_ns_;
+    std::atomic<uint64_t> snapshot_owners_;
+    std::atomic<uint64_t> snapshot_waiters_;
+    std::atomic<uint64_t> max_snapshot_waiters_;
+    std::atomic<uint64_t> graph_nodes_;
+    
+    // ========================================
+    // 自身剖析
+    // ========================================
+    SelfProfileWindow self_profile_;
+    std::atomic<int> self_profile_log_every_;
+    PassProfile poll_pass_;                    // 事件循环模式下跨分片累计
+    
+    // ========================================
+    // 共享内存统计段（均受 mutex_graph_ 保护）
+    // ========================================
+    StatsPublisher publisher_;
+    std::vector<LiveWait> live_waits_;         // 本轮快照中的等待，发布前暂存
+    std::vector<uint64_t> last_published_cycle_; // 同一个死锁只记录一次
+    
     // ========================================
     // 内部辅助函数
     // ========================================
-    void build_waiting_graph();
+    void build_waiting_graph(PassProfile* pass = nullptr);
+    
+    // 把线程 → 线程 等待和多单位资源等待加入图
+    void add_thread_waits(DirectedGraph& graph);
+    
+    // 线程退出（在退出线程上、槽位注销前调用）：清除以内核线程 ID 为键的全部状态，
+    // 仍登记为它持有的锁视为泄漏，给出警告后丢弃持有记录；竞争统计并入汇总
+    static void thread_exit_hook(ThreadSlot& slot) { instance().on_thread_exit(slot); }
+    void on_thread_exit(ThreadSlot& slot);
+    
+    // 获取 / 释放后的每线程记录：持有锁栈、持锁计时、竞争剖析
+    void note_acquired(ThreadSlot* slot, uint64_t lock_addr, const char* site, uint64_t now, bool profiling);
+    void note_released(ThreadSlot* slot, uint64_t thread_id, uint64_t lock_addr, bool popped,
+                       const HeldLockInfo& info);
+    
+    // 为一个等待线程加边：指向写者（或互斥锁持有者）；请求写锁时还指向每个读者
+    static void add_wait_edges(DirectedGraph& graph, uint64_t waiting_thread, const WaitRecord& wait,
+                               const std::map<uint64_t, uint64_t>& lock_owners,
+                               const ReaderMap& rwlock_readers);
     
     // 后台检测线程的主循环
     void detector_loop();
     
+    // 根据等待压力和检测开销计算下一次检测间隔（毫秒）
+    int next_interval_ms(int current_ms, uint64_t scan_cpu_ns);
+    
+    // 长等待阈值（纳秒）
+    uint64_t long_wait_threshold_ns();
+    
+    // 一次检测发现死锁后的统一处理（只报告第一次），source 标明检测来自哪个模式
+    void report_deadlock_once(const char* source);
+    
+    // 普通互斥锁被持有者重复加锁：立即报告（计入"只报告一次"）
+    void report_self_deadlock(uint64_t thread_id, uint64_t lock_addr, const char* site);
+    
+    // 删除某个地址上的持有记录（调用方持有 mutex_lock_owners_），返回残留的持有者
+    uint64_t erase_lock_state_locked(uint64_t lock_addr);
+    
+    // 按当前间隔（重新）设置 timerfd
+    void arm_timer(int interval_ms);
+    
+    // 在快照上检查超出预算的等待并报告（调用时需持有 mutex_graph_）
+    void check_long_waits(const std::map<uint64_t, uint64_t>& lock_owners,
+                          const ReaderMap& rwlock_readers,
+                          const std::map<uint64_t, WaitRecord>& thread_waiting,
+                          uint64_t now);
+    
+    // 报告仍在持有且已超预算的锁（调用时需持有 mutex_graph_）
+    void check_long_holds();
+    
+    // 到期时输出竞争剖析（调用时需持有 mutex_graph_）
+    void maybe_dump_profile();
+    
+    // 供剖析器按类别合并使用
+    static uint64_t lookup_lock_class(uint64_t lock_addr);
+    
+    // 记录一次检测的耗时与结果（调用时需持有 mutex_graph_）
+    void record_scan(uint64_t scan_ns, bool found);
+    void record_snapshot_size(size_t lock_owners, size_t waiting_threads);
+    
+    // 记录一轮检测的分阶段剖析（调用时需持有 mutex_graph_）
+    void record_pass(PassProfile& pass);
+    
+    // 暂存本轮快照中的等待并发布统计段（调用时需持有 mutex_graph_）
+    void stage_live_waits(const std::map<uint64_t, uint64_t>& lock_owners,
+                          const std::map<uint64_t, WaitRecord>& thread_waiting,
+                          uint64_t now);
+    void publish_live_stats(bool found);
+    
     // 安全地获取快照（使用 std::lock 避免死锁）
     void get_snapshot(
         std::map<uint64_t, uint64_t>& lock_owners,
-        std::map<uint64_t, uint64_t>& thread_waiting,
-        std::map<uint64_t, std::string>& thread_stacks
+        ReaderMap& rwlock_readers,
+        std::map<uint64_t, WaitRecord>& thread_waiting,
+        std::map<uint64_t, std::string>& thread_stacks,
+        PassProfile* pass = nullptr
     );
 };
 
-// 宏定义（保持不变）
-#define pthread_mutex_lock(mutex_ptr)                                        \
-    do {                                                                     \
-        uint64_t tid = get_thread_id();                                     \
-        uint64_t lock_addr = reinterpret_cast<uint64_t>(mutex_ptr);        \
-        DeadlockDetector::instance().on_lock_before(tid, lock_addr);        \
-        pthread_mutex_lock(mutex_ptr);                                      \
-        DeadlockDetector::instance().on_lock_after(tid, lock_addr);         \
-    } while(0)
-
-#define pthread_mutex_unlock(mutex_ptr)                                      \
-    do {                                                                     \
-        pthread_mutex_unlock(mutex_ptr);                                    \
-        uint64_t tid = get_thread_id();                                     \
-        uint64_t lock_addr = reinterpret_cast<uint64_t>(mutex_ptr);        \
-        DeadlockDetector::instance().on_unlock_after(tid, lock_addr);       \
-    } while(0)
+// 调用位置 "file:line"：字符串字面量，编译期确定，运行时零开销
+#define DD_STRINGIFY_IMPL(x) #x
+#define DD_STRINGIFY(x) DD_STRINGIFY_IMPL(x)
+#define DD_SITE() (__FILE__ ":" DD_STRINGIFY(__LINE__))
+
+// ============================================
+// 互斥锁类型：glibc 把类型保存在锁对象里（静态初始化器同样适用），无需在 init 时登记；
+// 其他 C 库返回 -1（未知），不做即时自死锁判断
+// ============================================
+inline int dd_mutex_kind(const pthread_mutex_t* mutex) {
+#ifdef __GLIBC__
+    switch (mutex->__data.__kind & 3) {   // PTHREAD_MUTEX_KIND_MASK_NP
+        case PTHREAD_MUTEX_RECURSIVE_NP:
+            return PTHREAD_MUTEX_RECURSIVE;
+        case PTHREAD_MUTEX_ERRORCHECK_NP:
+            return PTHREAD_MUTEX_ERRORCHECK;
+        default:
+            return PTHREAD_MUTEX_NORMAL;   // 包括 ADAPTIVE：重复加锁同样会永远阻塞
+    }
+#else
+    (void)mutex;
+    return -1;
+#endif
+}
+
+// ============================================
+// lock / unlock：返回值交给调用方（检错锁的 EDEADLK / EPERM 不会被当作成功）
+// ============================================
+inline int dd_pthread_mutex_lock(pthread_mutex_t* mutex, const char* site) {
+    uint64_t tid = get_thread_id();
+    uint64_t lock_addr = reinterpret_cast<uint64_t>(mutex);
+    DeadlockDetector::instance().on_mutex_lock_before(tid, mutex, site);
+    int rc = pthread_mutex_lock(mutex);
+    if (rc == 0) {
+        DeadlockDetector::instance().on_lock_after(tid, lock_addr, site);
+    } else {
+        DeadlockDetector::instance().on_lock_failed(tid, lock_addr, site, true);
+    }
+    return rc;
+}
+
+inline int dd_pthread_mutex_unlock(pthread_mutex_t* mutex) {
+    int rc = pthread_mutex_unlock(mutex);
+    if (rc == 0) {
+        DeadlockDetector::instance().on_unlock_after(get_thread_id(), reinterpret_cast<uint64_t>(mutex));
+    }
+    return rc;
+}
+
+// ============================================
+// trylock / timedlock：返回值要交给调用方，用内联函数实现（定义在宏之前，内部调用的是原函数）
+// trylock 成功时直接登记持有（不登记等待，它不会阻塞）；
+// timedlock 与 lock 一样先登记等待，超时或出错时撤回
+// ============================================
+inline int dd_pthread_mutex_trylock(pthread_mutex_t* mutex, const char* site) {
+    uint64_t tid = get_thread_id();
+    uint64_t lock_addr = reinterpret_cast<uint64_t>(mutex);
+    int rc = pthread_mutex_trylock(mutex);
+    if (rc == 0) {
+        DeadlockDetector::instance().on_lock_after(tid, lock_addr, site);
+    } else {
+        DeadlockDetector::instance().on_lock_failed(tid, lock_addr, site, false);
+    }
+    return rc;
+}
+
+inline int dd_pthread_mutex_timedlock(pthread_mutex_t* mutex, const struct timespec* abstime,
+                                      const char* site) {
+    uint64_t tid = get_thread_id();
+    uint64_t lock_addr = reinterpret_cast<uint64_t>(mutex);
+    DeadlockDetector::instance().on_mutex_lock_before(tid, mutex, site, true);
+    int rc = pthread_mutex_timedlock(mutex, abstime);
+    if (rc == 0) {
+        DeadlockDetector::instance().on_lock_after(tid, lock_addr, site);
+    } else {
+        DeadlockDetector::instance().on_lock_failed(tid, lock_addr, site, true);
+    }
+    return rc;
+}
+
+// ============================================
+// 读写锁：读锁以 shared 方式登记（进入读者位图），写锁与互斥锁相同
+// ============================================
+inline int dd_rwlock_result(int rc, uint64_t tid, uint64_t lock_addr, const char* site, bool shared,
+                            bool waited) {
+    if (rc == 0) {
+        DeadlockDetector::instance().on_lock_after(tid, lock_addr, site, shared);
+    } else {
+        DeadlockDetector::instance().on_lock_failed(tid, lock_addr, site, waited);
+    }
+    return rc;
+}
+
+inline int dd_pthread_rwlock_rdlock(pthread_rwlock_t* rwlock, const char* site) {
+    uint64_t tid = get_thread_id();
+    uint64_t lock_addr = reinterpret_cast<uint64_t>(rwlock);
+    DeadlockDetector::instance().on_lock_before(tid, lock_addr, site, true);
+    return dd_rwlock_result(pthread_rwlock_rdlock(rwlock), tid, lock_addr, site, true, true);
+}
+
+inline int dd_pthread_rwlock_wrlock(pthread_rwlock_t* rwlock, const char* site) {
+    uint64_t tid = get_thread_id();
+    uint64_t lock_addr = reinterpret_cast<uint64_t>(rwlock);
+    DeadlockDetector::instance().on_lock_before(tid, lock_addr, site, false);
+    return dd_rwlock_result(pthread_rwlock_wrlock(rwlock), tid, lock_addr, site, false, true);
+}
+
+inline int dd_pthread_rwlock_tryrdlock(pthread_rwlock_t* rwlock, const char* site) {
+    return dd_rwlock_result(pthread_rwlock_tryrdlock(rwlock), get_thread_id(),
+                            reinterpret_cast<uint64_t>(rwlock), site, true, false);
+}
+
+inline int dd_pthread_rwlock_trywrlock(pthread_rwlock_t* rwlock, const char* site) {
+    return dd_rwlock_result(pthread_rwlock_trywrlock(rwlock), get_thread_id(),
+                            reinterpret_cast<uint64_t>(rwlock), site, false, false);
+}
+
+inline int dd_pthread_rwlock_timedrdlock(pthread_rwlock_t* rwlock, const struct timespec* abstime,
+                                         const char* site) {
+    uint64_t tid = get_thread_id();
+    uint64_t lock_addr = reinterpret_cast<uint64_t>(rwlock);
+    DeadlockDetector::instance().on_lock_before(tid, lock_addr, site, true);
+    return dd_rwlock_result(pthread_rwlock_timedrdlock(rwlock, abstime), tid, lock_addr, site, true, true);
+}
+
+inline int dd_pthread_rwlock_timedwrlock(pthread_rwlock_t* rwlock, const struct timespec* abstime,
+                                         const char* site) {
+    uint64_t tid = get_thread_id();
+    uint64_t lock_addr = reinterpret_cast<uint64_t>(rwlock);
+    DeadlockDetector::instance().on_lock_before(tid, lock_addr, site, false);
+    return dd_rwlock_result(pthread_rwlock_timedwrlock(rwlock, abstime), tid, lock_addr, site, false, true);
+}
+
+inline int dd_pthread_rwlock_unlock(pthread_rwlock_t* rwlock) {
+    int rc = pthread_rwlock_unlock(rwlock);
+    if (rc == 0) {
+        DeadlockDetector::instance().on_unlock_after(get_thread_id(), reinterpret_cast<uint64_t>(rwlock));
+    }
+    return rc;
+}
+
+// ============================================
+// 自旋锁包装
+// 未竞争：一次 trylock 成功，只在本线程槽位写入持有记录；
+// 竞争：先自旋 spin_wait_threshold() 次，仍失败才登记等待（见 deadlock_detector.cpp）
+// ============================================
+int dd_pthread_spin_lock_contended(pthread_spinlock_t* lock, const char* site);
+
+inline int dd_pthread_spin_lock(pthread_spinlock_t* lock, const char* site) {
+    if (pthread_spin_trylock(lock) != 0) {
+        int rc = dd_pthread_spin_lock_contended(lock, site);
+        if (rc != 0) {
+            return rc;
+        }
+    }
+    DeadlockDetector::instance().on_spin_acquired(reinterpret_cast<uint64_t>(lock), site);
+    return 0;
+}
+
+inline int dd_pthread_spin_trylock(pthread_spinlock_t* lock, const char* site) {
+    uint64_t lock_addr = reinterpret_cast<uint64_t>(lock);
+    int rc = pthread_spin_trylock(lock);
+    if (rc == 0) {
+        DeadlockDetector::instance().on_spin_acquired(lock_addr, site);
+    } else {
+        DeadlockDetector::instance().on_lock_failed(get_thread_id(), lock_addr, site, false);
+    }
+    return rc;
+}
+
+// 持有记录必须在真正解锁之前清除，否则检测线程可能同时看到两个持有者
+inline int dd_pthread_spin_unlock(pthread_spinlock_t* lock) {
+    DeadlockDetector::instance().on_spin_released(reinterpret_cast<uint64_t>(lock));
+    return pthread_spin_unlock(lock);
+}
+
+// ============================================
+// 互斥锁生命周期：init 成功后登记新的代号，destroy 成功后清除该地址的状态
+// ============================================
+int dd_pthread_mutex_init(pthread_mutex_t* mutex, const pthread_mutexattr_t* attr, const char* site);
+int dd_pthread_mutex_destroy(pthread_mutex_t* mutex, const char* site);
+
+// ============================================
+// 线程与同步原语包装：在真正的调用前后记录 happens-before 事件
+// （追踪未开启时直接调用原函数）
+// ============================================
+int dd_pthread_create(pthread_t* thread, const pthread_attr_t* attr,
+                      void* (*start_routine)(void*), void* arg, const char* site);
+int dd_pthread_join(pthread_t thread, void** retval, const char* site);
+int dd_pthread_cond_signal(pthread_cond_t* cond, const char* site);
+int dd_pthread_cond_broadcast(pthread_cond_t* cond, const char* site);
+int dd_pthread_cond_wait(pthread_cond_t* cond, pthread_mutex_t* mutex, const char* site);
+int dd_pthread_cond_timedwait(pthread_cond_t* cond, pthread_mutex_t* mutex,
+                              const struct timespec* abstime, const char* site);
+int dd_pthread_barrier_init(pthread_barrier_t* barrier, const pthread_barrierattr_t* attr, unsigned count);
+int dd_pthread_barrier_destroy(pthread_barrier_t* barrier);
+int dd_pthread_barrier_wait(pthread_barrier_t* barrier, const char* site);
+
+// ============================================
+// 信号量包装：维护单位数与持有者（见 resource_tracker.h），并记录 happens-before 事件
+// ============================================
+int dd_sem_init(sem_t* sem, int pshared, unsigned value);
+int dd_sem_destroy(sem_t* sem);
+int dd_sem_wait(sem_t* sem, const char* site);
+int dd_sem_trywait(sem_t* sem, const char* site);
+int dd_sem_timedwait(sem_t* sem, const struct timespec* abstime, const char* site);
+int dd_sem_post(sem_t* sem, const char* site);
+
+// 宏定义
+#define pthread_mutex_init(mutex_ptr, attr) dd_pthread_mutex_init(mutex_ptr, attr, DD_SITE())
+#define pthread_mutex_destroy(mutex_ptr) dd_pthread_mutex_destroy(mutex_ptr, DD_SITE())
+#define pthread_mutex_lock(mutex_ptr) dd_pthread_mutex_lock(mutex_ptr, DD_SITE())
+#define pthread_mutex_unlock(mutex_ptr) dd_pthread_mutex_unlock(mutex_ptr)
+
+#define pthread_mutex_trylock(mutex_ptr) dd_pthread_mutex_trylock(mutex_ptr, DD_SITE())
+#define pthread_mutex_timedlock(mutex_ptr, abstime) \
+    dd_pthread_mutex_timedlock(mutex_ptr, abstime, DD_SITE())
+
+#define pthread_rwlock_rdlock(rwlock) dd_pthread_rwlock_rdlock(rwlock, DD_SITE())
+#define pthread_rwlock_wrlock(rwlock) dd_pthread_rwlock_wrlock(rwlock, DD_SITE())
+#define pthread_rwlock_tryrdlock(rwlock) dd_pthread_rwlock_tryrdlock(rwlock, DD_SITE())
+#define pthread_rwlock_trywrlock(rwlock) dd_pthread_rwlock_trywrlock(rwlock, DD_SITE())
+#define pthread_rwlock_timedrdlock(rwlock, abstime) dd_pthread_rwlock_timedrdlock(rwlock, abstime, DD_SITE())
+#define pthread_rwlock_timedwrlock(rwlock, abstime) dd_pthread_rwlock_timedwrlock(rwlock, abstime, DD_SITE())
+#define pthread_rwlock_unlock(rwlock) dd_pthread_rwlock_unlock(rwlock)
+
+#define pthread_spin_lock(lock) dd_pthread_spin_lock(lock, DD_SITE())
+#define pthread_spin_trylock(lock) dd_pthread_spin_trylock(lock, DD_SITE())
+#define pthread_spin_unlock(lock) dd_pthread_spin_unlock(lock)
+
+#define pthread_create(thread, attr, start_routine, arg) \
+    dd_pthread_create(thread, attr, start_routine, arg, DD_SITE())
+#define pthread_join(thread, retval) dd_pthread_join(thread, retval, DD_SITE())
+#define pthread_cond_signal(cond) dd_pthread_cond_signal(cond, DD_SITE())
+#define pthread_cond_broadcast(cond) dd_pthread_cond_broadcast(cond, DD_SITE())
+#define pthread_cond_wait(cond, mutex) dd_pthread_cond_wait(cond, mutex, DD_SITE())
+#define pthread_cond_timedwait(cond, mutex, abstime) \
+    dd_pthread_cond_timedwait(cond, mutex, abstime, DD_SITE())
+#define pthread_barrier_init(barrier, attr, count) dd_pthread_barrier_init(barrier, attr, count)
+#define pthread_barrier_destroy(barrier) dd_pthread_barrier_destroy(barrier)
+#define pthread_barrier_wait(barrier) dd_pthread_barrier_wait(barrier, DD_SITE())
+
+#define sem_init(sem, pshared, value) dd_sem_init(sem, pshared, value)
+#define sem_destroy(sem) dd_sem_destroy(sem)
+#define sem_wait(sem) dd_sem_wait(sem, DD_SITE())
+#define sem_trywait(sem) dd_sem_trywait(sem, DD_SITE())
+#define sem_timedwait(sem, abstime) dd_sem_timedwait(sem, abstime, DD_SITE())
+#define sem_post(sem) dd_sem_post(sem, DD_SITE())
 
 #endif // DEADLOCK_DETECTOR_H
\ No newline at end of file
@@ -0,0 +1,116 @@
+#ifndef DETECTOR_STATS_H
+#define DETECTOR_STATS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include "thread_registry.h"
+
+// ============================================
+// 分片统计计数器
+// 钩子每次调用都要加计数，如果所有线程都写同一个全局计数器，
+// 这条缓存行会在各 CPU 之间来回迁移。这里把计数器拆成 kStatShards 个
+// 按缓存行对齐的分片，线程按缓存的线程序号选择分片（relaxed 原子加），
+// 读取时再把所有分片求和。
+// 不用 sched_getcpu()：线程随时可能被迁移，每次都要重新查询，
+// 而线程序号在线程生命周期内不变，只需在 thread_local 中缓存一次。
+// ============================================
+enum StatCounter {
+    STAT_LOCK_BEFORE = 0,      // on_lock_before 调用次数
+    STAT_LOCK_AFTER,           // on_lock_after 调用次数（成功获取）
+    STAT_UNLOCK,               // on_unlock_after 调用次数
+    STAT_CONTENDED,            // 竞争获取次数（需开启竞争剖析）
+    STAT_LOCK_FAILED,          // trylock 失败 / timedlock 超时次数
+    STAT_SPIN_WAITS,           // 自旋超过阈值、登记为等待的次数
+    STAT_SPIN_NS,              // 登记等待后自旋消耗的 CPU 时间（纳秒）
+    STAT_SELF_DEADLOCKS,       // 普通互斥锁被持有者重复加锁的次数
+    STAT_MUTEX_INITS,          // pthread_mutex_init 次数
+    STAT_MUTEX_DESTROYS,       // pthread_mutex_destroy 次数（成功的）
+    STAT_THREAD_EXITS,         // 已注销的线程数
+    STAT_LOCKS_LEAKED,         // 线程退出时仍持有的锁
+    STAT_DETECTIONS,           // 检测轮数
+    STAT_DEADLOCKS,            // 发现死锁的检测轮数
+    STAT_SCAN_NS,              // 检测累计耗时（纳秒）
+    STAT_COUNTER_COUNT
+};
+
+static const size_t kStatShards = 64;
+
+class ShardedStats {
+public:
+    ShardedStats() {
+        for (size_t s = 0; s < kStatShards; s++) {
+            for (size_t c = 0; c < STAT_COUNTER_COUNT; c++) {
+                shards_[s].counters[c].store(0, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    void add(StatCounter counter, uint64_t delta = 1) {
+        shards_[shard_index()].counters[counter].fetch_add(delta, std::memory_order_relaxed);
+    }
+
+    // 汇总所有分片
+    uint64_t sum(StatCounter counter) const {
+        uint64_t total = 0;
+        for (size_t s = 0; s < kStatShards; s++) {
+            total += shards_[s].counters[counter].load(std::memory_order_relaxed);
+        }
+        return total;
+    }
+
+private:
+    struct alignas(64) Shard {
+        std::atomic<uint64_t> counters[STAT_COUNTER_COUNT];
+    };
+
+    static size_t shard_index() {
+        static thread_local size_t index = kStatShards;
+        if (index == kStatShards) {
+            ThreadSlot* slot = ThreadRegistry::current();
+            index = slot ? slot->ordinal % kStatShards : 0;
+        }
+        return index;
+    }
+
+    Shard shards_[kStatShards];
+};
+
+// ============================================
+// stats() 返回的汇总结果
+// ============================================
+struct DetectorStats {
+    // 钩子
+    uint64_t lock_before_calls;
+    uint64_t lock_after_calls;
+    uint64_t unlock_calls;
+    uint64_t contended_acquisitions;
+    uint64_t failed_lock_calls;
+    uint64_t spin_waits;
+    uint64_t spin_cpu_ns;
+    uint64_t self_deadlocks;
+    uint64_t mutex_inits;
+    uint64_t mutex_destroys;
+    uint64_t live_mutexes;     // 已初始化、尚未销毁的互斥锁
+    uint64_t thread_exits;
+    uint64_t locks_leaked_at_exit;
+
+    // 检测
+    uint64_t detections_run;
+    uint64_t deadlocks_found;
+    uint64_t scan_ns_total;
+    uint64_t last_scan_ns;
+    uint64_t max_scan_ns;
+
+    // 最近一次快照的规模
+    uint64_t snapshot_lock_owners;
+    uint64_t snapshot_waiting_threads;
+    uint64_t max_snapshot_waiting_threads;
+    uint64_t graph_nodes;
+
+    // 其他
+    uint64_t registered_threads;
+    uint64_t report_records_dropped;
+};
+
+#endif // DETECTOR_STATS_H
@@ -5,6 +5,10 @@
 #include <map>
 #include <stdint.h>
 #include <deque>
+#include <cstddef>
+#include <utility>
+
+class ReportWriter;
 
 // ============================================
 // 图的顶点结构
@@ -12,8 +16,22 @@
 struct GraphVertex {
     int indegree;                    // 入度（有多少条边指向我）
     std::vector<uint64_t> neighbors; // 出边列表（我指向谁）
+    bool wait_any;                   // 出边为"或"语义：任一后继能推进，自己就能推进
+    
+    // 资源分配图：持有的资源单位 (资源, 单位数)
+    std::vector<std::pair<uint64_t, uint32_t> > holds;
     
-    GraphVertex() : indegree(0) {}
+    GraphVertex() : indegree(0), wait_any(false) {}
+};
+
+// ============================================
+// 资源分配图中的资源顶点（信号量、计数资源池）
+// ============================================
+struct ResourceVertex {
+    uint32_t available;                                   // 当前空闲单位数
+    std::vector<std::pair<uint32_t, uint64_t> > requests; // (请求单位数, 请求线程)
+    
+    ResourceVertex() : available(0) {}
 };
 
 // ============================================
@@ -21,7 +39,7 @@ struct GraphVertex {
 // ============================================
 class DirectedGraph {
 public:
-    DirectedGraph() {}
+    DirectedGraph() : edges_(0), wait_any_count_(0), reduced_(false) {}
     
     // ========================================
     // 核心接口
@@ -36,23 +54,77 @@ public:
     // 获取图中的所有节点ID（用于打印死锁信息）
     std::vector<uint64_t> get_all_nodes() const;
     
+    // ========================================
+    // 资源分配图（RAG）模式
+    // 多单位资源上有环不一定死锁，"或"等待需要找结（knot）而不是环。
+    // 加入资源顶点或"或"等待后，has_deadlock() 改用图归约：
+    // 反复移除所有请求都能被满足（"或"节点：任一请求）的线程并归还其持有的单位，
+    // 无法移除的线程即死锁。对纯"与"等待的单单位图，结果与判环相同。
+    // ========================================
+    
+    // node 的出边改为"或"语义（例如等待线程池中任一工作线程空出来）
+    void set_wait_any(uint64_t node);
+    
+    // 资源顶点及其当前空闲单位数
+    void add_resource(uint64_t resource, uint32_t available);
+    
+    // 分配边：thread 持有 resource 的 units 个单位
+    void add_allocation(uint64_t resource, uint64_t thread, uint32_t units);
+    
+    // 请求边：thread 在等待 resource 的 units 个单位
+    void add_request(uint64_t thread, uint64_t resource, uint32_t units);
+    
+    // 检测死锁：纯线程图用拓扑排序判环，资源分配图用归约（O(V + E)，每个资源的请求按单位数排序一次）
+    bool has_deadlock();
+    
+    // 死锁涉及的线程：归约后为无法移除的线程，判环时为所有节点
+    std::vector<uint64_t> get_deadlocked_nodes() const;
+    
+    size_t resource_count() const { return resources_.size(); }
+    
     // 清空图
     void clear();
     
     // 获取节点数量
     size_t size() const { return graph_.size(); }
     
+    // 获取边数量
+    size_t edge_count() const { return edges_; }
+    
+    // 与另一张图交换内容（O(1)，用于分片构建完成后整体替换）
+    void swap(DirectedGraph& other) {
+        graph_.swap(other.graph_);
+        resources_.swap(other.resources_);
+        std::swap(edges_, other.edges_);
+        std::swap(wait_any_count_, other.wait_any_count_);
+        blocked_.swap(other.blocked_);
+        std::swap(reduced_, other.reduced_);
+    }
+    
     // ========================================
     // 调试接口
     // ========================================
     void print_graph() const;
+    
+    // 把图结构追加到已有的报告记录中
+    void print_graph(ReportWriter& out) const;
 
 private:
     // 图的邻接表表示：节点ID → 顶点信息
     std::map<uint64_t, GraphVertex> graph_;
+    size_t edges_;
+    
+    // 资源分配图
+    std::map<uint64_t, ResourceVertex> resources_;
+    size_t wait_any_count_;             // "或"节点数
+    std::vector<uint64_t> blocked_;      // 最近一次归约后无法移除的线程
+    bool reduced_;                       // 最近一次检测是否走了归约
     
     // 确保节点存在（如果不存在则创建）
     void ensure_node_exists(uint64_t node_id);
+    
+    // 图归约，无法移除的线程写入 blocked_
+    bool reduce();
 };
 
 #endif // GRAPH_H
\ No newline at end of file
@@ -0,0 +1,69 @@
+#ifndef HEAVY_HITTERS_H
+#define HEAVY_HITTERS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <mutex>
+#include <vector>
+
+// ============================================
+// Space-Saving 流式 Top-K
+// 固定 kCapacity 个计数器，与出现过多少个不同的键无关。
+// 任一键的真实次数满足：count - error <= 真实次数 <= count，
+// 且出现次数超过 总数 / kCapacity 的键一定在表中。
+// 结构：按 count 排序的最小堆 + 键到堆位置的开放寻址索引，每次 offer 为 O(log K)。
+// ============================================
+class SpaceSaving {
+public:
+    static const size_t kCapacity = 2048;          // 监控的计数器数量
+    static const size_t kIndexSize = kCapacity * 2; // 索引槽位（2 的幂）
+
+    struct Item {
+        uint64_t key;
+        uint64_t count;   // 估计次数（上界）
+        uint64_t error;   // 最大高估量
+    };
+
+    SpaceSaving() { clear(); }
+
+    // 记录一次（或 weight 次）出现；线程安全
+    void offer(uint64_t key, uint64_t weight = 1);
+
+    // 次数最多的 n 个键（按 count 降序）
+    std::vector<Item> top(size_t n) const;
+
+    // 所有 offer 的总权重
+    uint64_t total() const;
+
+    void clear();
+
+private:
+    struct HeapItem {
+        uint64_t key;
+        uint64_t count;
+        uint64_t error;
+        uint32_t slot;    // 在索引中的槽位，移动时据此更新索引
+    };
+
+    static size_t hash(uint64_t key) {
+        key ^= key >> 33;
+        key *= 0xff51afd7ed558ccdull;
+        key ^= key >> 33;
+        return static_cast<size_t>(key) & (kIndexSize - 1);
+    }
+
+    long find_slot(uint64_t key) const;
+    void insert_index(uint32_t heap_pos);
+    void erase_index(uint32_t slot);
+    void swap_heap(size_t a, size_t b);
+    void sift_down(size_t pos);
+    void sift_up(size_t pos);
+
+    HeapItem heap_[kCapacity];
+    int32_t index_[kIndexSize];   // 堆位置，-1 表示空
+    size_t size_;
+    uint64_t total_;
+    mutable std::mutex mutex_;
+};
+
+#endif // HEAVY_HITTERS_H
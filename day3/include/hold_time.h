@@ -0,0 +1,96 @@
+#ifndef HOLD_TIME_H
+#define HOLD_TIME_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <vector>
+#include "atomic_table.h"
+#include "thread_registry.h"
+
+// ============================================
+// 一次持锁超预算记录
+// ============================================
+struct HoldViolation {
+    uint64_t lock_addr;
+    uint64_t thread_id;
+    uint64_t hold_ns;       // 实际持有时长（仍持有时为截至扫描时的时长）
+    uint64_t budget_ns;     // 适用的预算
+    uint64_t acquired_ns;   // 获取时间（precise_now_ns）
+    const char* site;       // 获取位置
+    bool still_held;        // true 表示由检测线程扫描发现、尚未释放
+};
+
+// ============================================
+// 持锁时长预算
+// 预算优先级：单锁预算 > 锁类别预算 > 默认预算；全部为 0 时不计时。
+// 解锁路径只做无锁查表和一次环形缓冲写入，不经过任何全局互斥锁。
+// ============================================
+class HoldTimeTracker {
+public:
+    static const size_t kMaxLockClasses = 256;
+    static const size_t kViolationRingSize = 1024;  // 2 的幂
+    static const size_t kBudgetTableSize = 4096;    // 可单独配置预算/类别的锁数量上限
+
+    HoldTimeTracker();
+
+    // ---------- 配置 ----------
+    void set_default_budget_ns(uint64_t budget_ns);
+    bool set_lock_budget_ns(uint64_t lock_addr, uint64_t budget_ns);
+    bool set_lock_class(uint64_t lock_addr, uint32_t class_id);
+    void set_class_budget_ns(uint32_t class_id, uint64_t budget_ns);
+
+    // 锁被销毁：删除它的单锁预算和类别，地址复用后的新锁不会继承
+    void forget_lock(uint64_t lock_addr);
+
+    // 是否配置了任何预算（决定钩子是否记录获取时间）
+    bool enabled() const { return enabled_.load(std::memory_order_relaxed); }
+
+    // 锁类别：0 表示未分类，否则为 类别ID + 1
+    uint64_t lock_class(uint64_t lock_addr) const { return lock_classes_.get(lock_addr); }
+
+    // 查找某把锁适用的预算，0 表示不限
+    uint64_t budget_for(uint64_t lock_addr) const;
+
+    // ---------- 热路径（解锁线程调用） ----------
+    void on_release(uint64_t thread_id, const HeldLockInfo& info, uint64_t now_ns);
+
+    // ---------- 检测线程 ----------
+    // 扫描所有线程当前持有的锁，找出已超预算者
+    void scan_held(uint64_t now_ns, std::vector<HoldViolation>& out) const;
+
+    // 最近的超预算释放记录（最多 kViolationRingSize 条，按时间先后）
+    std::vector<HoldViolation> recent_violations() const;
+
+    // 累计超预算释放次数
+    uint64_t violation_count() const { return ring_pos_.load(std::memory_order_relaxed); }
+
+private:
+    HoldTimeTracker(const HoldTimeTracker&) = delete;
+    HoldTimeTracker& operator=(const HoldTimeTracker&) = delete;
+
+    void update_enabled();
+
+    // 环形缓冲条目：seq 为奇数表示正在写入，2*i+2 表示第 i 条写入完成
+    struct RingEntry {
+        std::atomic<uint64_t> seq;
+        std::atomic<uint64_t> lock_addr;
+        std::atomic<uint64_t> thread_id;
+        std::atomic<uint64_t> hold_ns;
+        std::atomic<uint64_t> budget_ns;
+        std::atomic<uint64_t> acquired_ns;
+        std::atomic<const char*> site;
+    };
+
+    std::atomic<bool> enabled_;
+    std::atomic<uint64_t> default_budget_ns_;
+    std::atomic<uint64_t> class_budget_ns_[kMaxLockClasses];
+    std::atomic<uint32_t> class_budgets_set_;
+    AtomicAddrTable<kBudgetTableSize> lock_budgets_;   // 锁地址 → 预算
+    AtomicAddrTable<kBudgetTableSize> lock_classes_;   // 锁地址 → 类别 + 1
+
+    RingEntry ring_[kViolationRingSize];
+    std::atomic<uint64_t> ring_pos_;
+};
+
+#endif // HOLD_TIME_H
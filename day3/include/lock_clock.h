@@ -0,0 +1,39 @@
+#ifndef LOCK_CLOCK_H
+#define LOCK_CLOCK_H
+
+#include <stdint.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// ============================================
+// 钩子使用的时间源
+// ============================================
+
+// 粗粒度单调时钟（纳秒）：走 vDSO 只读内核 tick 缓存，几纳秒一次，
+// 精度约为一个 jiffy（1~4ms），适合常开的"等了多久"类统计
+inline uint64_t coarse_now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+// 精确单调时钟（纳秒）：用于需要微秒级分辨率的耗时测量
+inline uint64_t precise_now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+// 追踪时间戳：x86 上直接读 TSC（不陷入内核，约 10 个周期），
+// 其他架构退化为 CLOCK_MONOTONIC 纳秒。换算参数由追踪记录器在打开文件时标定
+inline uint64_t trace_ticks() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return precise_now_ns();
+#endif
+}
+
+#endif // LOCK_CLOCK_H
@@ -0,0 +1,66 @@
+#ifndef READER_SET_H
+#define READER_SET_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+// ============================================
+// 读写锁的读者集合：按线程序号（ThreadSlot::ordinal）索引的位图
+// 序号是稠密的，位图只增长到出现过的最大序号，数百个读者也只需几十个字，
+// 插入 / 删除 O(1)，拷贝快照就是拷贝一段连续内存。
+// 不是线程安全的，由调用方加锁。
+// ============================================
+class ReaderSet {
+public:
+    ReaderSet() : count_(0) {}
+
+    void insert(uint32_t ordinal) {
+        size_t word = ordinal / 64;
+        if (word >= words_.size()) {
+            words_.resize(word + 1, 0);
+        }
+        uint64_t bit = 1ull << (ordinal % 64);
+        if (!(words_[word] & bit)) {
+            words_[word] |= bit;
+            count_++;
+        }
+    }
+
+    void erase(uint32_t ordinal) {
+        size_t word = ordinal / 64;
+        uint64_t bit = 1ull << (ordinal % 64);
+        if (word < words_.size() && (words_[word] & bit)) {
+            words_[word] &= ~bit;
+            count_--;
+        }
+    }
+
+    bool contains(uint32_t ordinal) const {
+        size_t word = ordinal / 64;
+        return word < words_.size() && (words_[word] & (1ull << (ordinal % 64)));
+    }
+
+    size_t size() const { return count_; }
+    bool empty() const { return count_ == 0; }
+    size_t bytes() const { return words_.size() * sizeof(uint64_t); }
+
+    // 按序号从小到大遍历：func(ordinal)
+    template <typename Func>
+    void for_each(Func func) const {
+        for (size_t w = 0; w < words_.size(); w++) {
+            uint64_t bits = words_[w];
+            while (bits) {
+                uint32_t bit = static_cast<uint32_t>(__builtin_ctzll(bits));
+                func(static_cast<uint32_t>(w * 64 + bit));
+                bits &= bits - 1;
+            }
+        }
+    }
+
+private:
+    std::vector<uint64_t> words_;
+    size_t count_;
+};
+
+#endif // READER_SET_H
@@ -0,0 +1,173 @@
+#ifndef REPORT_SINK_H
+#define REPORT_SINK_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <string>
+#include <thread>
+#include <ios>
+
+// ============================================
+// 输出目的地（Sink）
+// 每次 write_record 对应一条完整记录；由后台写线程串行调用
+// ============================================
+class ReportSink {
+public:
+    virtual ~ReportSink() {}
+    virtual void write_record(const char* data, size_t len) = 0;
+};
+
+// 写到文件描述符：每条记录一次 write(2)（处理 EINTR 与部分写），不同记录不会交错。
+// 绕过 stdio：标准输出被重定向时，程序自己仍在 stdio 缓冲区里的输出会晚于报告出现
+class FdSink : public ReportSink {
+public:
+    explicit FdSink(int fd, bool owns_fd = false) : fd_(fd), owns_fd_(owns_fd) {}
+    ~FdSink();
+    void write_record(const char* data, size_t len);
+
+protected:
+    int fd_;
+    bool owns_fd_;
+};
+
+// 写到 stdio 流（需要时通过 set_sink 选用）：与程序自己的 printf / std::cout 共用同一个缓冲区，
+// 每条记录写完即 fflush。记录超过流的缓冲区（管道上 4 KB）时会被拆成多次 write(2)，
+// 可能与程序自己的输出交错；默认的 FdSink 没有这个问题。
+// 注意报告是异步写出的，与调用线程随后的输出之间的先后顺序任何 Sink 都不保证，需要时调用 flush()。
+class StdioSink : public ReportSink {
+public:
+    explicit StdioSink(FILE* stream) : stream_(stream) {}
+    void write_record(const char* data, size_t len);
+
+private:
+    FILE* stream_;
+};
+
+// 追加写到文件
+class FileSink : public FdSink {
+public:
+    explicit FileSink(const std::string& path);
+    bool is_open() const { return fd_ >= 0; }
+};
+
+// 写到内存（测试、嵌入式采集用）
+class MemorySink : public ReportSink {
+public:
+    void write_record(const char* data, size_t len);
+    std::string contents() const;
+    void clear();
+
+private:
+    mutable std::mutex mutex_;
+    std::string buffer_;
+};
+
+// ============================================
+// 异步报告器
+// 生产者把完整记录拷进预分配的槽位，通过无锁有界队列交给后台写线程。
+// 超过一个槽位的记录一次占用连续的多个槽位（续接槽位），写线程拼回一条记录再交给 Sink，
+// 不会与其他线程的记录交错。队列满时丢弃整条记录并计数，检测器永远不会因为日志管道阻塞而变慢。
+// ============================================
+class AsyncReporter {
+public:
+    static const size_t kRecordSize = 2048;  // 单个槽位的字节数
+    static const size_t kQueueSlots = 256;   // 队列槽位数（2 的幂）
+    static const size_t kMaxRecordSlots = 32; // 单条记录最多占用的槽位数（64 KB），超出部分截断
+
+    static AsyncReporter& instance() {
+        static AsyncReporter reporter;
+        return reporter;
+    }
+
+    // 替换输出目的地（默认是 FdSink(STDOUT_FILENO)：每条记录一次 write(2)）
+    void set_sink(const std::shared_ptr<ReportSink>& sink);
+
+    // 提交一条记录（无锁）；队列中没有足够的连续空闲槽位时返回 false
+    bool submit(const char* data, size_t len);
+
+    // 等待已提交的记录全部写出
+    void flush();
+
+    // 因队列满而丢弃的记录数
+    uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+    AsyncReporter();
+    ~AsyncReporter();
+    AsyncReporter(const AsyncReporter&) = delete;
+    AsyncReporter& operator=(const AsyncReporter&) = delete;
+
+    // Vyukov 有界队列的槽位
+    struct Slot {
+        std::atomic<size_t> sequence;
+        uint32_t len;
+        bool more;                        // 记录在下一个槽位中继续
+        char data[kRecordSize];
+    };
+
+    bool try_pop(Slot*& slot);
+    void writer_loop();
+
+    Slot slots_[kQueueSlots];
+    std::atomic<size_t> enqueue_pos_;
+    size_t dequeue_pos_;                  // 仅写线程访问
+    std::string pending_;                 // 正在拼接的多槽位记录（仅写线程访问）
+    std::atomic<uint64_t> dropped_;
+    std::atomic<uint64_t> submitted_;
+    std::atomic<uint64_t> written_;
+
+    std::mutex mutex_sink_;
+    std::shared_ptr<ReportSink> sink_;
+
+    std::mutex mutex_wake_;
+    std::condition_variable cv_wake_;     // 唤醒写线程
+    std::condition_variable cv_drained_;  // 通知 flush()
+    std::atomic<bool> running_;
+    std::thread writer_thread_;
+};
+
+// ============================================
+// 记录格式化器：在栈上预分配的缓冲区里用 << 拼接，析构时整条提交。
+// 支持 std::hex / std::dec；超过一个槽位时转存到堆上，提交时仍是一条记录。
+// ============================================
+class ReportWriter {
+public:
+    ReportWriter() : len_(0), hex_(false) {}
+    ~ReportWriter() { commit(); }
+
+    ReportWriter& operator<<(const char* s);
+    ReportWriter& operator<<(const std::string& s) { return write(s.data(), s.size()); }
+    ReportWriter& operator<<(char c) { return write(&c, 1); }
+    ReportWriter& operator<<(int v) { return write_signed(v); }
+    ReportWriter& operator<<(long v) { return write_signed(v); }
+    ReportWriter& operator<<(long long v) { return write_signed(v); }
+    ReportWriter& operator<<(unsigned v) { return write_unsigned(v); }
+    ReportWriter& operator<<(unsigned long v) { return write_unsigned(v); }
+    ReportWriter& operator<<(unsigned long long v) { return write_unsigned(v); }
+    ReportWriter& operator<<(double v);
+    ReportWriter& operator<<(std::ios_base& (*manip)(std::ios_base&));
+
+    ReportWriter& write(const char* data, size_t len);
+
+    // 立即提交已格式化的内容
+    void commit();
+
+private:
+    ReportWriter(const ReportWriter&) = delete;
+    ReportWriter& operator=(const ReportWriter&) = delete;
+
+    ReportWriter& write_signed(long long v);
+    ReportWriter& write_unsigned(unsigned long long v);
+
+    char buffer_[AsyncReporter::kRecordSize];
+    size_t len_;
+    bool hex_;
+    std::string overflow_;  // 超长记录已格式化的前半部分（很少用到）
+};
+
+#endif // REPORT_SINK_H
@@ -0,0 +1,90 @@
+#ifndef RESOURCE_TRACKER_H
+#define RESOURCE_TRACKER_H
+
+#include <stdint.h>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include "graph.h"
+
+// ============================================
+// 多单位资源：信号量、计数资源池、屏障
+// 这些资源没有唯一的持有者，不能放进 lock_owners_，
+// 检测时作为资源分配图（见 graph.h）的资源顶点和"或"等待加入等待图。
+//
+// - 计数资源（信号量 / 资源池）：单位总数已知、且单位只由获取它的线程归还时，
+//   持有关系可信，等待者作为请求边加入图；一旦出现"非持有者归还"（生产者 / 消费者式的信号量），
+//   或者根本没有持有者，任何线程都可能补充单位，不再据此判定死锁。
+//   sem_init 的信号量没有声明用法，任何线程随时可能 post：等待者自己持有全部单位
+//   （有界缓冲区的生产者在消费者第一次 post 之前就是这样）不算证据，
+//   只有还有其他线程持有单位时才加入请求边，环必须经过其他被阻塞的线程。
+//   资源池经 define() 声明后单位只能由持有者归还，不受此限制。
+// - 屏障：参与者集合从历次到达中学习。学到的参与者恰好等于屏障人数时，
+//   等在屏障上的线程等待每一个尚未到达的参与者（普通的"与"边）——
+//   屏障要全部到达才放行，其中任何一个被阻塞在环上都是死锁。
+//   参与者多于人数（工作线程轮换）时，任何一个未到达的线程都可能替别人到达，不加边。
+//
+// 资源池集成：define() 登记单位数，阻塞获取前后调用 acquire_begin / acquire_end，归还时 release()。
+// ============================================
+class ResourceTracker {
+public:
+    // ---------- 计数资源（信号量包装与资源池共用） ----------
+    void define(uint64_t resource, uint32_t units, const char* name = nullptr);
+    // sem_init 登记的信号量（见类注释）
+    void define_semaphore(uint64_t resource, uint32_t units);
+    void remove(uint64_t resource);
+    void acquire_begin(uint64_t thread_id, uint64_t resource, uint32_t units, const char* site);
+    void acquire_end(uint64_t thread_id, uint64_t resource, uint32_t units, bool acquired);
+    void release(uint64_t thread_id, uint64_t resource, uint32_t units);
+
+    // ---------- 屏障 ----------
+    void barrier_init(uint64_t barrier, uint32_t count);
+    void barrier_destroy(uint64_t barrier);
+    void barrier_wait_begin(uint64_t thread_id, uint64_t barrier);
+    void barrier_wait_end(uint64_t thread_id, uint64_t barrier);
+
+    // ---------- 线程退出 ----------
+    // 删除它的等待、持有的单位（不归还：单位随线程一起丢失）和屏障参与者身份
+    void forget_thread(uint64_t thread_id);
+
+    // ---------- 检测线程 ----------
+    // 把可判定的资源等待加入等待图
+    void add_to_graph(DirectedGraph& graph) const;
+
+    // 描述线程正在等什么（用于死锁报告）；不在资源上等待时返回 false
+    bool describe_wait(uint64_t thread_id, std::string& out) const;
+
+private:
+    struct Resource {
+        const char* name;
+        bool counted;                          // 持有关系可信（见类注释）
+        bool declared;                         // 经 define() 声明的资源池
+        uint32_t free_units;
+        std::map<uint64_t, uint32_t> holders;  // 线程 → 持有单位数
+
+        Resource() : name(nullptr), counted(false), declared(false), free_units(0) {}
+    };
+
+    struct ResourceWait {
+        uint64_t resource;
+        uint32_t units;
+        const char* site;
+    };
+
+    struct Barrier {
+        uint32_t count;
+        std::set<uint64_t> participants;       // 到达过的线程
+        std::set<uint64_t> waiting;            // 正在屏障上等待的线程
+
+        Barrier() : count(0) {}
+    };
+
+    mutable std::mutex mutex_;
+    std::map<uint64_t, Resource> resources_;
+    std::map<uint64_t, ResourceWait> waits_;   // 等待者 → 资源
+    std::map<uint64_t, Barrier> barriers_;
+    std::map<uint64_t, uint64_t> barrier_waits_;   // 等待者 → 屏障
+};
+
+#endif // RESOURCE_TRACKER_H
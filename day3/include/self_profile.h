@@ -0,0 +1,74 @@
+#ifndef SELF_PROFILE_H
+#define SELF_PROFILE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <mutex>
+
+// ============================================
+// 检测器自身的分阶段剖析
+// 每轮检测记录一条 PassProfile，保存在最近 kWindow 轮的滚动窗口中，
+// 按需计算各指标的 p50 / p99 / max。
+// ============================================
+enum PassMetric {
+    PASS_TOTAL_NS = 0,        // 整轮耗时（即 mutex_graph_ 的持有时间）
+    PASS_SNAPSHOT_NS,         // get_snapshot 耗时
+    PASS_BUILD_NS,            // 建图耗时
+    PASS_CYCLE_NS,            // DirectedGraph::has_cycle 耗时
+    PASS_HOLD_OWNERS_NS,      // 快照期间 mutex_lock_owners_ 持有时间
+    PASS_HOLD_WAITING_NS,     // 快照期间 mutex_thread_waiting_ 持有时间
+    PASS_HOLD_STACKS_NS,      // 快照期间 mutex_thread_stacks_ 持有时间
+    PASS_VERTICES,            // 等待图顶点数
+    PASS_EDGES,               // 等待图边数
+    PASS_BYTES_COPIED,        // 快照拷贝的字节数（估算，含 map 节点开销）
+    PASS_METRIC_COUNT
+};
+
+struct PassProfile {
+    uint64_t values[PASS_METRIC_COUNT];
+
+    PassProfile() { clear(); }
+    void clear() {
+        for (size_t i = 0; i < PASS_METRIC_COUNT; i++) {
+            values[i] = 0;
+        }
+    }
+    uint64_t& operator[](PassMetric m) { return values[m]; }
+    uint64_t operator[](PassMetric m) const { return values[m]; }
+};
+
+struct MetricSummary {
+    uint64_t p50;
+    uint64_t p99;
+    uint64_t max;
+};
+
+struct SelfProfileSummary {
+    size_t passes;                                 // 窗口内的检测轮数
+    MetricSummary metrics[PASS_METRIC_COUNT];
+};
+
+class SelfProfileWindow {
+public:
+    static const size_t kWindow = 256;
+
+    SelfProfileWindow() : count_(0) {}
+
+    void add(const PassProfile& pass);
+    SelfProfileSummary summary() const;
+
+    // 累计记录过的轮数
+    uint64_t passes() const {
+        std::lock_guard<std::mutex> guard(mutex_);
+        return count_;
+    }
+
+    static const char* metric_name(PassMetric metric);
+
+private:
+    PassProfile ring_[kWindow];
+    uint64_t count_;
+    mutable std::mutex mutex_;
+};
+
+#endif // SELF_PROFILE_H
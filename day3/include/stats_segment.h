@@ -0,0 +1,191 @@
+#ifndef STATS_SEGMENT_H
+#define STATS_SEGMENT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <string>
+#include <vector>
+
+// 段内的原子变量会被另一个进程直接读取，必须是无锁实现（不依赖进程内的锁表）
+#if ATOMIC_LLONG_LOCK_FREE != 2
+#error "stats segment requires lock-free 64-bit atomics"
+#endif
+
+// ============================================
+// 共享内存统计段
+// 检测器把计数器、等待图摘要、最久的等待和最近的死锁发布到
+// shm_open 创建的命名段中（默认 "/deadlock_detector.<pid>"），
+// ddstat 等外部工具以只读方式 mmap 同一段，直接读取，不与目标进程做任何交互。
+//
+// 一致性：单写者顺序锁。写者（检测线程，持有 mutex_graph_）写前把 seq 加成奇数、
+// 写完加成偶数；读者读前后比较 seq，不一致或为奇数就重试。
+// 读者永远不写段、不取锁，目标进程感知不到读者的存在。
+//
+// 布局变化时递增 kStatsSegmentVersion；读者据 version 和 segment_size 拒绝不认识的段。
+// ============================================
+static const uint32_t kStatsSegmentMagic = 0x54534444;   // "DDST"
+static const uint32_t kStatsSegmentVersion = 2;
+
+static const size_t kSegEdges = 64;          // 发布的等待边条数上限
+static const size_t kSegOldestWaits = 16;    // 发布的最久等待条数
+static const size_t kSegDetections = 8;      // 最近死锁环形缓冲大小
+static const size_t kSegCycleThreads = 8;    // 每条死锁记录保存的线程数上限
+
+// 计数器下标（只能在末尾追加；删除或重排需要递增版本号）
+enum SegCounter {
+    SEG_LOCK_BEFORE = 0,
+    SEG_LOCK_AFTER,
+    SEG_UNLOCK,
+    SEG_CONTENDED,
+    SEG_DETECTIONS,
+    SEG_DEADLOCKS,
+    SEG_SCAN_NS_TOTAL,
+    SEG_LAST_SCAN_NS,
+    SEG_MAX_SCAN_NS,
+    SEG_LOCK_OWNERS,          // 最近一次快照：被持有的锁数
+    SEG_WAITING_THREADS,      // 最近一次快照：等待中的线程数
+    SEG_GRAPH_NODES,
+    SEG_GRAPH_EDGES,
+    SEG_REGISTERED_THREADS,
+    SEG_REPORTS_DROPPED,
+    SEG_INTERVAL_MS,          // 当前检测间隔
+    SEG_COUNTER_COUNT
+};
+
+// 一条等待：线程 → 锁 → 持有者（owner_thread 为 0 表示没有记录到持有者）
+struct SegWait {
+    std::atomic<uint64_t> thread_id;
+    std::atomic<uint64_t> lock_addr;
+    std::atomic<uint64_t> owner_thread;
+    std::atomic<uint64_t> waited_ns;
+};
+
+// 一次死锁检测结果
+struct SegDetection {
+    std::atomic<uint64_t> wall_time_s;        // time(nullptr)
+    std::atomic<uint64_t> thread_count;       // 等待图中的线程数
+    std::atomic<uint64_t> threads[kSegCycleThreads];
+};
+
+struct StatsSegment {
+    // ---------- 头部：创建时写入，之后不变 ----------
+    std::atomic<uint32_t> magic;              // 最后写入，读者见到 magic 即可信任其余头部
+    uint32_t version;
+    uint32_t segment_size;                    // sizeof(StatsSegment)
+    uint32_t pid;
+    uint64_t created_wall_s;
+
+    // ---------- 顺序锁保护的数据 ----------
+    std::atomic<uint64_t> seq;                // 奇数表示正在写
+    std::atomic<uint64_t> publish_count;      // 发布次数
+    std::atomic<uint64_t> publish_wall_s;     // 最近一次发布的时间
+    std::atomic<uint64_t> publish_wall_ns;    // 同上，纳秒精度（CLOCK_REALTIME），供读者计算速率
+
+    std::atomic<uint64_t> counters[SEG_COUNTER_COUNT];
+
+    std::atomic<uint64_t> edge_total;         // 等待图中全部边数
+    std::atomic<uint64_t> edge_count;         // edges 中的有效条数
+    SegWait edges[kSegEdges];
+
+    std::atomic<uint64_t> oldest_count;       // oldest 中的有效条数（按等待时长降序）
+    SegWait oldest[kSegOldestWaits];
+
+    std::atomic<uint64_t> detection_total;    // 累计记录的死锁数，最近一条在 (total-1) % kSegDetections
+    SegDetection detections[kSegDetections];
+};
+
+// 段的默认名字
+std::string default_stats_segment_name(uint32_t pid);
+
+// ============================================
+// 普通内存中的一份快照（读者的拷贝 / 写者的输入）
+// ============================================
+struct LiveWait {
+    uint64_t thread_id;
+    uint64_t lock_addr;
+    uint64_t owner_thread;
+    uint64_t waited_ns;
+};
+
+struct LiveDetection {
+    uint64_t wall_time_s;
+    uint64_t thread_count;
+    std::vector<uint64_t> threads;
+};
+
+struct StatsSnapshot {
+    uint32_t pid;
+    uint64_t created_wall_s;
+    uint64_t publish_count;
+    uint64_t publish_wall_s;
+    uint64_t publish_wall_ns;
+    uint64_t counters[SEG_COUNTER_COUNT];
+    uint64_t edge_total;
+    std::vector<LiveWait> edges;
+    std::vector<LiveWait> oldest;
+    uint64_t detection_total;
+    std::vector<LiveDetection> detections;    // 最新的在前
+};
+
+// ============================================
+// 写者：只在检测器内部使用，所有调用由调用方串行化
+// ============================================
+class StatsPublisher {
+public:
+    StatsPublisher() : segment_(nullptr) {}
+    ~StatsPublisher() { close(); }
+
+    // 创建（或截断重建）命名段并映射；失败返回 false
+    bool open(const std::string& name);
+    // 解除映射并删除段名
+    void close();
+    bool is_open() const { return segment_ != nullptr; }
+    const std::string& name() const { return name_; }
+
+    // 发布一次：计数器 + 等待列表（edges 取有持有者的等待，oldest 取等待最久的）
+    void publish(const uint64_t counters[SEG_COUNTER_COUNT],
+                 const std::vector<LiveWait>& waits, uint64_t edge_total);
+
+    // 追加一条死锁记录
+    void add_detection(const std::vector<uint64_t>& threads);
+
+private:
+    StatsPublisher(const StatsPublisher&) = delete;
+    StatsPublisher& operator=(const StatsPublisher&) = delete;
+
+    void write_begin();
+    void write_end();
+
+    StatsSegment* segment_;
+    std::string name_;
+};
+
+// ============================================
+// 读者：以只读方式映射别的进程发布的段
+// ============================================
+class StatsSegmentReader {
+public:
+    StatsSegmentReader() : segment_(nullptr) {}
+    ~StatsSegmentReader() { close(); }
+
+    // 映射并校验段；失败时 error() 给出原因
+    bool open(const std::string& name);
+    void close();
+    const std::string& error() const { return error_; }
+
+    // 读取一份一致的快照；写者长时间处于写状态时返回 false
+    bool read(StatsSnapshot& out, int max_attempts = 1000) const;
+
+    // 目标进程是否还活着（kill(pid, 0)）
+    bool owner_alive() const;
+
+private:
+    StatsSegmentReader(const StatsSegmentReader&) = delete;
+    StatsSegmentReader& operator=(const StatsSegmentReader&) = delete;
+
+    const StatsSegment* segment_;
+    std::string error_;
+};
+
+#endif // STATS_SEGMENT_H
@@ -0,0 +1,201 @@
+#ifndef THREAD_REGISTRY_H
+#define THREAD_REGISTRY_H
+
+#include <pthread.h>
+#include <time.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+// ============================================
+// 每线程状态槽
+// 只由所属线程写，其他线程（检测线程）通过顺序锁无锁读取。
+// 热路径上不做任何跨线程同步。
+// ============================================
+static const size_t kMaxThreadSlots = 4096;  // 同时存活的线程上限（线程序号 < 该值）
+static const size_t kMaxHeldLocks = 32;      // 单线程同时持有的锁上限（超出部分不跟踪）
+static const size_t kMaxHeldSpins = 4;       // 单线程同时持有的自旋锁上限（超出部分不跟踪）
+
+// 线程当前持有的一把锁
+struct HeldLockInfo {
+    uint64_t lock_addr;
+    uint64_t acquired_ns;   // 获取时间（未启用计时时为 0）
+    const char* site;       // 获取位置 "file:line"（可能为空）
+};
+
+struct ThreadSlot {
+    // 槽位在序号复用时会换主人：其他线程读取 tid / handle 时要用 life_begin / life_unchanged 校验
+    std::atomic<uint64_t> tid;    // 内核线程 ID
+    uint32_t ordinal;             // 稠密线程序号，可作为数组/位图下标（槽位创建后不变）
+    std::atomic<pthread_t> handle;   // pthread_self()
+    uint64_t wait_begin_ns;       // 本线程当前一次加锁等待的开始时间（仅所属线程读写）
+
+    ThreadSlot() : tid(0), ordinal(0), handle(pthread_t()), wait_begin_ns(0), life_seq_(0), held_seq_(0),
+                   held_count_(0) {
+        for (size_t i = 0; i < kMaxHeldSpins; i++) {
+            spin_held_[i].store(0, std::memory_order_relaxed);
+        }
+    }
+
+    // ---------- 槽位身份（顺序锁：奇数表示属于一个存活线程） ----------
+    // 读者：life = life_begin()，读 tid / handle / 持有记录，再 life_unchanged(life) 确认期间没有换主人
+    uint32_t life_begin() const { return life_seq_.load(std::memory_order_acquire); }
+    bool life_unchanged(uint32_t life) const {
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return (life & 1) && life_seq_.load(std::memory_order_relaxed) == life;
+    }
+    // 注册表在分配 / 注销槽位时调用
+    void life_start(uint64_t thread_id, pthread_t self) {
+        tid.store(thread_id, std::memory_order_relaxed);
+        handle.store(self, std::memory_order_relaxed);
+        life_seq_.fetch_add(1, std::memory_order_release);
+    }
+    void life_end() {
+        life_seq_.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+
+    // ---------- 所属线程调用 ----------
+    void push_held(uint64_t lock_addr, uint64_t acquired_ns, const char* site);
+    // 移除一把锁，返回 false 表示未找到；找到时通过 info 返回获取信息
+    bool pop_held(uint64_t lock_addr, HeldLockInfo& info);
+    // 本线程是否持有该锁（只读自己的数据，无需同步）
+    bool holds(uint64_t lock_addr) const;
+    uint32_t held_count() const { return held_count_.load(std::memory_order_relaxed); }
+
+    // 自旋锁持有记录：只有锁地址，获取时一次写入，不走顺序锁
+    void push_spin(uint64_t lock_addr) {
+        for (size_t i = 0; i < kMaxHeldSpins; i++) {
+            if (spin_held_[i].load(std::memory_order_relaxed) == 0) {
+                spin_held_[i].store(lock_addr, std::memory_order_release);
+                return;
+            }
+        }
+    }
+    void pop_spin(uint64_t lock_addr) {
+        for (size_t i = 0; i < kMaxHeldSpins; i++) {
+            if (spin_held_[i].load(std::memory_order_relaxed) == lock_addr) {
+                spin_held_[i].store(0, std::memory_order_release);
+                return;
+            }
+        }
+    }
+
+    // 线程退出：清空持有记录，槽位留给下一个使用该序号的线程
+    void clear_held();
+
+    // ---------- 任意线程调用 ----------
+    // 读取一致的持有锁快照（顺序锁，写者繁忙时重试）
+    void read_held(std::vector<HeldLockInfo>& out) const;
+    
+    bool holds_spin(uint64_t lock_addr) const {
+        for (size_t i = 0; i < kMaxHeldSpins; i++) {
+            if (spin_held_[i].load(std::memory_order_acquire) == lock_addr) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+private:
+    struct HeldEntry {
+        std::atomic<uint64_t> lock_addr;
+        std::atomic<uint64_t> acquired_ns;
+        std::atomic<const char*> site;
+    };
+
+    void write_begin() { held_seq_.fetch_add(1, std::memory_order_relaxed); std::atomic_thread_fence(std::memory_order_release); }
+    void write_end() { held_seq_.fetch_add(1, std::memory_order_release); }
+
+    std::atomic<uint32_t> life_seq_;    // 奇数表示槽位属于一个存活线程，每次换主人加 2
+    std::atomic<uint32_t> held_seq_;    // 奇数表示正在修改
+    std::atomic<uint32_t> held_count_;
+    HeldEntry held_[kMaxHeldLocks];
+    std::atomic<uint64_t> spin_held_[kMaxHeldSpins];
+};
+
+// ============================================
+// 线程注册表
+// 线程第一次经过钩子时注册并分配稠密序号，槽位指针缓存在 thread_local 中。
+// 注册时同时设置 pthread 线程私有数据，线程退出时由其析构函数调用退出钩子、
+// 注销槽位并回收序号：序号和槽位对象都被后来的线程复用，内存只随同时存活的线程数增长。
+// 槽位对象从不释放（检测线程可能正在无锁读取），只在同一序号上复用。
+// ============================================
+class ThreadRegistry {
+public:
+    static ThreadRegistry& instance() {
+        static ThreadRegistry registry;
+        return registry;
+    }
+
+    // 当前线程的槽位（首次调用时注册）；槽位耗尽时返回 nullptr
+    static ThreadSlot* current() {
+        ThreadSlot*& slot = cached_slot();
+        if (!slot) {
+            slot = instance().register_current();
+        }
+        return slot;
+    }
+
+    // 线程退出钩子：在退出线程上、槽位注销之前调用（检测器借此清除该线程的状态）
+    typedef void (*ExitHook)(ThreadSlot& slot);
+    void set_exit_hook(ExitHook hook) { exit_hook_.store(hook); }
+
+    // 遍历所有已注册线程（检测线程使用）
+    template <typename Func>
+    void for_each(Func func) const {
+        uint32_t limit = high_water_.load(std::memory_order_acquire);
+        for (uint32_t i = 0; i < limit; i++) {
+            ThreadSlot* slot = slots_[i].load(std::memory_order_acquire);
+            if (slot) {
+                func(*slot);
+            }
+        }
+    }
+
+    // 按序号取槽位（不存在时返回 nullptr）
+    ThreadSlot* by_ordinal(uint32_t ordinal) const {
+        return ordinal < kMaxThreadSlots ? slots_[ordinal].load(std::memory_order_acquire) : nullptr;
+    }
+
+    // 以下查找都是线性扫描，仅供慢路径（检测线程）使用；
+    // 返回的是校验过的内核线程 ID 而不是槽位指针，槽位随时可能被新线程复用，0 表示没找到
+    uint64_t find_tid_by_handle(pthread_t handle) const;
+    // 持有该自旋锁的线程
+    uint64_t find_spin_holder(uint64_t lock_addr) const;
+    // 读取某个线程的持有锁快照，线程未注册（或已退出）时返回 false
+    bool read_held_of(uint64_t tid, std::vector<HeldLockInfo>& out) const;
+    // 存活线程的 CPU 时钟：在注册锁内确认槽位仍属于该线程（线程还没执行到注销，pthread_t 有效）
+    bool cpu_clock_of(uint64_t tid, clockid_t& clock);
+
+    // 已注册的线程数
+    size_t size() const;
+
+private:
+    ThreadRegistry();
+    ThreadRegistry(const ThreadRegistry&) = delete;
+    ThreadRegistry& operator=(const ThreadRegistry&) = delete;
+
+    // 函数内的 thread_local 指针是常量初始化的，访问时不经过 TLS 包装函数
+    static ThreadSlot*& cached_slot() {
+        static thread_local ThreadSlot* slot = nullptr;
+        return slot;
+    }
+
+    ThreadSlot* register_current();
+    void unregister(ThreadSlot* slot);
+    static void on_thread_exit(void* slot);
+
+    std::atomic<ThreadSlot*> slots_[kMaxThreadSlots];
+    ThreadSlot* storage_[kMaxThreadSlots];  // 每个序号分配过的槽位对象（受 mutex_register_ 保护）
+    std::vector<uint32_t> free_ordinals_;   // 已退出线程留下的序号（受 mutex_register_ 保护）
+    std::atomic<uint32_t> high_water_;   // 已分配过的最大序号 + 1
+    std::mutex mutex_register_;          // 只在注册 / 注销（慢路径）时使用
+    pthread_key_t exit_key_;
+    bool exit_key_valid_;
+    std::atomic<ExitHook> exit_hook_;
+};
+
+#endif // THREAD_REGISTRY_H
@@ -0,0 +1,73 @@
+#ifndef THREAD_WAITS_H
+#define THREAD_WAITS_H
+
+#include <pthread.h>
+#include <stdint.h>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+// ============================================
+// 线程 → 线程 的等待（不经过锁）
+// - pthread_join：等待者 → 被 join 的线程；
+// - 线程池任务依赖：等待任务完成（例如 future.get()）的线程 →
+//     任务已开始：执行它的线程；
+//     任务还在队列中：线程池中的工作线程，"或"语义——任一工作线程空出来即可
+//     （有空闲工作线程时不加边，它会取走任务）。
+// 这些边与锁等待边放进同一张等待图，一次扫描即可发现
+// "持锁 join 需要该锁的线程"、"工作线程都在等排在自己后面的任务" 这类混合环。
+//
+// 线程池集成：工作线程启动 / 退出时调用 worker_begin / worker_end，
+// 提交任务时 task_submit，执行前后 task_begin / task_end，
+// 阻塞等待任务结果前后 task_wait_begin / task_wait_end。task_id 由调用方选定（例如任务对象地址）。
+// ============================================
+class ThreadWaitTracker {
+public:
+    typedef std::pair<uint64_t, uint64_t> Edge;   // (等待者, 被等待者)
+
+    // ---------- pthread_join（由检测器的 join 包装调用） ----------
+    void join_begin(uint64_t thread_id, pthread_t target, const char* site);
+    void join_end(uint64_t thread_id);
+
+    // ---------- 线程池（作用于当前线程） ----------
+    void worker_begin(uint64_t pool_id);
+    void worker_end(uint64_t pool_id);
+    void task_submit(uint64_t pool_id, uint64_t task_id);
+    void task_begin(uint64_t task_id);
+    void task_end(uint64_t task_id);
+    void task_wait_begin(uint64_t task_id);
+    void task_wait_end(uint64_t task_id);
+
+    // 线程退出：删除它的等待、工作线程身份和它正在执行（已无法完成）的任务
+    void forget_thread(uint64_t thread_id);
+
+    // ---------- 检测线程 ----------
+    // 当前所有线程 → 线程 的等待边；wait_any 收集出边为"或"语义的等待者
+    void collect_edges(std::vector<Edge>& edges, std::vector<uint64_t>& wait_any) const;
+
+    // 描述线程正在等什么（用于死锁报告）；不在线程间等待时返回 false
+    bool describe_wait(uint64_t thread_id, std::string& out) const;
+
+private:
+    struct JoinWait {
+        pthread_t target;
+        const char* site;
+    };
+
+    struct TaskState {
+        uint64_t pool_id;
+        uint64_t runner;       // 执行中的线程，0 表示仍在队列中
+    };
+
+    mutable std::mutex mutex_;
+    std::map<uint64_t, JoinWait> joins_;                // 等待者 → join 目标
+    std::map<uint64_t, std::set<uint64_t> > pools_;     // 线程池 → 工作线程
+    std::map<uint64_t, uint64_t> worker_task_;          // 工作线程 → 正在执行的任务（0 表示空闲）
+    std::map<uint64_t, TaskState> tasks_;               // 已提交、未完成的任务
+    std::map<uint64_t, uint64_t> task_waits_;           // 等待者 → 任务
+};
+
+#endif // THREAD_WAITS_H
@@ -0,0 +1,103 @@
+#ifndef TRACE_FORMAT_H
+#define TRACE_FORMAT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+// ============================================
+// 锁事件追踪文件格式（记录器与离线工具共用）
+//
+//   [TraceFileHeader]                  4096 字节
+//   [TraceSite x max_sites]            调用位置字符串表，site_id = 下标 + 1（0 表示未知）
+//   [环 0][环 1]...[环 ring_count-1]   每个环 ring_stride 字节，按页对齐
+//
+// 每个环 = TraceRingHeader + ring_capacity 个 TraceEvent，环下标即线程序号。
+// 写者先写事件再用 release 递增 head，因此下标 < head 的事件都是完整的；
+// 环回绕后 head % ring_capacity 处的槽位可能正在被覆盖，读者应丢弃它，
+// 即有效区间为 [max(0, head - ring_capacity + 1), head)。
+//
+// 文件由 MAP_SHARED 映射写入，进程崩溃或被 SIGKILL 后数据仍在页缓存中，
+// 可直接作为"黑匣子"读取。
+// ============================================
+static const char kTraceMagic[8] = {'D', 'D', 'T', 'R', 'A', 'C', 'E', '\0'};
+static const uint32_t kTraceVersion = 1;
+static const size_t kTraceHeaderSize = 4096;
+static const size_t kTraceSiteLen = 128;
+
+// 事件类型（只能在末尾追加）
+enum TraceEventKind {
+    TRACE_NONE = 0,
+    TRACE_LOCK_BEFORE,        // 开始等待锁
+    TRACE_LOCK_AFTER,         // 获得锁
+    TRACE_UNLOCK,             // 释放锁
+    TRACE_TRYLOCK_FAIL,       // trylock / timedlock 未能获得锁
+    TRACE_THREAD_START,       // 线程开始写本环；lock_addr 字段为内核线程 ID
+    TRACE_SYNC_RELEASE,       // 同步"发布"（创建线程、线程退出、signal、到达屏障）；lock_addr 为同步对象
+    TRACE_SYNC_ACQUIRE,       // 同步"获取"（线程开始运行、join 返回、wait 返回、离开屏障）
+    TRACE_EVENT_KIND_COUNT
+};
+
+// 同步事件的来源（TraceEvent::aux），只用于显示；happens-before 分析只看 release / acquire
+enum TraceSyncKind {
+    SYNC_NONE = 0,
+    SYNC_THREAD_CREATE,       // 对象为创建令牌：父线程 release，子线程开始时 acquire
+    SYNC_THREAD_EXIT,         // 对象为 pthread_t：子线程结束时 release，join 返回后 acquire
+    SYNC_COND,                // 对象为条件变量地址
+    SYNC_BARRIER,             // 对象为屏障地址
+    SYNC_SEMAPHORE            // 对象为信号量地址：sem_post release，等待成功后 acquire
+};
+
+// 锁事件的 aux：读写锁的读锁（共享获取）
+static const uint16_t kTraceLockShared = 1;
+
+// 24 字节定长事件
+struct TraceEvent {
+    uint64_t ticks;           // 时间戳（TSC 或单调时钟纳秒，见文件头换算参数）
+    uint64_t lock_addr;
+    uint32_t site_id;
+    uint16_t kind;
+    uint16_t aux;             // 同步事件为 TraceSyncKind，锁事件为 kTraceLockShared 或 0
+};
+
+struct TraceSite {
+    char text[kTraceSiteLen];   // "file:line"，以 '\0' 结尾
+};
+
+struct TraceRingHeader {
+    std::atomic<uint64_t> head;       // 累计写入的事件数
+    std::atomic<uint64_t> tid;        // 最近一个使用本环的线程
+    uint32_t ordinal;
+    uint32_t reserved;
+    uint64_t padding[5];              // 补齐到 64 字节，事件数组按缓存行对齐
+};
+
+struct TraceFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;
+    uint32_t event_size;              // sizeof(TraceEvent)
+    uint32_t ring_count;
+    uint32_t ring_capacity;           // 每环事件数（2 的幂）
+    uint32_t max_sites;
+    uint64_t sites_offset;
+    uint64_t rings_offset;
+    uint64_t ring_stride;
+    uint64_t file_size;
+
+    // 时间换算：ns = start_mono_ns + (ticks - start_ticks) / ticks_per_ns
+    double ticks_per_ns;
+    uint64_t start_ticks;
+    uint64_t start_mono_ns;
+    uint64_t start_wall_ns;           // CLOCK_REALTIME
+    uint32_t pid;
+    uint32_t reserved;
+
+    std::atomic<uint32_t> site_count; // 已写入的站点数（先写字符串再 release 递增）
+};
+
+static_assert(sizeof(TraceEvent) == 24, "trace event layout changed");
+static_assert(sizeof(TraceRingHeader) == 64, "trace ring header layout changed");
+static_assert(sizeof(TraceFileHeader) <= kTraceHeaderSize, "trace header too large");
+
+#endif // TRACE_FORMAT_H
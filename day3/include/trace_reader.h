@@ -0,0 +1,149 @@
+#ifndef TRACE_READER_H
+#define TRACE_READER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+#include "trace_format.h"
+
+// ============================================
+// 单个环的只读视图
+// 有效事件为下标 [begin, end)，按下标取 at(i)（内部对容量取模）。
+// 环中可能先后有多个线程（线程序号被复用），以 THREAD_START 事件分界；
+// 环回绕后第一个 THREAD_START 之前的事件属于未知的更早线程，记为 unknown_tid()。
+// ============================================
+struct TraceRingView {
+    uint32_t ring;
+    const TraceEvent* events;
+    uint64_t mask;
+    uint64_t begin;
+    uint64_t end;
+    uint64_t first_tid;      // begin 处事件所属的线程
+
+    const TraceEvent& at(uint64_t i) const { return events[i & mask]; }
+    uint64_t size() const { return end - begin; }
+
+    // 环回绕导致线程未知时使用的合成线程 ID（最高位置 1，低位为环号）
+    static uint64_t unknown_tid(uint32_t ring) { return (1ull << 63) | ring; }
+    static bool is_unknown_tid(uint64_t tid) { return (tid >> 63) != 0; }
+};
+
+// ============================================
+// 按线程解码的事件流：跳过 THREAD_START，维护当前线程 ID
+// ============================================
+class TraceRingCursor {
+public:
+    explicit TraceRingCursor(const TraceRingView& view)
+        : view_(view), next_(view.begin), tid_(view.first_tid) {}
+
+    // 取下一个锁事件；返回 false 表示环已读完
+    bool next(const TraceEvent*& event, uint64_t& tid) {
+        while (next_ < view_.end) {
+            const TraceEvent& ev = view_.at(next_++);
+            if (ev.kind == TRACE_THREAD_START) {
+                tid_ = ev.lock_addr;
+                continue;
+            }
+            event = &ev;
+            tid = tid_;
+            return true;
+        }
+        return false;
+    }
+
+    // 下一个锁事件的时间戳（不消费）；没有时返回 false
+    bool peek_ticks(uint64_t& ticks) {
+        while (next_ < view_.end) {
+            const TraceEvent& ev = view_.at(next_);
+            if (ev.kind == TRACE_THREAD_START) {
+                tid_ = ev.lock_addr;
+                next_++;
+                continue;
+            }
+            ticks = ev.ticks;
+            return true;
+        }
+        return false;
+    }
+
+    uint32_t ring() const { return view_.ring; }
+
+private:
+    TraceRingView view_;
+    uint64_t next_;
+    uint64_t tid_;
+};
+
+// ============================================
+// 追踪文件读取器：只读 mmap，不拷贝事件
+// 可以读取正在写入的文件或崩溃后遗留的文件
+// ============================================
+class TraceReader {
+public:
+    TraceReader() : base_(nullptr), size_(0), header_(nullptr) {}
+    ~TraceReader() { close(); }
+
+    bool open(const std::string& path);
+    void close();
+    const std::string& error() const { return error_; }
+    const std::string& path() const { return path_; }
+
+    const TraceFileHeader& header() const { return *header_; }
+    uint32_t ring_count() const { return header_->ring_count; }
+
+    // 环视图（head 为 0 的空环返回 size() == 0 的视图）
+    TraceRingView ring(uint32_t index) const;
+
+    // 调用位置字符串，未知时返回 "?"
+    const char* site(uint32_t site_id) const;
+
+    // tick 换算为相对追踪开始的纳秒
+    uint64_t to_ns(uint64_t ticks) const {
+        if (ticks <= header_->start_ticks) {
+            return 0;
+        }
+        return static_cast<uint64_t>(static_cast<double>(ticks - header_->start_ticks) / header_->ticks_per_ns);
+    }
+
+    // tick 差换算为纳秒
+    uint64_t ticks_to_ns(uint64_t delta) const {
+        return static_cast<uint64_t>(static_cast<double>(delta) / header_->ticks_per_ns);
+    }
+
+private:
+    TraceReader(const TraceReader&) = delete;
+    TraceReader& operator=(const TraceReader&) = delete;
+
+    const char* base_;
+    size_t size_;
+    const TraceFileHeader* header_;
+    std::string path_;
+    std::string error_;
+};
+
+// ============================================
+// 多环按时间戳归并（最小堆），得到全局有序的事件流
+// 各环内部按时间有序；跨 CPU 的 TSC 在现代 x86 上是同步的
+// ============================================
+class TraceMerger {
+public:
+    explicit TraceMerger(const TraceReader& reader);
+
+    // 取全局下一个事件；返回 false 表示全部读完
+    bool next(const TraceEvent*& event, uint64_t& tid, uint32_t& ring);
+
+private:
+    struct HeapItem {
+        uint64_t ticks;
+        size_t cursor;
+    };
+
+    void push(size_t cursor);
+    void sift_down(size_t pos);
+
+    std::vector<TraceRingCursor> cursors_;
+    std::vector<HeapItem> heap_;
+};
+
+#endif // TRACE_READER_H
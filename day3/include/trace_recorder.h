@@ -0,0 +1,132 @@
+#ifndef TRACE_RECORDER_H
+#define TRACE_RECORDER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "trace_format.h"
+#include "thread_registry.h"
+#include "lock_clock.h"
+
+// ============================================
+// 追踪配置
+// ============================================
+struct TraceConfig {
+    std::string path;              // 追踪文件路径
+    uint32_t max_threads;          // 环数：线程序号 >= 该值的线程不记录
+    uint32_t events_per_thread;    // 每环事件数（向上取 2 的幂），写满后覆盖最旧的事件
+    uint32_t max_sites;            // 调用位置表容量，满后新位置记为 0
+
+    TraceConfig() : max_threads(256), events_per_thread(65536), max_sites(4096) {}
+};
+
+// ============================================
+// 锁事件追踪记录器（飞行记录仪）
+// 钩子把定长事件追加到本线程的环中，环位于 MAP_SHARED 映射的文件里（格式见 trace_format.h）。
+// 热路径：一次原子读 + 写 24 字节 + 一次 release 存储，没有系统调用，也不与其他线程同步。
+// 调用位置按字符串字面量指针缓存在 thread_local 中，
+// 只有某线程第一次遇到某个位置时才进入全局互斥锁登记。
+// ============================================
+class TraceRecorder {
+public:
+    TraceRecorder() : active_(nullptr) {}
+    ~TraceRecorder() { close(); }
+
+    // 创建追踪文件并开始记录；已在记录时返回 false
+    bool open(const TraceConfig& config);
+
+    // 停止记录并把映射刷回文件。
+    // 映射在进程生命周期内保留：其他线程可能正在写最后一个事件，立即解除映射不安全
+    void close();
+
+    bool enabled() const { return active_.load(std::memory_order_relaxed) != nullptr; }
+
+    // 当前（或最近一次）追踪文件路径
+    std::string path() const;
+
+    // 记录一个事件（钩子调用）
+    void record(ThreadSlot* slot, uint16_t kind, uint64_t lock_addr, const char* site, uint16_t aux = 0) {
+        Mapping* m = active_.load(std::memory_order_acquire);
+        if (!m || !slot) {
+            return;
+        }
+        LocalState& local = local_state();
+        if (local.mapping != m) {
+            attach(m, *slot, local);
+        }
+        if (!local.ring) {
+            return;
+        }
+        append(local, kind, lock_addr, site ? site_id(local, site) : 0, aux);
+    }
+
+private:
+    TraceRecorder(const TraceRecorder&) = delete;
+    TraceRecorder& operator=(const TraceRecorder&) = delete;
+
+    // 一次 open 对应的映射
+    struct Mapping {
+        char* base;
+        size_t size;
+        TraceFileHeader* header;
+        std::string path;
+        std::map<std::string, uint32_t> site_ids;   // 受 mutex_sites_ 保护
+    };
+
+    static const size_t kSiteCacheSize = 64;        // 每线程位置缓存（直接映射，2 的幂）
+
+    struct SiteCacheEntry {
+        const char* site;
+        uint32_t id;
+    };
+
+    // 每线程状态：POD，零初始化，访问时无需 TLS 构造守卫
+    struct LocalState {
+        Mapping* mapping;          // 当前绑定的映射（为空或过期时重新绑定）
+        TraceRingHeader* ring;     // nullptr 表示本线程不记录（序号超出环数）
+        TraceEvent* events;
+        uint64_t mask;
+        SiteCacheEntry sites[kSiteCacheSize];
+    };
+
+    static LocalState& local_state() {
+        static thread_local LocalState state;
+        return state;
+    }
+
+    static void append(LocalState& local, uint16_t kind, uint64_t lock_addr, uint32_t site_id,
+                       uint16_t aux = 0) {
+        uint64_t head = local.ring->head.load(std::memory_order_relaxed);
+        TraceEvent& ev = local.events[head & local.mask];
+        ev.ticks = trace_ticks();
+        ev.lock_addr = lock_addr;
+        ev.site_id = site_id;
+        ev.kind = kind;
+        ev.aux = aux;
+        local.ring->head.store(head + 1, std::memory_order_release);
+    }
+
+    uint32_t site_id(LocalState& local, const char* site) {
+        SiteCacheEntry& e = local.sites[(reinterpret_cast<uintptr_t>(site) >> 3) & (kSiteCacheSize - 1)];
+        if (e.site != site) {
+            e.id = intern_site(local.mapping, site);
+            e.site = site;
+        }
+        return e.id;
+    }
+
+    // 慢路径
+    void attach(Mapping* m, const ThreadSlot& slot, LocalState& local);
+    uint32_t intern_site(Mapping* m, const char* site);
+
+    std::atomic<Mapping*> active_;
+    std::vector<Mapping*> mappings_;    // 所有打开过的映射，受 mutex_ 保护
+    mutable std::mutex mutex_;
+    std::mutex mutex_sites_;
+};
+
+#endif // TRACE_RECORDER_H
@@ -0,0 +1,239 @@
+#ifndef TRACKED_MUTEX_H
+#define TRACKED_MUTEX_H
+
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include "deadlock_detector.h"
+
+// ============================================
+// 带检测的 C++ 互斥锁：TrackedMutex / TrackedRecursiveMutex / TrackedTimedMutex
+// 满足标准 Lockable（TimedLockable）要求，可直接用于 std::lock_guard、
+// std::unique_lock、std::lock。
+//
+// 与 pthread 宏不同，持有者和等待者数记录在锁对象内部：
+// - 先 try_lock，未竞争时不登记等待，也不更新任何全局表；
+// - 阻塞前登记等待，等待记录指向本对象的持有者字段，检测线程建图时直接读取。
+// 锁的标识是对象地址。name 用作报告中的位置，必须是静态字符串。
+// ============================================
+
+// 当前线程的内核线程 ID（缓存在 thread_local 中，避免每次加锁都做系统调用）
+inline uint64_t tracked_thread_id() {
+    static thread_local uint64_t tid = 0;
+    if (tid == 0) {
+        tid = get_thread_id();
+    }
+    return tid;
+}
+
+// 公共部分：内联的持有者 / 等待者数与检测器通知
+class TrackedLockState {
+public:
+    // 当前持有者（内核线程 ID），0 表示空闲
+    uint64_t owner() const { return owner_.load(std::memory_order_acquire); }
+
+    // 正阻塞在本锁上的线程数
+    uint32_t waiters() const { return waiters_.load(std::memory_order_relaxed); }
+
+    const char* name() const { return name_; }
+
+protected:
+    explicit TrackedLockState(const char* name) : owner_(0), waiters_(0), name_(name) {}
+
+    uint64_t lock_id() const { return reinterpret_cast<uint64_t>(this); }
+
+    void begin_wait(uint64_t tid) {
+        waiters_.fetch_add(1, std::memory_order_relaxed);
+        DeadlockDetector::instance().on_tracked_wait(tid, lock_id(), &owner_, name_);
+    }
+
+    void end_wait() { waiters_.fetch_sub(1, std::memory_order_relaxed); }
+
+    void acquired(uint64_t tid, bool waited) {
+        owner_.store(tid, std::memory_order_release);
+        DeadlockDetector::instance().on_tracked_acquired(tid, lock_id(), name_, waited);
+    }
+
+    void wait_failed(uint64_t tid) {
+        DeadlockDetector::instance().on_lock_failed(tid, lock_id(), name_, true);
+    }
+
+    // 持有者字段必须在真正解锁之前清零，否则可能覆盖下一个持有者写入的值
+    void releasing() { owner_.store(0, std::memory_order_release); }
+
+    void released(uint64_t tid) { DeadlockDetector::instance().on_tracked_released(tid, lock_id()); }
+
+    std::atomic<uint64_t> owner_;
+    std::atomic<uint32_t> waiters_;
+    const char* name_;
+};
+
+// ============================================
+// TrackedMutex：对应 std::mutex
+// ============================================
+class TrackedMutex : public TrackedLockState {
+public:
+    explicit TrackedMutex(const char* name = nullptr) : TrackedLockState(name) {}
+    TrackedMutex(const TrackedMutex&) = delete;
+    TrackedMutex& operator=(const TrackedMutex&) = delete;
+
+    void lock() {
+        uint64_t tid = tracked_thread_id();
+        if (mutex_.try_lock()) {
+            acquired(tid, false);
+            return;
+        }
+        begin_wait(tid);
+        mutex_.lock();
+        end_wait();
+        acquired(tid, true);
+    }
+
+    bool try_lock() {
+        uint64_t tid = tracked_thread_id();
+        if (!mutex_.try_lock()) {
+            DeadlockDetector::instance().on_lock_failed(tid, lock_id(), name_, false);
+            return false;
+        }
+        acquired(tid, false);
+        return true;
+    }
+
+    void unlock() {
+        releasing();
+        mutex_.unlock();
+        released(tracked_thread_id());
+    }
+
+    std::mutex::native_handle_type native_handle() { return mutex_.native_handle(); }
+
+private:
+    std::mutex mutex_;
+};
+
+// ============================================
+// TrackedRecursiveMutex：对应 std::recursive_mutex
+// 重入只增加深度，不通知检测器（不构成新的加锁顺序）
+// ============================================
+class TrackedRecursiveMutex : public TrackedLockState {
+public:
+    explicit TrackedRecursiveMutex(const char* name = nullptr) : TrackedLockState(name), depth_(0) {}
+    TrackedRecursiveMutex(const TrackedRecursiveMutex&) = delete;
+    TrackedRecursiveMutex& operator=(const TrackedRecursiveMutex&) = delete;
+
+    void lock() {
+        uint64_t tid = tracked_thread_id();
+        if (owner_.load(std::memory_order_relaxed) == tid) {
+            mutex_.lock();
+            depth_++;
+            return;
+        }
+        if (mutex_.try_lock()) {
+            depth_ = 1;
+            acquired(tid, false);
+            return;
+        }
+        begin_wait(tid);
+        mutex_.lock();
+        end_wait();
+        depth_ = 1;
+        acquired(tid, true);
+    }
+
+    bool try_lock() {
+        uint64_t tid = tracked_thread_id();
+        if (!mutex_.try_lock()) {
+            DeadlockDetector::instance().on_lock_failed(tid, lock_id(), name_, false);
+            return false;
+        }
+        if (++depth_ == 1) {
+            acquired(tid, false);
+        }
+        return true;
+    }
+
+    void unlock() {
+        if (--depth_ > 0) {
+            mutex_.unlock();
+            return;
+        }
+        releasing();
+        mutex_.unlock();
+        released(tracked_thread_id());
+    }
+
+    std::recursive_mutex::native_handle_type native_handle() { return mutex_.native_handle(); }
+
+private:
+    std::recursive_mutex mutex_;
+    uint32_t depth_;            // 只由持有者读写
+};
+
+// ============================================
+// TrackedTimedMutex：对应 std::timed_mutex，超时后撤回等待
+// ============================================
+class TrackedTimedMutex : public TrackedLockState {
+public:
+    explicit TrackedTimedMutex(const char* name = nullptr) : TrackedLockState(name) {}
+    TrackedTimedMutex(const TrackedTimedMutex&) = delete;
+    TrackedTimedMutex& operator=(const TrackedTimedMutex&) = delete;
+
+    void lock() {
+        uint64_t tid = tracked_thread_id();
+        if (mutex_.try_lock()) {
+            acquired(tid, false);
+            return;
+        }
+        begin_wait(tid);
+        mutex_.lock();
+        end_wait();
+        acquired(tid, true);
+    }
+
+    bool try_lock() {
+        uint64_t tid = tracked_thread_id();
+        if (!mutex_.try_lock()) {
+            DeadlockDetector::instance().on_lock_failed(tid, lock_id(), name_, false);
+            return false;
+        }
+        acquired(tid, false);
+        return true;
+    }
+
+    template <typename Rep, typename Period>
+    bool try_lock_for(const std::chrono::duration<Rep, Period>& timeout) {
+        return try_lock_until(std::chrono::steady_clock::now() + timeout);
+    }
+
+    template <typename Clock, typename Duration>
+    bool try_lock_until(const std::chrono::time_point<Clock, Duration>& deadline) {
+        uint64_t tid = tracked_thread_id();
+        if (mutex_.try_lock()) {
+            acquired(tid, false);
+            return true;
+        }
+        begin_wait(tid);
+        bool ok = mutex_.try_lock_until(deadline);
+        end_wait();
+        if (ok) {
+            acquired(tid, true);
+        } else {
+            wait_failed(tid);
+        }
+        return ok;
+    }
+
+    void unlock() {
+        releasing();
+        mutex_.unlock();
+        released(tracked_thread_id());
+    }
+
+    std::timed_mutex::native_handle_type native_handle() { return mutex_.native_handle(); }
+
+private:
+    std::timed_mutex mutex_;
+};
+
+#endif // TRACKED_MUTEX_H
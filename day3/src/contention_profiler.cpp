@@ -0,0 +1,368 @@
+#include "contention_profiler.h"
+#include "report_sink.h"
+#include <algorithm>
+
+// 单写者计数器：只有所属线程会写，用 load + store 代替 fetch_add，避免锁总线的 RMW 指令
+template <typename T>
+static inline void bump(std::atomic<T>& counter, T delta) {
+    counter.store(counter.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+}
+
+static inline void raise_max(std::atomic<uint64_t>& counter, uint64_t value) {
+    if (value > counter.load(std::memory_order_relaxed)) {
+        counter.store(value, std::memory_order_relaxed);
+    }
+}
+
+// ============================================
+// LatencyHistogram
+// ============================================
+void LatencyHistogram::clear() {
+    for (size_t i = 0; i < kBuckets; i++) {
+        counts[i] = 0;
+    }
+}
+
+uint64_t LatencyHistogram::total() const {
+    uint64_t sum = 0;
+    for (size_t i = 0; i < kBuckets; i++) {
+        sum += counts[i];
+    }
+    return sum;
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& other) {
+    for (size_t i = 0; i < kBuckets; i++) {
+        counts[i] += other.counts[i];
+    }
+}
+
+uint64_t LatencyHistogram::percentile(double p) const {
+    uint64_t n = total();
+    if (n == 0) {
+        return 0;
+    }
+    uint64_t rank = static_cast<uint64_t>(p / 100.0 * static_cast<double>(n - 1)) + 1;
+    uint64_t seen = 0;
+    for (size_t i = 0; i < kBuckets; i++) {
+        seen += counts[i];
+        if (seen >= rank) {
+            return bucket_lower(i);
+        }
+    }
+    return bucket_lower(kBuckets - 1);
+}
+
+// ============================================
+// LockContentionStats
+// ============================================
+void LockContentionStats::merge(const LockContentionStats& other) {
+    acquisitions += other.acquisitions;
+    contended += other.contended;
+    wait_total_ns += other.wait_total_ns;
+    hold_total_ns += other.hold_total_ns;
+    max_wait_ns = std::max(max_wait_ns, other.max_wait_ns);
+    max_hold_ns = std::max(max_hold_ns, other.max_hold_ns);
+    wait_hist.merge(other.wait_hist);
+    hold_hist.merge(other.hold_hist);
+}
+
+// ============================================
+// 分片
+// ============================================
+void ContentionProfiler::reset_entry(ShardEntry& entry, uint64_t key) {
+    entry.acquisitions.store(0, std::memory_order_relaxed);
+    entry.contended.store(0, std::memory_order_relaxed);
+    entry.wait_total_ns.store(0, std::memory_order_relaxed);
+    entry.hold_total_ns.store(0, std::memory_order_relaxed);
+    entry.max_wait_ns.store(0, std::memory_order_relaxed);
+    entry.max_hold_ns.store(0, std::memory_order_relaxed);
+    for (size_t i = 0; i < LatencyHistogram::kBuckets; i++) {
+        entry.wait_hist[i].store(0, std::memory_order_relaxed);
+        entry.hold_hist[i].store(0, std::memory_order_relaxed);
+    }
+    entry.lock_addr.store(key, std::memory_order_release);
+}
+
+ContentionProfiler::Shard::Shard() {
+    for (size_t i = 0; i < kShardEntries; i++) {
+        reset_entry(entries[i]);
+    }
+    reset_entry(overflow);
+}
+
+ContentionProfiler::ContentionProfiler()
+    : enabled_(false),
+      contention_threshold_ns_(1000),
+      shard_limit_(0) {
+    for (size_t i = 0; i < kMaxThreadSlots; i++) {
+        shards_[i].store(nullptr, std::memory_order_relaxed);
+    }
+}
+
+ContentionProfiler::~ContentionProfiler() {
+    for (size_t i = 0; i < kMaxThreadSlots; i++) {
+        delete shards_[i].load();
+    }
+}
+
+ContentionProfiler::Shard* ContentionProfiler::shard_for(const ThreadSlot& slot) {
+    Shard* shard = shards_[slot.ordinal].load(std::memory_order_acquire);
+    if (!shard) {
+        // 首次使用时由所属线程分配，之后一直复用
+        shard = new Shard();
+        shards_[slot.ordinal].store(shard, std::memory_order_release);
+        uint32_t limit = shard_limit_.load(std::memory_order_relaxed);
+        while (limit < slot.ordinal + 1 &&
+               !shard_limit_.compare_exchange_weak(limit, slot.ordinal + 1)) {
+        }
+    }
+    return shard;
+}
+
+ContentionProfiler::ShardEntry* ContentionProfiler::entry_for(Shard* shard, uint64_t lock_addr) {
+    size_t h = static_cast<size_t>((lock_addr >> 4) * 0x9E3779B97F4A7C15ull >> 58);
+    ShardEntry* free_entry = nullptr;   // 探测链上第一个空槽或墓碑
+    for (size_t i = 0; i < kShardEntries; i++) {
+        ShardEntry& entry = shard->entries[(h + i) & (kShardEntries - 1)];
+        uint64_t key = entry.lock_addr.load(std::memory_order_relaxed);
+        if (key == lock_addr) {
+            return &entry;
+        }
+        if (key == kTombstone || key == 0) {
+            if (!free_entry) {
+                free_entry = &entry;
+            }
+            if (key == 0) {
+                break;
+            }
+        }
+    }
+    if (!free_entry) {
+        return &shard->overflow;
+    }
+    // 墓碑的计数已由 forget_lock 清零
+    free_entry->lock_addr.store(lock_addr, std::memory_order_release);
+    return free_entry;
+}
+
+// ============================================
+// 热路径
+// ============================================
+void ContentionProfiler::record_acquire(const ThreadSlot& slot, uint64_t lock_addr, uint64_t wait_ns,
+                                        const char* site) {
+    ShardEntry* entry = entry_for(shard_for(slot), lock_addr);
+    bump<uint64_t>(entry->acquisitions, 1);
+    if (wait_ns >= contention_threshold_ns_.load(std::memory_order_relaxed)) {
+        bump<uint64_t>(entry->contended, 1);
+        // 竞争路径本来就在等锁，这里多一次短临界区可以接受
+        hot_locks_.offer(lock_addr);
+        if (site) {
+            hot_sites_.offer(reinterpret_cast<uint64_t>(site));
+        }
+    }
+    bump<uint64_t>(entry->wait_total_ns, wait_ns);
+    raise_max(entry->max_wait_ns, wait_ns);
+    bump<uint32_t>(entry->wait_hist[LatencyHistogram::bucket_of(wait_ns)], 1);
+}
+
+void ContentionProfiler::record_release(const ThreadSlot& slot, uint64_t lock_addr, uint64_t hold_ns) {
+    ShardEntry* entry = entry_for(shard_for(slot), lock_addr);
+    bump<uint64_t>(entry->hold_total_ns, hold_ns);
+    raise_max(entry->max_hold_ns, hold_ns);
+    bump<uint32_t>(entry->hold_hist[LatencyHistogram::bucket_of(hold_ns)], 1);
+}
+
+// ============================================
+// 读取：合并各线程分片
+// ============================================
+void ContentionProfiler::merge_entry(const ShardEntry& entry, LockContentionStats& stats) {
+    stats.acquisitions += entry.acquisitions.load(std::memory_order_relaxed);
+    stats.contended += entry.contended.load(std::memory_order_relaxed);
+    stats.wait_total_ns += entry.wait_total_ns.load(std::memory_order_relaxed);
+    stats.hold_total_ns += entry.hold_total_ns.load(std::memory_order_relaxed);
+    stats.max_wait_ns = std::max(stats.max_wait_ns, entry.max_wait_ns.load(std::memory_order_relaxed));
+    stats.max_hold_ns = std::max(stats.max_hold_ns, entry.max_hold_ns.load(std::memory_order_relaxed));
+    for (size_t i = 0; i < LatencyHistogram::kBuckets; i++) {
+        stats.wait_hist.counts[i] += entry.wait_hist[i].load(std::memory_order_relaxed);
+        stats.hold_hist.counts[i] += entry.hold_hist[i].load(std::memory_order_relaxed);
+    }
+}
+
+std::vector<LockContentionStats> ContentionProfiler::snapshot(ClassLookup by_class) const {
+    // 键：锁地址，或按类别合并时的 类别ID（用最高位区分）
+    static const uint64_t kClassTag = 1ull << 63;
+    std::map<uint64_t, LockContentionStats> merged;
+
+    auto key_of = [&](uint64_t lock_addr) -> uint64_t {
+        if (by_class && lock_addr != 0) {
+            uint64_t cls = by_class(lock_addr);
+            if (cls > 0) {
+                return kClassTag | (cls - 1);
+            }
+        }
+        return lock_addr;
+    };
+
+    for (size_t s = 0; s < kMaxThreadSlots; s++) {
+        const Shard* shard = shards_[s].load(std::memory_order_acquire);
+        if (!shard) {
+            continue;
+        }
+        for (size_t i = 0; i <= kShardEntries; i++) {
+            const ShardEntry& entry = i < kShardEntries ? shard->entries[i] : shard->overflow;
+            uint64_t lock_addr = entry.lock_addr.load(std::memory_order_acquire);
+            if ((lock_addr == 0 || lock_addr == kTombstone) && i < kShardEntries) {
+                continue;
+            }
+            merge_entry(entry, merged[key_of(lock_addr)]);
+        }
+    }
+    {
+        std::lock_guard<std::mutex> guard(mutex_retired_);
+        for (const auto& pair : retired_) {
+            merged[key_of(pair.first)].merge(pair.second.stats);
+        }
+        merged[0].merge(retired_other_);
+    }
+
+    std::vector<LockContentionStats> result;
+    for (auto& pair : merged) {
+        if (pair.second.acquisitions == 0 && pair.second.hold_hist.total() == 0) {
+            continue;
+        }
+        pair.second.is_class = (pair.first & kClassTag) != 0;
+        pair.second.key = pair.first & ~kClassTag;
+        result.push_back(pair.second);
+    }
+    return result;
+}
+
+std::vector<LockContentionStats> ContentionProfiler::top_contended(size_t n, ClassLookup by_class) const {
+    std::vector<LockContentionStats> all = snapshot(by_class);
+    auto worse = [](const LockContentionStats& a, const LockContentionStats& b) {
+        if (a.contended != b.contended) {
+            return a.contended > b.contended;
+        }
+        return a.wait_total_ns > b.wait_total_ns;
+    };
+    if (all.size() > n) {
+        std::partial_sort(all.begin(), all.begin() + n, all.end(), worse);
+        all.resize(n);
+    } else {
+        std::sort(all.begin(), all.end(), worse);
+    }
+    return all;
+}
+
+void ContentionProfiler::dump(ReportWriter& out, size_t n, ClassLookup by_class) const {
+    std::vector<LockContentionStats> top = top_contended(n, by_class);
+    out << "\n========== Lock Contention Profile (top " << top.size() << ") ==========\n";
+    for (size_t i = 0; i < top.size(); i++) {
+        const LockContentionStats& s = top[i];
+        if (s.is_class) {
+            out << "  class " << s.key;
+        } else if (s.key == 0) {
+            out << "  (other locks)";
+        } else {
+            out << "  lock 0x" << std::hex << s.key << std::dec;
+        }
+        out << ": acquisitions=" << s.acquisitions << " contended=" << s.contended
+            << " wait p50/p99/max=" << s.wait_hist.percentile(50) << "/"
+            << s.wait_hist.percentile(99) << "/" << s.max_wait_ns << " ns"
+            << " hold p50/p99/max=" << s.hold_hist.percentile(50) << "/"
+            << s.hold_hist.percentile(99) << "/" << s.max_hold_ns << " ns\n";
+    }
+    
+    std::vector<SpaceSaving::Item> locks = hot_locks_.top(n);
+    std::vector<SpaceSaving::Item> sites = hot_sites_.top(n);
+    if (!locks.empty()) {
+        out << "Heavy hitters (all locks, count may overestimate by 'err'):\n";
+        for (size_t i = 0; i < locks.size(); i++) {
+            out << "  lock 0x" << std::hex << locks[i].key << std::dec
+                << " contended=" << locks[i].count << " err=" << locks[i].error << "\n";
+        }
+        for (size_t i = 0; i < sites.size(); i++) {
+            out << "  site " << reinterpret_cast<const char*>(sites[i].key)
+                << " contended=" << sites[i].count << " err=" << sites[i].error << "\n";
+        }
+    }
+    out << "=====================================================\n";
+}
+
+// ============================================
+// 线程退出：并入汇总，清空分片
+// ============================================
+void ContentionProfiler::retire_shard(uint32_t ordinal) {
+    if (ordinal >= kMaxThreadSlots) {
+        return;
+    }
+    Shard* shard = shards_[ordinal].load(std::memory_order_acquire);
+    if (!shard) {
+        return;
+    }
+    std::lock_guard<std::mutex> guard(mutex_retired_);
+    for (size_t i = 0; i <= kShardEntries; i++) {
+        ShardEntry& entry = i < kShardEntries ? shard->entries[i] : shard->overflow;
+        uint64_t lock_addr = entry.lock_addr.load(std::memory_order_relaxed);
+        if ((lock_addr != 0 && lock_addr != kTombstone) || i == kShardEntries) {
+            merge_entry(entry, retired_for(lock_addr));
+        }
+        reset_entry(entry);
+    }
+}
+
+LockContentionStats& ContentionProfiler::retired_for(uint64_t lock_addr) {
+    if (lock_addr == 0) {
+        return retired_other_;
+    }
+    auto it = retired_.find(lock_addr);
+    if (it != retired_.end()) {
+        retired_lru_.splice(retired_lru_.begin(), retired_lru_, it->second.lru);
+        return it->second.stats;
+    }
+    if (retired_.size() >= kMaxRetiredLocks) {
+        // 静态初始化的锁、未 destroy 就释放的锁不会经过 forget_lock，靠这里限制内存
+        auto victim = retired_.find(retired_lru_.back());
+        retired_other_.merge(victim->second.stats);
+        retired_.erase(victim);
+        retired_lru_.pop_back();
+    }
+    retired_lru_.push_front(lock_addr);
+    RetiredEntry& entry = retired_[lock_addr];
+    entry.lru = retired_lru_.begin();
+    return entry.stats;
+}
+
+// ============================================
+// 锁销毁：清除该锁的统计
+// 只有所属线程会把空槽 / 墓碑改成锁地址，这里只把已销毁锁的槽位改成墓碑，
+// 先清零计数再发布墓碑，复用它的线程看到的一定是干净的槽位
+// ============================================
+void ContentionProfiler::forget_lock(uint64_t lock_addr) {
+    size_t h = static_cast<size_t>((lock_addr >> 4) * 0x9E3779B97F4A7C15ull >> 58);
+    uint32_t limit = shard_limit_.load(std::memory_order_acquire);
+    for (uint32_t s = 0; s < limit; s++) {
+        Shard* shard = shards_[s].load(std::memory_order_acquire);
+        if (!shard) {
+            continue;
+        }
+        for (size_t i = 0; i < kShardEntries; i++) {
+            ShardEntry& entry = shard->entries[(h + i) & (kShardEntries - 1)];
+            uint64_t key = entry.lock_addr.load(std::memory_order_acquire);
+            if (key == lock_addr) {
+                reset_entry(entry, kTombstone);
+                break;
+            }
+            if (key == 0) {
+                break;
+            }
+        }
+    }
+    std::lock_guard<std::mutex> guard(mutex_retired_);
+    auto it = retired_.find(lock_addr);
+    if (it != retired_.end()) {
+        retired_lru_.erase(it->second.lru);
+        retired_.erase(it);
+    }
+}
@@ -1,7 +1,12 @@
 #include "deadlock_detector.h"
-#include <iostream>
 #include <iomanip>
 #include <chrono>
+#include <algorithm>
+#include <time.h>
+#include <errno.h>
+#include <sys/timerfd.h>
+#include <stdio.h>
+#include <string.h>
 /*
 死锁检测器是被多个线程同时使用的
 例如，业务线程会访问与修改映射表和图的状态，检测线程检测死锁同样也会访问图,
@@ -13,22 +18,175 @@
 // 修改：使用 std::lock 避免死锁
 // 核心原理：同时获取多个锁，获取不到就等待, 本质上是一种原子操作
 // ============================================
-void DeadlockDetector::on_lock_before(uint64_t thread_id, uint64_t lock_addr) {
+void DeadlockDetector::on_lock_before(uint64_t thread_id, uint64_t lock_addr, const char* site, bool shared) {
+    stats_.add(STAT_LOCK_BEFORE);
+    
     // 关键：同时获取两个锁，避免死锁
     std::lock(mutex_thread_waiting_, mutex_thread_stacks_);
     
     {
         std::lock_guard<std::mutex> guard(mutex_thread_waiting_, std::adopt_lock);
-        thread_waiting_[thread_id] = lock_addr;
+        thread_waiting_[thread_id] = WaitRecord(lock_addr, coarse_now_ns(), shared);
     }
     
     {
         std::lock_guard<std::mutex> guard(mutex_thread_stacks_, std::adopt_lock);
         thread_stacks_[thread_id] = "[Stack trace placeholder]";
     }
+    
+    // 竞争剖析：最后一刻取时间戳，使区间尽量只覆盖真实的加锁等待
+    if (profiler_.enabled()) {
+        ThreadSlot* slot = ThreadRegistry::current();
+        if (slot) {
+            slot->wait_begin_ns = precise_now_ns();
+        }
+    }
+    
+    if (trace_.enabled()) {
+        trace_.record(ThreadRegistry::current(), TRACE_LOCK_BEFORE, lock_addr, site,
+                      shared ? kTraceLockShared : 0);
+    }
+}
+
+// 本线程持有栈中某把锁的获取位置
+static const char* held_site_of(ThreadSlot* slot, uint64_t lock_addr) {
+    if (!slot) {
+        return nullptr;
+    }
+    std::vector<HeldLockInfo> held;
+    slot->read_held(held);
+    for (size_t i = 0; i < held.size(); i++) {
+        if (held[i].lock_addr == lock_addr) {
+            return held[i].site;
+        }
+    }
+    return nullptr;
+}
+
+void DeadlockDetector::on_mutex_lock_before(uint64_t thread_id, pthread_mutex_t* mutex, const char* site,
+                                            bool timed) {
+    uint64_t lock_addr = reinterpret_cast<uint64_t>(mutex);
+    ThreadSlot* slot = ThreadRegistry::current();
+    if (slot && slot->holds(lock_addr)) {
+        int kind = dd_mutex_kind(mutex);
+        if (kind == PTHREAD_MUTEX_RECURSIVE || kind == PTHREAD_MUTEX_ERRORCHECK) {
+            return; // 重入立即成功 / 立即返回 EDEADLK，不会阻塞
+        }
+        if (kind == PTHREAD_MUTEX_NORMAL && timed) {
+            // 只会等到超时：登记等待会在等待图中形成自环，被当成死锁
+            const char* held_site = held_site_of(slot, lock_addr);
+            ReportWriter() << "[Detector] ⚠️  Thread " << thread_id << " relocks non-recursive mutex 0x"
+                           << std::hex << lock_addr << std::dec << " with timedlock at " << (site ? site : "?")
+                           << " while already holding it (acquired at " << (held_site ? held_site : "?")
+                           << "); the call can only time out\n";
+            return;
+        }
+        if (kind == PTHREAD_MUTEX_NORMAL) {
+            report_self_deadlock(thread_id, lock_addr, site);
+        }
+    }
+    on_lock_before(thread_id, lock_addr, site);
+}
+
+// ============================================
+// 互斥锁生命周期
+// ============================================
+uint64_t DeadlockDetector::erase_lock_state_locked(uint64_t lock_addr) {
+    uint64_t owner = 0;
+    auto it = lock_owners_.find(lock_addr);
+    if (it != lock_owners_.end()) {
+        owner = it->second;
+        lock_owners_.erase(it);
+    }
+    if (lock_recursion_.erase(lock_addr) != 0) {
+        reentered_locks_.fetch_sub(1, std::memory_order_relaxed);
+    }
+    rwlock_readers_.erase(lock_addr);
+    return owner;
+}
+
+void DeadlockDetector::on_mutex_init(uint64_t lock_addr, const char* site) {
+    stats_.add(STAT_MUTEX_INITS);
+    bool stale;
+    {
+        std::lock_guard<std::mutex> guard(mutex_lock_owners_);
+        LockLifetime& life = live_mutexes_[lock_addr];
+        // 未销毁就重新初始化，或地址上还留着旧锁（静态初始化、未 destroy 就释放了内存）的持有记录
+        stale = life.generation != 0;
+        if (erase_lock_state_locked(lock_addr) != 0) {
+            stale = true;
+        }
+        life.generation = ++next_generation_;
+        life.init_site = site;
+        live_mutex_count_.store(live_mutexes_.size(), std::memory_order_relaxed);
+    }
+    if (stale) {
+        hold_time_.forget_lock(lock_addr);
+        profiler_.forget_lock(lock_addr);
+    }
 }
 
-void DeadlockDetector::on_lock_after(uint64_t thread_id, uint64_t lock_addr) {
+void DeadlockDetector::on_mutex_destroy(uint64_t thread_id, uint64_t lock_addr, const char* site) {
+    stats_.add(STAT_MUTEX_DESTROYS);
+    uint64_t generation = 0;
+    const char* init_site = nullptr;
+    uint64_t owner;
+    {
+        std::lock_guard<std::mutex> guard(mutex_lock_owners_);
+        auto life = live_mutexes_.find(lock_addr);
+        if (life != live_mutexes_.end()) {
+            generation = life->second.generation;
+            init_site = life->second.init_site;
+            live_mutexes_.erase(life);
+            live_mutex_count_.store(live_mutexes_.size(), std::memory_order_relaxed);
+        }
+        owner = erase_lock_state_locked(lock_addr);
+    }
+    hold_time_.forget_lock(lock_addr);
+    profiler_.forget_lock(lock_addr);
+    
+    if (owner == 0) {
+        return;
+    }
+    // pthread 已确认锁未被持有（否则返回 EBUSY），说明有一次解锁绕过了包装
+    if (owner == thread_id) {
+        HeldLockInfo info;
+        ThreadSlot* slot = ThreadRegistry::current();
+        if (slot) {
+            slot->pop_held(lock_addr, info);
+        }
+    }
+    ReportWriter() << "[Detector] ⚠️  Mutex 0x" << std::hex << lock_addr << std::dec
+                   << " (gen " << generation << ", initialized at " << (init_site ? init_site : "?")
+                   << ") destroyed at " << (site ? site : "?") << " while still recorded as held by Thread "
+                   << owner << "; dropped the stale ownership\n";
+}
+
+uint64_t DeadlockDetector::lock_generation(uint64_t lock_addr) {
+    std::lock_guard<std::mutex> guard(mutex_lock_owners_);
+    auto life = live_mutexes_.find(lock_addr);
+    return life != live_mutexes_.end() ? life->second.generation : 0;
+}
+
+void DeadlockDetector::on_lock_after(uint64_t thread_id, uint64_t lock_addr, const char* site, bool shared) {
+    ThreadSlot* slot = ThreadRegistry::current();
+    
+    // 递归锁重入：只增加深度，不是新的获取（不记录追踪、不入持有栈）
+    if (!shared && slot && slot->holds(lock_addr)) {
+        stats_.add(STAT_LOCK_AFTER);
+        std::lock_guard<std::mutex> guard(mutex_lock_owners_);
+        if (lock_recursion_[lock_addr]++ == 0) {
+            reentered_locks_.fetch_add(1, std::memory_order_relaxed);
+        }
+        return;
+    }
+    
+    // 先取时间戳（在进入检测器自身的互斥锁之前）
+    bool profiling = profiler_.enabled();
+    uint64_t now = (profiling || hold_time_.enabled()) ? precise_now_ns() : 0;
+    trace_.record(slot, TRACE_LOCK_AFTER, lock_addr, site, shared ? kTraceLockShared : 0);
+    stats_.add(STAT_LOCK_AFTER);
+    
     // 同时获取三个锁
     std::lock(mutex_thread_waiting_, mutex_thread_stacks_, mutex_lock_owners_);
     
@@ -44,13 +202,600 @@ void DeadlockDetector::on_lock_after(uint64_t thread_id, uint64_t lock_addr) {
     
     {
         std::lock_guard<std::mutex> guard(mutex_lock_owners_, std::adopt_lock);
-        lock_owners_[lock_addr] = thread_id;
+        if (!shared) {
+            lock_owners_[lock_addr] = thread_id;
+        } else if (slot) {
+            rwlock_readers_[lock_addr].insert(slot->ordinal);
+        }
+    }
+    
+    note_acquired(slot, lock_addr, site, now, profiling);
+}
+
+// 每线程持有锁栈：只写本线程的槽位，无跨线程同步
+void DeadlockDetector::note_acquired(ThreadSlot* slot, uint64_t lock_addr, const char* site, uint64_t now,
+                                     bool profiling) {
+    if (slot) {
+        slot->push_held(lock_addr, now, site);
+        if (profiling && slot->wait_begin_ns != 0) {
+            uint64_t wait_ns = now - std::min(now, slot->wait_begin_ns);
+            profiler_.record_acquire(*slot, lock_addr, wait_ns, site);
+            if (wait_ns >= profiler_.contention_threshold_ns()) {
+                stats_.add(STAT_CONTENDED);
+            }
+            slot->wait_begin_ns = 0;
+        }
+    }
+}
+
+void DeadlockDetector::note_released(ThreadSlot* slot, uint64_t thread_id, uint64_t lock_addr,
+                                     bool popped, const HeldLockInfo& info) {
+    if (popped && info.acquired_ns != 0) {
+        uint64_t now = precise_now_ns();
+        hold_time_.on_release(thread_id, info, now);
+        if (profiler_.enabled()) {
+            profiler_.record_release(*slot, lock_addr, now - std::min(now, info.acquired_ns));
+        }
     }
 }
 
 void DeadlockDetector::on_unlock_after(uint64_t thread_id, uint64_t lock_addr) {
-    std::lock_guard<std::mutex> guard(mutex_lock_owners_);
-    lock_owners_.erase(lock_addr);
+    stats_.add(STAT_UNLOCK);
+    
+    // 递归锁的内层解锁：只减少深度，持有关系不变
+    if (reentered_locks_.load(std::memory_order_relaxed) != 0) {
+        std::lock_guard<std::mutex> guard(mutex_lock_owners_);
+        auto depth = lock_recursion_.find(lock_addr);
+        if (depth != lock_recursion_.end()) {
+            auto owner = lock_owners_.find(lock_addr);
+            if (owner != lock_owners_.end() && owner->second == thread_id) {
+                if (--depth->second == 0) {
+                    lock_recursion_.erase(depth);
+                    reentered_locks_.fetch_sub(1, std::memory_order_relaxed);
+                }
+                return;
+            }
+        }
+    }
+    
+    ThreadSlot* slot = ThreadRegistry::current();
+    trace_.record(slot, TRACE_UNLOCK, lock_addr, nullptr);
+    
+    HeldLockInfo info;
+    bool popped = slot && slot->pop_held(lock_addr, info);
+    
+    {
+        std::lock_guard<std::mutex> guard(mutex_lock_owners_);
+        auto readers = rwlock_readers_.find(lock_addr);
+        if (readers == rwlock_readers_.end()) {
+            lock_owners_.erase(lock_addr);
+        } else {
+            // 读写锁的 unlock 不区分读写：本线程是写者则释放写锁，否则释放读锁
+            // （同一线程重复加的读锁要等最后一次 unlock 才离开读者集合）
+            auto owner = lock_owners_.find(lock_addr);
+            if (owner != lock_owners_.end() && owner->second == thread_id) {
+                lock_owners_.erase(owner);
+            } else if (slot && !slot->holds(lock_addr)) {
+                readers->second.erase(slot->ordinal);
+                if (readers->second.empty()) {
+                    rwlock_readers_.erase(readers);
+                }
+            }
+        }
+    }
+    
+    note_released(slot, thread_id, lock_addr, popped, info);
+}
+
+// ============================================
+// 内联持有者的锁（TrackedMutex 系列）
+// 持有者记在锁对象里，这里不更新 lock_owners_；未竞争的获取也不碰等待表
+// ============================================
+void DeadlockDetector::on_tracked_wait(uint64_t thread_id, uint64_t lock_addr,
+                                       const std::atomic<uint64_t>* owner, const char* site) {
+    stats_.add(STAT_LOCK_BEFORE);
+    
+    std::lock(mutex_thread_waiting_, mutex_thread_stacks_);
+    {
+        std::lock_guard<std::mutex> guard(mutex_thread_waiting_, std::adopt_lock);
+        WaitRecord& wait = thread_waiting_[thread_id];
+        wait = WaitRecord(lock_addr, coarse_now_ns());
+        wait.inline_owner = owner;
+    }
+    {
+        std::lock_guard<std::mutex> guard(mutex_thread_stacks_, std::adopt_lock);
+        thread_stacks_[thread_id] = "[Stack trace placeholder]";
+    }
+    
+    ThreadSlot* slot = ThreadRegistry::current();
+    if (slot && profiler_.enabled()) {
+        slot->wait_begin_ns = precise_now_ns();
+    }
+    trace_.record(slot, TRACE_LOCK_BEFORE, lock_addr, site);
+}
+
+void DeadlockDetector::on_tracked_acquired(uint64_t thread_id, uint64_t lock_addr, const char* site, bool waited) {
+    bool profiling = profiler_.enabled();
+    uint64_t now = (profiling || hold_time_.enabled()) ? precise_now_ns() : 0;
+    ThreadSlot* slot = ThreadRegistry::current();
+    trace_.record(slot, TRACE_LOCK_AFTER, lock_addr, site);
+    stats_.add(STAT_LOCK_AFTER);
+    
+    if (waited) {
+        std::lock(mutex_thread_waiting_, mutex_thread_stacks_);
+        {
+            std::lock_guard<std::mutex> guard(mutex_thread_waiting_, std::adopt_lock);
+            thread_waiting_.erase(thread_id);
+        }
+        {
+            std::lock_guard<std::mutex> guard(mutex_thread_stacks_, std::adopt_lock);
+            thread_stacks_.erase(thread_id);
+        }
+    } else if (profiling && slot) {
+        slot->wait_begin_ns = now;   // 未竞争：按零等待计入剖析
+    }
+    
+    note_acquired(slot, lock_addr, site, now, profiling);
+}
+
+void DeadlockDetector::on_tracked_released(uint64_t thread_id, uint64_t lock_addr) {
+    ThreadSlot* slot = ThreadRegistry::current();
+    trace_.record(slot, TRACE_UNLOCK, lock_addr, nullptr);
+    stats_.add(STAT_UNLOCK);
+    
+    HeldLockInfo info;
+    bool popped = slot && slot->pop_held(lock_addr, info);
+    note_released(slot, thread_id, lock_addr, popped, info);
+}
+
+// ============================================
+// 自旋锁
+// ============================================
+static uint64_t thread_cpu_now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + ts.tv_nsec;
+}
+
+// 其他线程已消耗的 CPU 时间（检测线程使用），线程不存在时返回 0
+// （只对仍注册着的线程取时钟；线程随后退出时 clock_gettime 返回错误，不会读到别的线程）
+static uint64_t thread_cpu_ns_of(uint64_t thread_id) {
+    clockid_t clock;
+    struct timespec ts;
+    if (!ThreadRegistry::instance().cpu_clock_of(thread_id, clock) || clock_gettime(clock, &ts) != 0) {
+        return 0;
+    }
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + ts.tv_nsec;
+}
+
+void DeadlockDetector::on_spin_acquired(uint64_t lock_addr, const char* site) {
+    ThreadSlot* slot = ThreadRegistry::current();
+    if (slot) {
+        slot->push_spin(lock_addr);
+    }
+    if (trace_.enabled()) {
+        trace_.record(slot, TRACE_LOCK_AFTER, lock_addr, site);
+    }
+}
+
+void DeadlockDetector::on_spin_released(uint64_t lock_addr) {
+    ThreadSlot* slot = ThreadRegistry::current();
+    if (slot) {
+        slot->pop_spin(lock_addr);
+    }
+    if (trace_.enabled()) {
+        trace_.record(slot, TRACE_UNLOCK, lock_addr, nullptr);
+    }
+}
+
+void DeadlockDetector::on_spin_wait_begin(uint64_t thread_id, uint64_t lock_addr, const char* site) {
+    ThreadSlot* slot = ThreadRegistry::current();
+    trace_.record(slot, TRACE_LOCK_BEFORE, lock_addr, site);
+    stats_.add(STAT_SPIN_WAITS);
+    
+    WaitRecord wait(lock_addr, coarse_now_ns());
+    wait.spin_cpu_ns = std::max<uint64_t>(thread_cpu_now_ns(), 1);
+    std::lock_guard<std::mutex> guard(mutex_thread_waiting_);
+    thread_waiting_[thread_id] = wait;
+}
+
+void DeadlockDetector::on_spin_wait_end(uint64_t thread_id, uint64_t lock_addr) {
+    uint64_t spin_begin = 0;
+    {
+        std::lock_guard<std::mutex> guard(mutex_thread_waiting_);
+        auto it = thread_waiting_.find(thread_id);
+        if (it != thread_waiting_.end() && it->second.lock_addr == lock_addr) {
+            spin_begin = it->second.spin_cpu_ns;
+            thread_waiting_.erase(it);
+        }
+    }
+    if (spin_begin != 0) {
+        uint64_t now = thread_cpu_now_ns();
+        stats_.add(STAT_SPIN_NS, now - std::min(now, spin_begin));
+    }
+}
+
+// ============================================
+// 线程退出
+// ============================================
+void DeadlockDetector::on_thread_exit(ThreadSlot& slot) {
+    stats_.add(STAT_THREAD_EXITS);
+    uint64_t tid = slot.tid.load(std::memory_order_relaxed);
+    std::vector<HeldLockInfo> held;
+    slot.read_held(held);
+    
+    std::vector<std::pair<uint64_t, bool> > leaked;   // (锁, 是否读锁)
+    std::lock(mutex_thread_waiting_, mutex_thread_stacks_, mutex_lock_owners_);
+    {
+        std::lock_guard<std::mutex> guard(mutex_thread_waiting_, std::adopt_lock);
+        thread_waiting_.erase(tid);
+        cond_waiting_.erase(tid);
+    }
+    {
+        std::lock_guard<std::mutex> guard(mutex_thread_stacks_, std::adopt_lock);
+        thread_stacks_.erase(tid);
+    }
+    {
+        std::lock_guard<std::mutex> guard(mutex_lock_owners_, std::adopt_lock);
+        for (auto it = lock_owners_.begin(); it != lock_owners_.end();) {
+            if (it->second != tid) {
+                ++it;
+                continue;
+            }
+            leaked.push_back(std::make_pair(it->first, false));
+            if (lock_recursion_.erase(it->first) != 0) {
+                reentered_locks_.fetch_sub(1, std::memory_order_relaxed);
+            }
+            it = lock_owners_.erase(it);
+        }
+        // 读者按序号记录，序号马上会被新线程复用
+        for (auto it = rwlock_readers_.begin(); it != rwlock_readers_.end();) {
+            if (it->second.contains(slot.ordinal)) {
+                leaked.push_back(std::make_pair(it->first, true));
+                it->second.erase(slot.ordinal);
+            }
+            if (it->second.empty()) {
+                it = rwlock_readers_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+    thread_waits_.forget_thread(tid);
+    resources_.forget_thread(tid);
+    profiler_.retire_shard(slot.ordinal);
+    
+    if (leaked.empty()) {
+        return;
+    }
+    stats_.add(STAT_LOCKS_LEAKED, leaked.size());
+    ReportWriter out;
+    out << "[Detector] ⚠️  Thread " << tid << " exited while holding " << leaked.size()
+        << " lock(s); dropped the ownership:\n";
+    for (size_t i = 0; i < leaked.size(); i++) {
+        const char* site = nullptr;
+        for (size_t j = 0; j < held.size(); j++) {
+            if (held[j].lock_addr == leaked[i].first) {
+                site = held[j].site;
+            }
+        }
+        out << "  " << (leaked[i].second ? "RWLock 0x" : "Lock 0x") << std::hex << leaked[i].first << std::dec
+            << (leaked[i].second ? " (read)" : "") << " acquired at " << (site ? site : "?") << "\n";
+    }
+}
+
+void DeadlockDetector::on_join_begin(uint64_t thread_id, pthread_t target, const char* site) {
+    ThreadRegistry::current();   // 确保等待者已注册，报告中能找到它
+    thread_waits_.join_begin(thread_id, target, site);
+}
+
+void DeadlockDetector::on_join_end(uint64_t thread_id) {
+    thread_waits_.join_end(thread_id);
+}
+
+void DeadlockDetector::on_lock_failed(uint64_t thread_id, uint64_t lock_addr, const char* site, bool waited) {
+    ThreadSlot* slot = ThreadRegistry::current();
+    trace_.record(slot, TRACE_TRYLOCK_FAIL, lock_addr, site);
+    stats_.add(STAT_LOCK_FAILED);
+    
+    if (!waited) {
+        return; // trylock 没有登记等待，不需要进入检测器的互斥锁
+    }
+    
+    {
+        std::lock_guard<std::mutex> guard(mutex_thread_waiting_);
+        auto it = thread_waiting_.find(thread_id);
+        if (it != thread_waiting_.end() && it->second.lock_addr == lock_addr) {
+            thread_waiting_.erase(it);
+        }
+    }
+    {
+        std::lock_guard<std::mutex> guard(mutex_thread_stacks_);
+        thread_stacks_.erase(thread_id);
+    }
+    if (slot) {
+        slot->wait_begin_ns = 0;
+    }
+}
+
+bool DeadlockDetector::on_cond_wait_begin(uint64_t thread_id, uint64_t cond_addr, uint64_t mutex_addr,
+                                          const char* site) {
+    {
+        std::lock_guard<std::mutex> guard(mutex_thread_waiting_);
+        cond_waiting_[thread_id] = CondWaitRecord(cond_addr, mutex_addr, coarse_now_ns(), site);
+    }
+    // 调用者不持有互斥锁时（检错锁会返回 EPERM）不能动真正持有者的记录
+    bool owned = false;
+    {
+        std::lock_guard<std::mutex> guard(mutex_lock_owners_);
+        auto owner = lock_owners_.find(mutex_addr);
+        owned = owner != lock_owners_.end() && owner->second == thread_id;
+    }
+    if (owned) {
+        on_unlock_after(thread_id, mutex_addr);
+    }
+    return owned;
+}
+
+void DeadlockDetector::on_cond_wait_end(uint64_t thread_id, uint64_t cond_addr, uint64_t mutex_addr,
+                                        const char* site, bool reacquired) {
+    {
+        std::lock_guard<std::mutex> guard(mutex_thread_waiting_);
+        auto it = cond_waiting_.find(thread_id);
+        if (it != cond_waiting_.end() && it->second.cond_addr == cond_addr) {
+            cond_waiting_.erase(it);
+        }
+    }
+    if (reacquired) {
+        on_lock_after(thread_id, mutex_addr, site);
+    }
+}
+
+void DeadlockDetector::on_sync_release(uint64_t object, uint16_t sync_kind, const char* site) {
+    if (trace_.enabled()) {
+        trace_.record(ThreadRegistry::current(), TRACE_SYNC_RELEASE, object, site, sync_kind);
+    }
+}
+
+void DeadlockDetector::on_sync_acquire(uint64_t object, uint16_t sync_kind, const char* site) {
+    if (trace_.enabled()) {
+        trace_.record(ThreadRegistry::current(), TRACE_SYNC_ACQUIRE, object, site, sync_kind);
+    }
+}
+
+// ============================================
+// 线程与同步原语包装
+// 注意：本文件包含了 deadlock_detector.h，调用原函数时用 (pthread_xxx)(...) 避开宏展开
+// ============================================
+namespace {
+
+// 线程创建令牌：最高位置 1，与同步对象地址不冲突
+const uint64_t kCreateTokenTag = 1ull << 63;
+std::atomic<uint64_t> g_next_create_token(1);
+
+struct SyncThreadStart {
+    void* (*start_routine)(void*);
+    void* arg;
+    uint64_t token;
+};
+
+// 子线程入口：先 acquire 创建令牌，返回前 release 自己的 pthread_t 供 join 获取
+void* sync_thread_trampoline(void* p) {
+    SyncThreadStart start = *static_cast<SyncThreadStart*>(p);
+    delete static_cast<SyncThreadStart*>(p);
+    DeadlockDetector& detector = DeadlockDetector::instance();
+    detector.on_sync_acquire(start.token, SYNC_THREAD_CREATE);
+    void* result = start.start_routine(start.arg);
+    detector.on_sync_release(static_cast<uint64_t>(pthread_self()), SYNC_THREAD_EXIT);
+    return result;
+}
+
+} // namespace
+
+int dd_pthread_create(pthread_t* thread, const pthread_attr_t* attr,
+                      void* (*start_routine)(void*), void* arg, const char* site) {
+    DeadlockDetector& detector = DeadlockDetector::instance();
+    if (!detector.trace().enabled()) {
+        return (pthread_create)(thread, attr, start_routine, arg);
+    }
+    SyncThreadStart* start = new SyncThreadStart();
+    start->start_routine = start_routine;
+    start->arg = arg;
+    start->token = kCreateTokenTag | g_next_create_token.fetch_add(1, std::memory_order_relaxed);
+    detector.on_sync_release(start->token, SYNC_THREAD_CREATE, site);
+    int rc = (pthread_create)(thread, attr, sync_thread_trampoline, start);
+    if (rc != 0) {
+        delete start;
+    }
+    return rc;
+}
+
+int dd_pthread_join(pthread_t thread, void** retval, const char* site) {
+    DeadlockDetector& detector = DeadlockDetector::instance();
+    uint64_t tid = get_thread_id();
+    detector.on_join_begin(tid, thread, site);
+    int rc = (pthread_join)(thread, retval);
+    detector.on_join_end(tid);
+    if (rc == 0) {
+        detector.on_sync_acquire(static_cast<uint64_t>(thread), SYNC_THREAD_EXIT, site);
+    }
+    return rc;
+}
+
+int dd_pthread_cond_signal(pthread_cond_t* cond, const char* site) {
+    DeadlockDetector::instance().on_sync_release(reinterpret_cast<uint64_t>(cond), SYNC_COND, site);
+    return (pthread_cond_signal)(cond);
+}
+
+int dd_pthread_cond_broadcast(pthread_cond_t* cond, const char* site) {
+    DeadlockDetector::instance().on_sync_release(reinterpret_cast<uint64_t>(cond), SYNC_COND, site);
+    return (pthread_cond_broadcast)(cond);
+}
+
+// 等待期间 glibc 在内部释放并重新获取互斥锁，绕过了宏，这里替它更新持有记录
+int dd_pthread_cond_wait(pthread_cond_t* cond, pthread_mutex_t* mutex, const char* site) {
+    DeadlockDetector& detector = DeadlockDetector::instance();
+    uint64_t tid = get_thread_id();
+    uint64_t cond_addr = reinterpret_cast<uint64_t>(cond);
+    uint64_t mutex_addr = reinterpret_cast<uint64_t>(mutex);
+    bool released = detector.on_cond_wait_begin(tid, cond_addr, mutex_addr, site);
+    int rc = (pthread_cond_wait)(cond, mutex);
+    if (rc == 0) {
+        detector.on_sync_acquire(cond_addr, SYNC_COND, site);
+    }
+    // 出错返回（如 EPERM：调用者并未持有互斥锁）时没有重新加锁，只撤销条件等待
+    detector.on_cond_wait_end(tid, cond_addr, mutex_addr, site, released && rc == 0);
+    return rc;
+}
+
+int dd_pthread_cond_timedwait(pthread_cond_t* cond, pthread_mutex_t* mutex,
+                              const struct timespec* abstime, const char* site) {
+    DeadlockDetector& detector = DeadlockDetector::instance();
+    uint64_t tid = get_thread_id();
+    uint64_t cond_addr = reinterpret_cast<uint64_t>(cond);
+    uint64_t mutex_addr = reinterpret_cast<uint64_t>(mutex);
+    bool released = detector.on_cond_wait_begin(tid, cond_addr, mutex_addr, site);
+    int rc = (pthread_cond_timedwait)(cond, mutex, abstime);
+    if (rc == 0) {
+        detector.on_sync_acquire(cond_addr, SYNC_COND, site);
+    }
+    // 超时同样会重新持有互斥锁；其他错误码（EINVAL、EPERM）不会
+    detector.on_cond_wait_end(tid, cond_addr, mutex_addr, site, released && (rc == 0 || rc == ETIMEDOUT));
+    return rc;
+}
+
+// 自旋锁的竞争路径：先用 trylock 自旋，超过阈值后登记等待再交给真正的 pthread_spin_lock
+int dd_pthread_spin_lock_contended(pthread_spinlock_t* lock, const char* site) {
+    DeadlockDetector& detector = DeadlockDetector::instance();
+    uint32_t threshold = detector.spin_wait_threshold();
+    for (uint32_t i = 0; i < threshold; i++) {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#endif
+        if ((pthread_spin_trylock)(lock) == 0) {
+            return 0;
+        }
+    }
+    uint64_t tid = get_thread_id();
+    uint64_t lock_addr = reinterpret_cast<uint64_t>(lock);
+    detector.on_spin_wait_begin(tid, lock_addr, site);
+    int rc = (pthread_spin_lock)(lock);
+    detector.on_spin_wait_end(tid, lock_addr);
+    return rc;
+}
+
+// 销毁前锁必须未被持有：只有真正的 destroy 成功后才清除状态（EBUSY 时保持不变）
+int dd_pthread_mutex_init(pthread_mutex_t* mutex, const pthread_mutexattr_t* attr, const char* site) {
+    int rc = (pthread_mutex_init)(mutex, attr);
+    if (rc == 0) {
+        DeadlockDetector::instance().on_mutex_init(reinterpret_cast<uint64_t>(mutex), site);
+    }
+    return rc;
+}
+
+int dd_pthread_mutex_destroy(pthread_mutex_t* mutex, const char* site) {
+    int rc = (pthread_mutex_destroy)(mutex);
+    if (rc == 0) {
+        DeadlockDetector::instance().on_mutex_destroy(get_thread_id(), reinterpret_cast<uint64_t>(mutex), site);
+    }
+    return rc;
+}
+
+int dd_pthread_barrier_init(pthread_barrier_t* barrier, const pthread_barrierattr_t* attr, unsigned count) {
+    int rc = (pthread_barrier_init)(barrier, attr, count);
+    if (rc == 0) {
+        DeadlockDetector::instance().resources().barrier_init(reinterpret_cast<uint64_t>(barrier), count);
+    }
+    return rc;
+}
+
+// 只有真正的 destroy 成功后才清除状态（EBUSY 时屏障仍在使用）
+int dd_pthread_barrier_destroy(pthread_barrier_t* barrier) {
+    int rc = (pthread_barrier_destroy)(barrier);
+    if (rc == 0) {
+        DeadlockDetector::instance().resources().barrier_destroy(reinterpret_cast<uint64_t>(barrier));
+    }
+    return rc;
+}
+
+// 到达屏障时 release、离开时 acquire：所有线程的到达都先于任何线程的离开
+int dd_pthread_barrier_wait(pthread_barrier_t* barrier, const char* site) {
+    DeadlockDetector& detector = DeadlockDetector::instance();
+    uint64_t tid = get_thread_id();
+    uint64_t barrier_addr = reinterpret_cast<uint64_t>(barrier);
+    detector.on_sync_release(barrier_addr, SYNC_BARRIER, site);
+    detector.resources().barrier_wait_begin(tid, barrier_addr);
+    int rc = (pthread_barrier_wait)(barrier);
+    detector.resources().barrier_wait_end(tid, barrier_addr);
+    if (rc == 0 || rc == PTHREAD_BARRIER_SERIAL_THREAD) {
+        detector.on_sync_acquire(barrier_addr, SYNC_BARRIER, site);
+    }
+    return rc;
+}
+
+// ============================================
+// 信号量
+// 单位在真正 post 之前归还，避免被唤醒的等待者先扣减
+// ============================================
+int dd_sem_init(sem_t* sem, int pshared, unsigned value) {
+    int rc = (sem_init)(sem, pshared, value);
+    if (rc == 0) {
+        DeadlockDetector::instance().resources().define_semaphore(reinterpret_cast<uint64_t>(sem), value);
+    }
+    return rc;
+}
+
+int dd_sem_destroy(sem_t* sem) {
+    int rc = (sem_destroy)(sem);
+    if (rc == 0) {
+        DeadlockDetector::instance().resources().remove(reinterpret_cast<uint64_t>(sem));
+    }
+    return rc;
+}
+
+int dd_sem_wait(sem_t* sem, const char* site) {
+    DeadlockDetector& detector = DeadlockDetector::instance();
+    uint64_t tid = get_thread_id();
+    uint64_t sem_addr = reinterpret_cast<uint64_t>(sem);
+    detector.resources().acquire_begin(tid, sem_addr, 1, site);
+    int rc = (sem_wait)(sem);
+    detector.resources().acquire_end(tid, sem_addr, 1, rc == 0);
+    if (rc == 0) {
+        detector.on_sync_acquire(sem_addr, SYNC_SEMAPHORE, site);
+    }
+    return rc;
+}
+
+int dd_sem_trywait(sem_t* sem, const char* site) {
+    int rc = (sem_trywait)(sem);
+    if (rc == 0) {
+        DeadlockDetector& detector = DeadlockDetector::instance();
+        uint64_t sem_addr = reinterpret_cast<uint64_t>(sem);
+        detector.resources().acquire_end(get_thread_id(), sem_addr, 1, true);
+        detector.on_sync_acquire(sem_addr, SYNC_SEMAPHORE, site);
+    }
+    return rc;
+}
+
+int dd_sem_timedwait(sem_t* sem, const struct timespec* abstime, const char* site) {
+    DeadlockDetector& detector = DeadlockDetector::instance();
+    uint64_t tid = get_thread_id();
+    uint64_t sem_addr = reinterpret_cast<uint64_t>(sem);
+    detector.resources().acquire_begin(tid, sem_addr, 1, site);
+    int rc = (sem_timedwait)(sem, abstime);
+    detector.resources().acquire_end(tid, sem_addr, 1, rc == 0);
+    if (rc == 0) {
+        detector.on_sync_acquire(sem_addr, SYNC_SEMAPHORE, site);
+    }
+    return rc;
+}
+
+int dd_sem_post(sem_t* sem, const char* site) {
+    DeadlockDetector& detector = DeadlockDetector::instance();
+    uint64_t sem_addr = reinterpret_cast<uint64_t>(sem);
+    detector.on_sync_release(sem_addr, SYNC_SEMAPHORE, site);
+    detector.resources().release(get_thread_id(), sem_addr, 1);
+    return (sem_post)(sem);
 }
 
 /*
@@ -62,106 +807,711 @@ void DeadlockDetector::on_unlock_after(uint64_t thread_id, uint64_t lock_addr) {
 // ============================================
 void DeadlockDetector::get_snapshot(
     std::map<uint64_t, uint64_t>& lock_owners,
-    std::map<uint64_t, uint64_t>& thread_waiting,
-    std::map<uint64_t, std::string>& thread_stacks) {
+    ReaderMap& rwlock_readers,
+    std::map<uint64_t, WaitRecord>& thread_waiting,
+    std::map<uint64_t, std::string>& thread_stacks,
+    PassProfile* pass) {
+    
+    uint64_t begin = pass ? precise_now_ns() : 0;
     
     // 使用 std::lock 同时获取所有锁，避免死锁
     std::lock(mutex_lock_owners_, mutex_thread_waiting_, mutex_thread_stacks_);
+    uint64_t locked = pass ? precise_now_ns() : 0;
     
     {
         std::lock_guard<std::mutex> g1(mutex_lock_owners_, std::adopt_lock);
         lock_owners = lock_owners_;
+        rwlock_readers = rwlock_readers_;
     }
+    if (pass) (*pass)[PASS_HOLD_OWNERS_NS] = precise_now_ns() - locked;
     
     {
         std::lock_guard<std::mutex> g2(mutex_thread_waiting_, std::adopt_lock);
         thread_waiting = thread_waiting_;
+        // 内联持有者的锁：等待者仍登记在表中说明它还阻塞在 lock() 里，锁对象必然存活
+        for (const auto& pair : thread_waiting) {
+            if (pair.second.inline_owner) {
+                uint64_t owner = pair.second.inline_owner->load(std::memory_order_acquire);
+                if (owner != 0) {
+                    lock_owners[pair.second.lock_addr] = owner;
+                }
+            }
+        }
     }
+    if (pass) (*pass)[PASS_HOLD_WAITING_NS] = precise_now_ns() - locked;
     
     {
         std::lock_guard<std::mutex> g3(mutex_thread_stacks_, std::adopt_lock);
         thread_stacks = thread_stacks_;
     }
+    
+    // 自旋锁的持有者只记录在各线程槽位中，释放检测器的互斥锁后再扫描
+    const ThreadRegistry& registry = ThreadRegistry::instance();
+    for (const auto& pair : thread_waiting) {
+        if (pair.second.spin_cpu_ns != 0) {
+            uint64_t holder = registry.find_spin_holder(pair.second.lock_addr);
+            if (holder != 0) {
+                lock_owners[pair.second.lock_addr] = holder;
+            }
+        }
+    }
+    
+    if (pass) {
+        uint64_t end = precise_now_ns();
+        (*pass)[PASS_HOLD_STACKS_NS] = end - locked;
+        (*pass)[PASS_SNAPSHOT_NS] = end - begin;
+        
+        // 拷贝量估算：红黑树节点 = 键值对 + 约 32 字节节点头（颜色 + 3 个指针）
+        const uint64_t kMapNodeOverhead = 32;
+        uint64_t bytes = lock_owners.size() * (sizeof(std::pair<const uint64_t, uint64_t>) + kMapNodeOverhead) +
+                         thread_waiting.size() * (sizeof(std::pair<const uint64_t, WaitRecord>) + kMapNodeOverhead) +
+                         thread_stacks.size() * (sizeof(std::pair<const uint64_t, std::string>) + kMapNodeOverhead);
+        for (const auto& pair : thread_stacks) {
+            bytes += pair.second.capacity();
+        }
+        for (const auto& pair : rwlock_readers) {
+            bytes += sizeof(std::pair<const uint64_t, ReaderSet>) + kMapNodeOverhead + pair.second.bytes();
+        }
+        (*pass)[PASS_BYTES_COPIED] = bytes;
+    }
 }
 
 
 // ============================================
 // 构建等待图（使用快照数据）
 // ============================================
-void DeadlockDetector::build_waiting_graph() {
+void DeadlockDetector::build_waiting_graph(PassProfile* pass) {
     graph_.clear();
     
     // 获取快照
     std::map<uint64_t, uint64_t> lock_owners_snapshot;
-    std::map<uint64_t, uint64_t> thread_waiting_snapshot;
+    ReaderMap rwlock_readers_snapshot;
+    std::map<uint64_t, WaitRecord> thread_waiting_snapshot;
     std::map<uint64_t, std::string> thread_stacks_snapshot;
     
-    get_snapshot(lock_owners_snapshot, thread_waiting_snapshot, thread_stacks_snapshot);
+    get_snapshot(lock_owners_snapshot, rwlock_readers_snapshot, thread_waiting_snapshot,
+                 thread_stacks_snapshot, pass);
+    uint64_t build_begin = pass ? precise_now_ns() : 0;
+    add_thread_waits(graph_);   // 紧跟快照，与锁表尽量是同一时刻
+    record_snapshot_size(lock_owners_snapshot.size(), thread_waiting_snapshot.size());
+    
+    // 顺便统计等待压力，供自适应检测间隔使用
+    uint64_t now = coarse_now_ns();
+    uint64_t long_wait_ns = long_wait_threshold_ns();
+    last_wait_count_ = thread_waiting_snapshot.size();
+    last_long_wait_count_ = 0;
+    last_oldest_wait_ns_ = 0;
     
     // 构建图
     for (const auto& pair : thread_waiting_snapshot) {
         uint64_t waiting_thread = pair.first;
-        uint64_t requested_lock = pair.second;
         
-        auto it = lock_owners_snapshot.find(requested_lock);
-        if (it != lock_owners_snapshot.end()) {
-            uint64_t owner_thread = it->second;
-            graph_.add_edge(waiting_thread, owner_thread);
+        uint64_t waited = now > pair.second.since_ns ? now - pair.second.since_ns : 0;
+        last_oldest_wait_ns_ = std::max(last_oldest_wait_ns_, waited);
+        if (waited >= long_wait_ns) {
+            last_long_wait_count_++;
+        }
+        
+        add_wait_edges(graph_, waiting_thread, pair.second, lock_owners_snapshot, rwlock_readers_snapshot);
+    }
+    if (pass) {
+        (*pass)[PASS_BUILD_NS] = precise_now_ns() - build_begin;
+    }
+    
+    // 长等待看门狗与统计段（与建图共用同一份快照）
+    stage_live_waits(lock_owners_snapshot, thread_waiting_snapshot, now);
+    check_long_waits(lock_owners_snapshot, rwlock_readers_snapshot, thread_waiting_snapshot, now);
+    check_long_holds();
+    maybe_dump_profile();
+}
+
+// 线程 → 线程 的等待（join、线程池任务）与信号量 / 资源池 / 屏障等待
+void DeadlockDetector::add_thread_waits(DirectedGraph& graph) {
+    std::vector<ThreadWaitTracker::Edge> edges;
+    std::vector<uint64_t> wait_any;
+    thread_waits_.collect_edges(edges, wait_any);
+    for (size_t i = 0; i < edges.size(); i++) {
+        graph.add_edge(edges[i].first, edges[i].second);
+    }
+    for (size_t i = 0; i < wait_any.size(); i++) {
+        graph.set_wait_any(wait_any[i]);
+    }
+    resources_.add_to_graph(graph);
+}
+
+// 读写锁快照中 lock_addr 的读者线程（序号换成 TID，跳过 exclude 和已回收的槽位）
+static void readers_of(const ReaderMap& rwlock_readers, uint64_t lock_addr, uint64_t exclude,
+                       std::vector<uint64_t>& out) {
+    auto readers = rwlock_readers.find(lock_addr);
+    if (readers == rwlock_readers.end()) {
+        return;
+    }
+    const ThreadRegistry& registry = ThreadRegistry::instance();
+    readers->second.for_each([&](uint32_t ordinal) {
+        ThreadSlot* slot = registry.by_ordinal(ordinal);
+        if (!slot) {
+            return;
         }
+        uint32_t life = slot->life_begin();
+        uint64_t reader = slot->tid.load(std::memory_order_relaxed);
+        if (slot->life_unchanged(life) && reader != exclude) {
+            out.push_back(reader);
+        }
+    });
+}
+
+void DeadlockDetector::add_wait_edges(DirectedGraph& graph, uint64_t waiting_thread, const WaitRecord& wait,
+                                      const std::map<uint64_t, uint64_t>& lock_owners,
+                                      const ReaderMap& rwlock_readers) {
+    auto owner = lock_owners.find(wait.lock_addr);
+    if (owner != lock_owners.end()) {
+        graph.add_edge(waiting_thread, owner->second);
+    }
+    if (wait.shared) {
+        return; // 读者只等写者（写者优先的实现中读者还会排在等待的写者之后，这里不建模）
+    }
+    std::vector<uint64_t> readers;
+    readers_of(rwlock_readers, wait.lock_addr, waiting_thread, readers);
+    for (size_t i = 0; i < readers.size(); i++) {
+        graph.add_edge(waiting_thread, readers[i]);
     }
 }
 
+// ============================================
+// 长等待看门狗
+// ============================================
+
+// 从 /proc 读取线程当前状态：调度状态、内核等待点、正在执行的系统调用
+static std::string describe_thread_activity(uint64_t tid) {
+    char path[64];
+    char buf[512];
+    std::string result;
+    
+    snprintf(path, sizeof(path), "/proc/self/task/%llu/stat", static_cast<unsigned long long>(tid));
+    FILE* f = fopen(path, "r");
+    if (!f) {
+        return "thread has exited";
+    }
+    size_t n = fread(buf, 1, sizeof(buf) - 1, f);
+    fclose(f);
+    buf[n] = '\0';
+    // stat 格式："pid (comm) S ..."，comm 中可能有空格，从最后一个 ')' 之后解析
+    const char* p = strrchr(buf, ')');
+    if (p && p[1] == ' ') {
+        char state = p[2];
+        const char* meaning = "unknown";
+        switch (state) {
+            case 'R': meaning = "running"; break;
+            case 'S': meaning = "sleeping"; break;
+            case 'D': meaning = "uninterruptible I/O wait"; break;
+            case 'T': case 't': meaning = "stopped"; break;
+            case 'Z': meaning = "zombie"; break;
+        }
+        result += "state=";
+        result += state;
+        result += " (";
+        result += meaning;
+        result += ")";
+    }
+    
+    snprintf(path, sizeof(path), "/proc/self/task/%llu/wchan", static_cast<unsigned long long>(tid));
+    f = fopen(path, "r");
+    if (f) {
+        n = fread(buf, 1, sizeof(buf) - 1, f);
+        fclose(f);
+        buf[n] = '\0';
+        if (n > 0 && strcmp(buf, "0") != 0) {
+            result += ", wchan=";
+            result += buf;
+        }
+    }
+    
+    snprintf(path, sizeof(path), "/proc/self/task/%llu/syscall", static_cast<unsigned long long>(tid));
+    f = fopen(path, "r");
+    if (f) {
+        if (fgets(buf, sizeof(buf), f)) {
+            char* space = strchr(buf, ' ');
+            if (space) *space = '\0';
+            char* nl = strchr(buf, '\n');
+            if (nl) *nl = '\0';
+            result += ", syscall=";
+            result += buf;  // 系统调用号；"running" 表示在用户态运行
+        }
+        fclose(f);
+    }
+    return result;
+}
+
+void DeadlockDetector::check_long_waits(
+    const std::map<uint64_t, uint64_t>& lock_owners,
+    const ReaderMap& rwlock_readers,
+    const std::map<uint64_t, WaitRecord>& thread_waiting,
+    uint64_t now) {
+    
+    int budget_ms = wait_budget_ms_.load();
+    if (budget_ms <= 0) {
+        reported_long_waits_.clear();
+        reported_cond_waits_.clear();
+        return;
+    }
+    uint64_t budget_ns = static_cast<uint64_t>(budget_ms) * 1000000ull;
+    
+    // 条件变量等待表很小，单独拷贝一份（用于报告长时间的条件等待和根持有者在做什么）
+    std::map<uint64_t, CondWaitRecord> cond_waiting;
+    {
+        std::lock_guard<std::mutex> guard(mutex_thread_waiting_);
+        cond_waiting = cond_waiting_;
+    }
+    
+    // 清理已经结束的等待，同一次等待只报告一次
+    for (auto it = reported_long_waits_.begin(); it != reported_long_waits_.end();) {
+        auto w = thread_waiting.find(it->first);
+        if (w == thread_waiting.end() || w->second.since_ns != it->second) {
+            it = reported_long_waits_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    
+    for (const auto& pair : thread_waiting) {
+        uint64_t tid = pair.first;
+        const WaitRecord& wait = pair.second;
+        if (now < wait.since_ns || now - wait.since_ns < budget_ns) {
+            continue;
+        }
+        if (reported_long_waits_.count(tid)) {
+            continue;
+        }
+        reported_long_waits_[tid] = wait.since_ns;
+        
+        ReportWriter out;
+        out << "\n[Watchdog] ⚠️  Thread " << tid << " has been waiting "
+            << static_cast<double>(now - wait.since_ns) / 1e9 << " s (budget "
+            << budget_ms << " ms)\n";
+        out << "  Wait chain:\n";
+        
+        // 沿 等待者 → 锁 → 持有者 链走到根持有者（不再等待任何锁的线程）。
+        // 写者等读者时持有者是全部读者：全部列出，链沿第一个自己也在等待的读者继续
+        std::map<uint64_t, bool> visited;
+        uint64_t current = tid;
+        for (;;) {
+            visited[current] = true;
+            auto w = thread_waiting.find(current);
+            if (w == thread_waiting.end()) {
+                break;
+            }
+            auto owner = lock_owners.find(w->second.lock_addr);
+            out << "    Thread " << current << " waiting "
+                << static_cast<double>(now - std::min(now, w->second.since_ns)) / 1e9
+                << " s for lock 0x" << std::hex << w->second.lock_addr << std::dec;
+            if (owner != lock_owners.end()) {
+                out << " (held by Thread " << owner->second << ")\n";
+                current = owner->second;
+            } else {
+                std::vector<uint64_t> readers;
+                if (!w->second.shared) {
+                    readers_of(rwlock_readers, w->second.lock_addr, current, readers);
+                }
+                if (readers.empty()) {
+                    out << " (no recorded holder)\n";
+                    current = 0;
+                    break;
+                }
+                out << " (read-held by Thread";
+                for (size_t i = 0; i < readers.size(); i++) {
+                    out << (i == 0 ? " " : ", ") << readers[i];
+                }
+                out << ")\n";
+                current = readers[0];
+                for (size_t i = 0; i < readers.size(); i++) {
+                    if (thread_waiting.count(readers[i])) {
+                        current = readers[i];
+                        break;
+                    }
+                }
+            }
+            if (visited.count(current)) {
+                out << "    Chain loops back to Thread " << current << ": this is a deadlock cycle\n";
+                current = 0;
+                break;
+            }
+        }
+        
+        if (current != 0) {
+            out << "  Root holder: Thread " << current << ", holding lock(s):";
+            for (const auto& lock : lock_owners) {
+                if (lock.second == current) {
+                    out << " 0x" << std::hex << lock.first << std::dec;
+                }
+            }
+            for (const auto& lock : rwlock_readers) {
+                std::vector<uint64_t> readers;
+                readers_of(rwlock_readers, lock.first, 0, readers);
+                if (std::find(readers.begin(), readers.end(), current) != readers.end()) {
+                    out << " 0x" << std::hex << lock.first << std::dec << " (read)";
+                }
+            }
+            out << "\n  Root holder activity: " << describe_thread_activity(current) << "\n";
+            auto cond = cond_waiting.find(current);
+            if (cond != cond_waiting.end()) {
+                out << "  Root holder is sleeping on condition 0x" << std::hex << cond->second.cond_addr
+                    << " (mutex 0x" << cond->second.mutex_addr << std::dec << ") at "
+                    << (cond->second.site ? cond->second.site : "?") << "\n";
+            }
+        }
+    }
+    
+    // 长时间的条件变量等待：可能丢失了唤醒，或睡眠时还持有别的锁
+    for (auto it = reported_cond_waits_.begin(); it != reported_cond_waits_.end();) {
+        auto w = cond_waiting.find(it->first);
+        if (w == cond_waiting.end() || w->second.since_ns != it->second) {
+            it = reported_cond_waits_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    for (const auto& pair : cond_waiting) {
+        uint64_t tid = pair.first;
+        const CondWaitRecord& wait = pair.second;
+        if (now < wait.since_ns || now - wait.since_ns < budget_ns || reported_cond_waits_.count(tid)) {
+            continue;
+        }
+        reported_cond_waits_[tid] = wait.since_ns;
+        
+        ReportWriter out;
+        out << "\n[Watchdog] ⚠️  Thread " << tid << " has been waiting "
+            << static_cast<double>(now - wait.since_ns) / 1e9 << " s on condition 0x" << std::hex
+            << wait.cond_addr << " (mutex 0x" << wait.mutex_addr << std::dec << ") at "
+            << (wait.site ? wait.site : "?") << "\n";
+        
+        std::vector<HeldLockInfo> held;
+        ThreadRegistry::instance().read_held_of(tid, held);
+        if (!held.empty()) {
+            out << "  Still holding while asleep:";
+            for (size_t i = 0; i < held.size(); i++) {
+                out << " 0x" << std::hex << held[i].lock_addr << std::dec;
+            }
+            out << "\n";
+        }
+    }
+}
+
+// ============================================
+// 持锁超预算扫描：同一次持有只报告一次
+// ============================================
+void DeadlockDetector::check_long_holds() {
+    if (!hold_time_.enabled()) {
+        reported_long_holds_.clear();
+        return;
+    }
+    
+    std::vector<HoldViolation> holds;
+    hold_time_.scan_held(precise_now_ns(), holds);
+    
+    std::map<uint64_t, uint64_t> still_reported;
+    for (size_t i = 0; i < holds.size(); i++) {
+        const HoldViolation& v = holds[i];
+        auto it = reported_long_holds_.find(v.lock_addr);
+        bool already = it != reported_long_holds_.end() && it->second == v.acquired_ns;
+        still_reported[v.lock_addr] = v.acquired_ns;
+        if (already) {
+            continue;
+        }
+        ReportWriter() << "[HoldBudget] ⚠️  Thread " << v.thread_id << " has held lock 0x"
+                       << std::hex << v.lock_addr << std::dec << " for "
+                       << v.hold_ns / 1000000 << " ms (budget " << v.budget_ns / 1000000
+                       << " ms), acquired at " << (v.site ? v.site : "unknown site") << "\n";
+    }
+    reported_long_holds_.swap(still_reported);
+}
+
+// ============================================
+// 竞争剖析
+// ============================================
+uint64_t DeadlockDetector::lookup_lock_class(uint64_t lock_addr) {
+    return instance().hold_time_.lock_class(lock_addr);
+}
+
+std::vector<LockContentionStats> DeadlockDetector::top_contended(size_t n, bool by_class) {
+    return profiler_.top_contended(n, by_class ? &DeadlockDetector::lookup_lock_class : nullptr);
+}
+
+void DeadlockDetector::maybe_dump_profile() {
+    int interval_ms = profile_dump_interval_ms_.load();
+    if (interval_ms <= 0 || !profiler_.enabled()) {
+        return;
+    }
+    uint64_t now = coarse_now_ns();
+    if (now - last_profile_dump_ns_ < static_cast<uint64_t>(interval_ms) * 1000000ull) {
+        return;
+    }
+    last_profile_dump_ns_ = now;
+    ReportWriter out;
+    profiler_.dump(out, 10, &DeadlockDetector::lookup_lock_class);
+}
+
 // ============================================
 // 检查死锁（保持不变）
 // ============================================
 bool DeadlockDetector::check_deadlock() {
     std::lock_guard<std::mutex> guard(mutex_graph_);
-    build_waiting_graph();
-    return graph_.has_cycle();
+    PassProfile pass;
+    uint64_t begin = precise_now_ns();
+    build_waiting_graph(&pass);
+    
+    uint64_t cycle_begin = precise_now_ns();
+    bool found = graph_.has_deadlock();
+    uint64_t end = precise_now_ns();
+    
+    pass[PASS_CYCLE_NS] = end - cycle_begin;
+    pass[PASS_TOTAL_NS] = end - begin;
+    record_pass(pass);
+    record_scan(end - begin, found);
+    publish_live_stats(found);
+    return found;
+}
+
+// ============================================
+// 自身剖析：滚动窗口 + 可选的周期日志
+// ============================================
+void DeadlockDetector::record_pass(PassProfile& pass) {
+    pass[PASS_VERTICES] = graph_.size();
+    pass[PASS_EDGES] = graph_.edge_count();
+    self_profile_.add(pass);
+    
+    int every = self_profile_log_every_.load();
+    if (every <= 0 || self_profile_.passes() % static_cast<uint64_t>(every) != 0) {
+        return;
+    }
+    SelfProfileSummary summary = self_profile_.summary();
+    ReportWriter out;
+    out << "[SelfProfile] last " << summary.passes << " passes (p50/p99/max):";
+    for (size_t m = 0; m < PASS_METRIC_COUNT; m++) {
+        const MetricSummary& ms = summary.metrics[m];
+        out << " " << SelfProfileWindow::metric_name(static_cast<PassMetric>(m)) << "="
+            << ms.p50 << "/" << ms.p99 << "/" << ms.max;
+    }
+    out << "\n";
+}
+
+// ============================================
+// 统计
+// ============================================
+void DeadlockDetector::record_scan(uint64_t scan_ns, bool found) {
+    stats_.add(STAT_DETECTIONS);
+    stats_.add(STAT_SCAN_NS, scan_ns);
+    if (found) {
+        stats_.add(STAT_DEADLOCKS);
+    }
+    last_scan_ns_.store(scan_ns, std::memory_order_relaxed);
+    if (scan_ns > max_scan_ns_.load(std::memory_order_relaxed)) {
+        max_scan_ns_.store(scan_ns, std::memory_order_relaxed);
+    }
+    graph_nodes_.store(graph_.size(), std::memory_order_relaxed);
+}
+
+void DeadlockDetector::record_snapshot_size(size_t lock_owners, size_t waiting_threads) {
+    snapshot_owners_.store(lock_owners, std::memory_order_relaxed);
+    snapshot_waiters_.store(waiting_threads, std::memory_order_relaxed);
+    if (waiting_threads > max_snapshot_waiters_.load(std::memory_order_relaxed)) {
+        max_snapshot_waiters_.store(waiting_threads, std::memory_order_relaxed);
+    }
+}
+
+DetectorStats DeadlockDetector::stats() const {
+    DetectorStats s;
+    s.lock_before_calls = stats_.sum(STAT_LOCK_BEFORE);
+    s.lock_after_calls = stats_.sum(STAT_LOCK_AFTER);
+    s.unlock_calls = stats_.sum(STAT_UNLOCK);
+    s.contended_acquisitions = stats_.sum(STAT_CONTENDED);
+    s.failed_lock_calls = stats_.sum(STAT_LOCK_FAILED);
+    s.spin_waits = stats_.sum(STAT_SPIN_WAITS);
+    s.spin_cpu_ns = stats_.sum(STAT_SPIN_NS);
+    s.self_deadlocks = stats_.sum(STAT_SELF_DEADLOCKS);
+    s.mutex_inits = stats_.sum(STAT_MUTEX_INITS);
+    s.mutex_destroys = stats_.sum(STAT_MUTEX_DESTROYS);
+    s.live_mutexes = live_mutex_count_.load(std::memory_order_relaxed);
+    s.thread_exits = stats_.sum(STAT_THREAD_EXITS);
+    s.locks_leaked_at_exit = stats_.sum(STAT_LOCKS_LEAKED);
+    s.detections_run = stats_.sum(STAT_DETECTIONS);
+    s.deadlocks_found = stats_.sum(STAT_DEADLOCKS);
+    s.scan_ns_total = stats_.sum(STAT_SCAN_NS);
+    s.last_scan_ns = last_scan_ns_.load(std::memory_order_relaxed);
+    s.max_scan_ns = max_scan_ns_.load(std::memory_order_relaxed);
+    s.snapshot_lock_owners = snapshot_owners_.load(std::memory_order_relaxed);
+    s.snapshot_waiting_threads = snapshot_waiters_.load(std::memory_order_relaxed);
+    s.max_snapshot_waiting_threads = max_snapshot_waiters_.load(std::memory_order_relaxed);
+    s.graph_nodes = graph_nodes_.load(std::memory_order_relaxed);
+    s.registered_threads = ThreadRegistry::instance().size();
+    s.report_records_dropped = AsyncReporter::instance().dropped();
+    return s;
+}
+
+// ============================================
+// 共享内存统计段
+// ============================================
+bool DeadlockDetector::publish_stats(const std::string& name) {
+    std::lock_guard<std::mutex> guard(mutex_graph_);
+    std::string segment = name.empty() ? default_stats_segment_name(static_cast<uint32_t>(getpid()))
+                                       : name;
+    if (!publisher_.open(segment)) {
+        ReportWriter() << "[DeadlockDetector] Failed to create stats segment " << segment
+                       << ", errno=" << errno << "\n";
+        return false;
+    }
+    last_published_cycle_.clear();
+    return true;
+}
+
+void DeadlockDetector::unpublish_stats() {
+    std::lock_guard<std::mutex> guard(mutex_graph_);
+    publisher_.close();
+    live_waits_.clear();
+}
+
+std::string DeadlockDetector::stats_segment_name() {
+    std::lock_guard<std::mutex> guard(mutex_graph_);
+    return publisher_.name();
+}
+
+void DeadlockDetector::stage_live_waits(
+    const std::map<uint64_t, uint64_t>& lock_owners,
+    const std::map<uint64_t, WaitRecord>& thread_waiting,
+    uint64_t now) {
+    
+    live_waits_.clear();
+    if (!publisher_.is_open()) {
+        return;
+    }
+    live_waits_.reserve(thread_waiting.size());
+    for (const auto& pair : thread_waiting) {
+        LiveWait w;
+        w.thread_id = pair.first;
+        w.lock_addr = pair.second.lock_addr;
+        auto owner = lock_owners.find(w.lock_addr);
+        w.owner_thread = owner != lock_owners.end() ? owner->second : 0;
+        w.waited_ns = now - std::min(now, pair.second.since_ns);
+        live_waits_.push_back(w);
+    }
+}
+
+void DeadlockDetector::publish_live_stats(bool found) {
+    if (!publisher_.is_open()) {
+        return;
+    }
+    DetectorStats st = stats();
+    uint64_t counters[SEG_COUNTER_COUNT];
+    counters[SEG_LOCK_BEFORE] = st.lock_before_calls;
+    counters[SEG_LOCK_AFTER] = st.lock_after_calls;
+    counters[SEG_UNLOCK] = st.unlock_calls;
+    counters[SEG_CONTENDED] = st.contended_acquisitions;
+    counters[SEG_DETECTIONS] = st.detections_run;
+    counters[SEG_DEADLOCKS] = st.deadlocks_found;
+    counters[SEG_SCAN_NS_TOTAL] = st.scan_ns_total;
+    counters[SEG_LAST_SCAN_NS] = st.last_scan_ns;
+    counters[SEG_MAX_SCAN_NS] = st.max_scan_ns;
+    counters[SEG_LOCK_OWNERS] = st.snapshot_lock_owners;
+    counters[SEG_WAITING_THREADS] = st.snapshot_waiting_threads;
+    counters[SEG_GRAPH_NODES] = graph_.size();
+    counters[SEG_GRAPH_EDGES] = graph_.edge_count();
+    counters[SEG_REGISTERED_THREADS] = st.registered_threads;
+    counters[SEG_REPORTS_DROPPED] = st.report_records_dropped;
+    counters[SEG_INTERVAL_MS] = adaptive_.load() ? current_interval_ms_.load() : interval_seconds_ * 1000;
+    publisher_.publish(counters, live_waits_, graph_.edge_count());
+    
+    if (!found) {
+        last_published_cycle_.clear();
+        return;
+    }
+    std::vector<uint64_t> threads = graph_.get_deadlocked_nodes();
+    if (threads != last_published_cycle_) {
+        publisher_.add_detection(threads);
+        last_published_cycle_.swap(threads);
+    }
 }
 
 // ============================================
 // 打印死锁信息（保持不变）
 // ============================================
 void DeadlockDetector::print_deadlock_info() {
-    std::cout << "\n";
-    std::cout << "╔════════════════════════════════════════════════╗\n";
-    std::cout << "║  ⚠️  DEADLOCK DETECTED!  ⚠️                    ║\n";
-    std::cout << "╚════════════════════════════════════════════════╝\n\n";
+    ReportWriter out; // 整段报告格式化为一条记录，异步写出
+    out << "\n";
+    out << "╔════════════════════════════════════════════════╗\n";
+    out << "║  ⚠️  DEADLOCK DETECTED!  ⚠️                    ║\n";
+    out << "╚════════════════════════════════════════════════╝\n\n";
     
     std::lock_guard<std::mutex> guard(mutex_graph_);
-    std::vector<uint64_t> deadlock_threads = graph_.get_all_nodes();
+    std::vector<uint64_t> deadlock_threads = graph_.get_deadlocked_nodes();
     
-    std::cout << "Threads involved in deadlock:\n";
+    out << "Threads involved in deadlock:\n";
     for (size_t i = 0; i < deadlock_threads.size(); i++) {
         uint64_t tid = deadlock_threads[i];
         
         uint64_t waiting_lock = 0;
+        uint64_t inline_owner = 0;
+        uint64_t spin_cpu_ns = 0;
         {
             std::lock_guard<std::mutex> g(mutex_thread_waiting_);
             auto it = thread_waiting_.find(tid);
             if (it != thread_waiting_.end()) {
-                waiting_lock = it->second;
+                waiting_lock = it->second.lock_addr;
+                spin_cpu_ns = it->second.spin_cpu_ns;
+                if (it->second.inline_owner) {
+                    inline_owner = it->second.inline_owner->load(std::memory_order_acquire);
+                }
+            }
+        }
+        if (waiting_lock == 0) {
+            std::string thread_wait;
+            if (thread_waits_.describe_wait(tid, thread_wait) || resources_.describe_wait(tid, thread_wait)) {
+                out << "  Thread " << tid << " " << thread_wait << "\n";
             }
+            continue; // 其余只是被等待的持有者（例如读锁的其他读者），自身不在等待
         }
         
-        uint64_t owner = 0;
+        uint64_t owner = inline_owner;
+        size_t readers = 0;
+        uint64_t generation = 0;
         {
             std::lock_guard<std::mutex> g(mutex_lock_owners_);
             auto it = lock_owners_.find(waiting_lock);
             if (it != lock_owners_.end()) {
                 owner = it->second;
             }
+            auto life = live_mutexes_.find(waiting_lock);
+            if (life != live_mutexes_.end()) {
+                generation = life->second.generation;
+            }
+            auto r = rwlock_readers_.find(waiting_lock);
+            if (r != rwlock_readers_.end()) {
+                readers = r->second.size();
+            }
+        }
+        
+        if (spin_cpu_ns != 0) {
+            uint64_t holder = ThreadRegistry::instance().find_spin_holder(waiting_lock);
+            uint64_t cpu_now = thread_cpu_ns_of(tid);
+            out << "  Thread " << tid << " is spinning on spinlock 0x" << std::hex << waiting_lock << std::dec
+                << " (held by Thread " << holder << "), "
+                << (cpu_now - std::min(cpu_now, spin_cpu_ns)) / 1000000 << " ms CPU burnt spinning\n";
+            continue;
         }
         
-        std::cout << "  Thread " << tid 
-                  << " is waiting for lock 0x" << std::hex << waiting_lock << std::dec
-                  << " (held by Thread " << owner << ")\n";
+        out << "  Thread " << tid 
+            << " is waiting for lock 0x" << std::hex << waiting_lock << std::dec;
+        if (generation != 0) {
+            out << " (gen " << generation << ")";
+        }
+        if (owner != 0 || readers == 0) {
+            out << " (held by Thread " << owner << ")\n";
+        } else {
+            out << " (held for reading by " << readers << " thread(s))\n";
+        }
     }
     
-    graph_.print_graph();
+    graph_.print_graph(out);
     
-    std::cout << " Recommendation: Check the lock acquisition order in your code!\n\n";
+    out << " Recommendation: Check the lock acquisition order in your code!\n\n";
 }
 
 // 该死锁检测循环函数由函数指针传给自己创建的检测线程调用，并不影响业务线程的运行，而是与业务线程并发运行。 
@@ -170,34 +1520,149 @@ void DeadlockDetector::print_deadlock_info() {
 // 新增：后台检测线程的主循环
 // ============================================
 void DeadlockDetector::detector_loop() {
-    std::cout << "[Detector Thread] Started, checking every " 
-              << interval_seconds_ << " second(s)\n";
+    if (adaptive_.load()) {
+        ReportWriter() << "[Detector Thread] Started, adaptive interval starting at "
+                       << current_interval_ms_.load() << " ms\n";
+    } else {
+        ReportWriter() << "[Detector Thread] Started, checking every " 
+                       << interval_seconds_ << " second(s)\n";
+    }
     
     while (running_.load()) {
-        // 等待检测间隔
-        std::this_thread::sleep_for(std::chrono::seconds(interval_seconds_));
+        // 等待检测间隔（stop() 会提前唤醒）
+        int interval_ms = adaptive_.load() ? current_interval_ms_.load()
+                                           : interval_seconds_ * 1000;
+        {
+            std::unique_lock<std::mutex> lk(mutex_sleep_);
+            cv_sleep_.wait_for(lk, std::chrono::milliseconds(interval_ms),
+                               [this] { return !running_.load(); });
+        }
+        if (!running_.load()) {
+            break;
+        }
         
-        // 执行检测
-        if (check_deadlock()) {
-            // 检测到死锁
-            if (!deadlock_detected_.load()) {
-                // 第一次检测到，打印报警
-                deadlock_detected_.store(true);
-                
-                std::cout << "\n[Detector Thread] ⚠️  Deadlock detected at "
-                          << std::time(nullptr) << "\n";
-                print_deadlock_info();
-                
-                // 发现死锁后退出检测循环
-                break;
-            }
+        // 执行检测，同时统计本线程消耗的 CPU 时间
+        struct timespec cpu_begin, cpu_end;
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpu_begin);
+        bool found = check_deadlock();
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpu_end);
+        
+        uint64_t scan_cpu_ns =
+            static_cast<uint64_t>(cpu_end.tv_sec - cpu_begin.tv_sec) * 1000000000ull +
+            cpu_end.tv_nsec - cpu_begin.tv_nsec;
+        
+        if (adaptive_.load()) {
+            current_interval_ms_.store(next_interval_ms(interval_ms, scan_cpu_ns));
+        }
+        
+        if (found && !deadlock_detected_.load()) {
+            // 第一次检测到，打印报警
+            report_deadlock_once("Detector Thread");
+            
+            // 发现死锁后退出检测循环
+            break;
         }
         // else{ // 检验死锁检测间隔时用
         //    std::cout << "There's no deadlock in the last " << interval_seconds_ << " second" << "\n";
         // }
     }
     
-    std::cout << "[Detector Thread] Stopped\n";
+    ReportWriter() << "[Detector Thread] Stopped\n";
+}
+
+// ============================================
+// 统一的死锁报告（后台线程与事件循环模式共用）
+// ============================================
+void DeadlockDetector::report_self_deadlock(uint64_t thread_id, uint64_t lock_addr, const char* site) {
+    stats_.add(STAT_SELF_DEADLOCKS);
+    
+    // 第一次获取的位置：只读本线程的持有栈
+    const char* held_site = held_site_of(ThreadRegistry::current(), lock_addr);
+    
+    if (deadlock_detected_.exchange(true)) {
+        return;
+    }
+    ReportWriter out;
+    out << "\n╔════════════════════════════════════════════════╗\n";
+    out << "║  ⚠️  SELF-DEADLOCK DETECTED!  ⚠️               ║\n";
+    out << "╚════════════════════════════════════════════════╝\n\n";
+    out << "  Thread " << thread_id << " is locking non-recursive mutex 0x" << std::hex << lock_addr << std::dec
+        << " at " << (site ? site : "?") << "\n";
+    out << "  but already holds it (acquired at " << (held_site ? held_site : "?") << ")\n\n";
+    out << " Recommendation: Use a recursive mutex or release the lock before re-acquiring it!\n\n";
+}
+
+void DeadlockDetector::report_deadlock_once(const char* source) {
+    if (deadlock_detected_.exchange(true)) {
+        return;
+    }
+    ReportWriter() << "\n[" << source << "] ⚠️  Deadlock detected at "
+                   << std::time(nullptr) << "\n";
+    print_deadlock_info();
+}
+
+// ============================================
+// 自适应检测间隔
+// 1. 没有线程在等待：间隔翻倍（指数退避），直到 max_interval_ms
+// 2. 有等待但都还短：保持当前间隔不再退避，并且不晚于最久的等待跨过 long_wait_ms 的时刻
+// 3. 出现长等待：按长等待数量成比例收紧，直到 min_interval_ms
+// 4. CPU 预算：间隔不得小于 检测CPU耗时 / cpu_budget（预算优先于上限）
+// ============================================
+void DeadlockDetector::set_adaptive(const AdaptiveIntervalConfig& config) {
+    {
+        std::lock_guard<std::mutex> guard(mutex_sleep_);
+        adaptive_config_ = config;
+    }
+    current_interval_ms_.store(config.min_interval_ms);
+    adaptive_.store(true);
+}
+
+uint64_t DeadlockDetector::long_wait_threshold_ns() {
+    std::lock_guard<std::mutex> guard(mutex_sleep_);
+    return static_cast<uint64_t>(adaptive_config_.long_wait_ms) * 1000000ull;
+}
+
+int DeadlockDetector::next_interval_ms(int current_ms, uint64_t scan_cpu_ns) {
+    AdaptiveIntervalConfig config;
+    {
+        std::lock_guard<std::mutex> guard(mutex_sleep_);
+        config = adaptive_config_;
+    }
+    
+    size_t waits = 0;
+    size_t long_waits = 0;
+    uint64_t oldest_wait_ns = 0;
+    {
+        std::lock_guard<std::mutex> guard(mutex_graph_);
+        waits = last_wait_count_;
+        long_waits = last_long_wait_count_;
+        oldest_wait_ns = last_oldest_wait_ns_;
+    }
+    
+    // 检测开销做指数滑动平均，避免单次抖动导致间隔剧烈变化
+    scan_cpu_ns_avg_ = scan_cpu_ns_avg_ == 0 ? scan_cpu_ns
+                                             : (scan_cpu_ns_avg_ * 7 + scan_cpu_ns) / 8;
+    
+    int64_t next = current_ms;
+    uint64_t long_wait_ns = static_cast<uint64_t>(config.long_wait_ms) * 1000000ull;
+    if (long_waits > 0) {
+        next = current_ms / static_cast<int64_t>(1 + long_waits);
+    } else if (waits > 0) {
+        // 例如单个等待已到 0.9 × long_wait_ms：下一次检测提前到它变成长等待的时刻
+        uint64_t remaining_ns = long_wait_ns > oldest_wait_ns ? long_wait_ns - oldest_wait_ns : 0;
+        next = std::min<int64_t>(current_ms, static_cast<int64_t>(remaining_ns / 1000000ull));
+    } else {
+        next = static_cast<int64_t>(current_ms) * 2;
+    }
+    next = std::max<int64_t>(next, config.min_interval_ms);
+    next = std::min<int64_t>(next, config.max_interval_ms);
+    
+    if (config.cpu_budget > 0) {
+        int64_t budget_floor_ms = static_cast<int64_t>(
+            static_cast<double>(scan_cpu_ns_avg_) / config.cpu_budget / 1000000.0);
+        next = std::max(next, budget_floor_ms);
+    }
+    return static_cast<int>(std::max<int64_t>(next, 1));
 }
 
 // ============================================
@@ -205,7 +1670,7 @@ void DeadlockDetector::detector_loop() {
 // ============================================
 void DeadlockDetector::start(int interval_seconds) {
     if (running_.load()) {
-        std::cout << "[Warning] Detector thread is already running!\n";
+        ReportWriter() << "[Warning] Detector thread is already running!\n";
         return;
     }
     
@@ -216,7 +1681,161 @@ void DeadlockDetector::start(int interval_seconds) {
     // 创建检测线程
     detector_thread_ = std::thread(&DeadlockDetector::detector_loop, this);
     
-    std::cout << "[DeadlockDetector] Background detection started\n";
+    ReportWriter() << "[DeadlockDetector] Background detection started\n";
+}
+
+// ============================================
+// 宿主事件循环集成：timerfd + 分片检测
+// ============================================
+int DeadlockDetector::event_fd() {
+    if (timer_fd_ >= 0) {
+        return timer_fd_;
+    }
+    timer_fd_ = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (timer_fd_ < 0) {
+        ReportWriter() << "[DeadlockDetector] timerfd_create failed, errno=" << errno << "\n";
+        return -1;
+    }
+    deadlock_detected_.store(false);
+    arm_timer(adaptive_.load() ? current_interval_ms_.load() : interval_seconds_ * 1000);
+    return timer_fd_;
+}
+
+void DeadlockDetector::arm_timer(int interval_ms) {
+    if (timer_fd_ < 0 || interval_ms == timer_armed_ms_) {
+        return;
+    }
+    struct itimerspec spec;
+    spec.it_interval.tv_sec = interval_ms / 1000;
+    spec.it_interval.tv_nsec = static_cast<long>(interval_ms % 1000) * 1000000L;
+    spec.it_value = spec.it_interval;
+    timerfd_settime(timer_fd_, 0, &spec, nullptr);
+    timer_armed_ms_ = interval_ms;
+}
+
+void DeadlockDetector::close_event_fd() {
+    if (timer_fd_ >= 0) {
+        close(timer_fd_);
+        timer_fd_ = -1;
+    }
+    timer_armed_ms_ = 0;
+    poll_phase_ = POLL_IDLE;
+    poll_lock_owners_.clear();
+    poll_rwlock_readers_.clear();
+    poll_thread_waiting_.clear();
+    poll_graph_.clear();
+}
+
+// 一轮扫描拆成四个阶段，每次调用只推进一个阶段（或建图阶段的一个分片）：
+//   POLL_IDLE     定时器到期后拍快照，O(锁表 + 等待表) 的一次拷贝，线程间等待边同时取下
+//   POLL_BUILD    每次最多为 max_waiters 个等待线程加边
+//   POLL_CYCLE    换入新图并判环，O(V + E)
+//   POLL_WATCHDOG 长等待/长持锁看门狗与剖析输出，开销与需要报告的线程数成正比
+// 只有建图阶段受 max_waiters 约束；快照、判环和看门狗各占一次完整调用。
+bool DeadlockDetector::poll_once(size_t max_waiters) {
+    if (timer_fd_ < 0 || max_waiters == 0) {
+        return false;
+    }
+    
+    uint64_t cpu_begin = thread_cpu_now_ns();
+    bool found = false;
+    
+    switch (poll_phase_) {
+    case POLL_IDLE: {
+        // 没有进行中的扫描时，只有定时器到期才开始新一轮
+        uint64_t expirations = 0;
+        if (read(timer_fd_, &expirations, sizeof(expirations)) != sizeof(expirations)) {
+            return false; // EAGAIN：还没到检测时间
+        }
+        std::map<uint64_t, std::string> thread_stacks_snapshot;
+        poll_pass_.clear();
+        get_snapshot(poll_lock_owners_, poll_rwlock_readers_, poll_thread_waiting_, thread_stacks_snapshot,
+                     &poll_pass_);
+        // join / 任务 / 信号量 / 屏障的等待边与锁表在同一时刻取下，和锁表一起留到建图阶段：
+        // 分片之间宿主可能隔很久，过时的锁边配上当前的 join 边可能拼出从未存在过的环
+        poll_graph_.clear();
+        add_thread_waits(poll_graph_);
+        record_snapshot_size(poll_lock_owners_.size(), poll_thread_waiting_.size());
+        poll_next_ = poll_thread_waiting_.begin();
+        poll_long_wait_count_ = 0;
+        poll_oldest_wait_ns_ = 0;
+        poll_cpu_ns_ = 0;
+        poll_phase_ = POLL_BUILD;
+        break;
+    }
+    
+    case POLL_BUILD: {
+        // 本分片最多处理 max_waiters 个等待线程
+        uint64_t slice_begin = precise_now_ns();
+        uint64_t now = coarse_now_ns();
+        uint64_t long_wait_ns = long_wait_threshold_ns();
+        for (size_t n = 0; n < max_waiters && poll_next_ != poll_thread_waiting_.end(); ++n, ++poll_next_) {
+            const WaitRecord& wait = poll_next_->second;
+            uint64_t waited = now > wait.since_ns ? now - wait.since_ns : 0;
+            poll_oldest_wait_ns_ = std::max(poll_oldest_wait_ns_, waited);
+            if (waited >= long_wait_ns) {
+                poll_long_wait_count_++;
+            }
+            
+            add_wait_edges(poll_graph_, poll_next_->first, wait, poll_lock_owners_, poll_rwlock_readers_);
+        }
+        poll_pass_[PASS_BUILD_NS] += precise_now_ns() - slice_begin;
+        if (poll_next_ == poll_thread_waiting_.end()) {
+            poll_phase_ = POLL_CYCLE;
+        }
+        break;
+    }
+    
+    case POLL_CYCLE: {
+        // 图构建完成，整体替换并判环
+        std::lock_guard<std::mutex> guard(mutex_graph_);
+        graph_.swap(poll_graph_);
+        last_wait_count_ = poll_thread_waiting_.size();
+        last_long_wait_count_ = poll_long_wait_count_;
+        last_oldest_wait_ns_ = poll_oldest_wait_ns_;
+        uint64_t cycle_begin = precise_now_ns();
+        found = graph_.has_deadlock();
+        poll_pass_[PASS_CYCLE_NS] = precise_now_ns() - cycle_begin;
+        poll_pass_[PASS_TOTAL_NS] = poll_pass_[PASS_SNAPSHOT_NS] + poll_pass_[PASS_BUILD_NS] +
+                                    poll_pass_[PASS_CYCLE_NS];
+        record_pass(poll_pass_);
+        // 与 check_deadlock 一致，扫描统计记录的是墙钟时间（快照 + 建图 + 判环）
+        record_scan(poll_pass_[PASS_TOTAL_NS], found);
+        stage_live_waits(poll_lock_owners_, poll_thread_waiting_, coarse_now_ns());
+        publish_live_stats(found);
+        poll_phase_ = POLL_WATCHDOG;
+        break;
+    }
+    
+    case POLL_WATCHDOG: {
+        {
+            std::lock_guard<std::mutex> guard(mutex_graph_);
+            check_long_waits(poll_lock_owners_, poll_rwlock_readers_, poll_thread_waiting_, coarse_now_ns());
+            check_long_holds();
+            maybe_dump_profile();
+        }
+        poll_phase_ = POLL_IDLE;
+        poll_lock_owners_.clear();
+        poll_rwlock_readers_.clear();
+        poll_thread_waiting_.clear();
+        poll_graph_.clear();
+        
+        // 本轮最后一次调用：CPU 时间先累计完整，再据此调整间隔
+        poll_cpu_ns_ += thread_cpu_now_ns() - cpu_begin;
+        if (adaptive_.load()) {
+            int next = next_interval_ms(current_interval_ms_.load(), poll_cpu_ns_);
+            current_interval_ms_.store(next);
+            arm_timer(next);
+        }
+        return false;
+    }
+    }
+    
+    if (found && !deadlock_detected_.load()) {
+        report_deadlock_once("Event Loop");
+    }
+    poll_cpu_ns_ += thread_cpu_now_ns() - cpu_begin;
+    return found;
 }
 
 // 必须在死锁检测结束后调用，手动释放死锁检测进程
@@ -228,41 +1847,82 @@ void DeadlockDetector::stop() {
         return; // 已经停止
     }
     
-    std::cout << "[DeadlockDetector] Stopping background detection...\n";
+    ReportWriter() << "[DeadlockDetector] Stopping background detection...\n";
     
-    running_.store(false);
+    {
+        std::lock_guard<std::mutex> guard(mutex_sleep_);
+        running_.store(false);
+    }
+    cv_sleep_.notify_all();
     
     // 等待检测线程退出
     if (detector_thread_.joinable()) {
         detector_thread_.join();
     }
     
-    std::cout << "[DeadlockDetector] Background detection stopped\n";
+    ReportWriter() << "[DeadlockDetector] Background detection stopped\n";
+    
+    // 停止时把积压的报告写完，保证调用方随后看到完整输出
+    AsyncReporter::instance().flush();
 }
 
 // ============================================
 // 打印状态（保持不变）
 // ============================================
 void DeadlockDetector::print_status() {
-    std::cout << "\n========== Deadlock Detector Status ==========\n";
+    ReportWriter out; // 整段报告格式化为一条记录，异步写出
+    out << "\n========== Deadlock Detector Status ==========\n";
     
     std::map<uint64_t, uint64_t> lock_owners_snapshot;
-    std::map<uint64_t, uint64_t> thread_waiting_snapshot;
+    ReaderMap rwlock_readers_snapshot;
+    std::map<uint64_t, WaitRecord> thread_waiting_snapshot;
     std::map<uint64_t, std::string> thread_stacks_snapshot;
     
-    get_snapshot(lock_owners_snapshot, thread_waiting_snapshot, thread_stacks_snapshot);
+    get_snapshot(lock_owners_snapshot, rwlock_readers_snapshot, thread_waiting_snapshot, thread_stacks_snapshot);
     
-    std::cout << "Lock Owners (" << lock_owners_snapshot.size() << " locks held):\n";
+    out << "Lock Owners (" << lock_owners_snapshot.size() << " locks held):\n";
     for (const auto& pair : lock_owners_snapshot) {
-        std::cout << "  Lock 0x" << std::hex << pair.first 
-                  << " → Thread " << std::dec << pair.second << "\n";
+        uint64_t generation = lock_generation(pair.first);
+        out << "  Lock 0x" << std::hex << pair.first << std::dec;
+        if (generation != 0) {
+            out << " (gen " << generation << ")";
+        }
+        out << " → Thread " << pair.second << "\n";
+    }
+    for (const auto& pair : rwlock_readers_snapshot) {
+        out << "  RWLock 0x" << std::hex << pair.first << std::dec
+            << " → " << pair.second.size() << " reader(s)\n";
     }
     
-    std::cout << "Threads Waiting (" << thread_waiting_snapshot.size() << " threads):\n";
+    out << "Threads Waiting (" << thread_waiting_snapshot.size() << " threads):\n";
     for (const auto& pair : thread_waiting_snapshot) {
-        std::cout << "  Thread " << pair.first 
-                  << " → waiting for lock 0x" << std::hex << pair.second << std::dec << "\n";
+        out << "  Thread " << pair.first 
+            << " → waiting for lock 0x" << std::hex << pair.second.lock_addr << std::dec << "\n";
     }
     
-    std::cout << "=============================================\n\n";
-}
\ No newline at end of file
+    std::map<uint64_t, CondWaitRecord> cond_waiting_snapshot;
+    {
+        std::lock_guard<std::mutex> guard(mutex_thread_waiting_);
+        cond_waiting_snapshot = cond_waiting_;
+    }
+    if (!cond_waiting_snapshot.empty()) {
+        out << "Condition Waits (" << cond_waiting_snapshot.size() << " threads):\n";
+        for (const auto& pair : cond_waiting_snapshot) {
+            out << "  Thread " << pair.first << " → condition 0x" << std::hex << pair.second.cond_addr
+                << " (mutex 0x" << pair.second.mutex_addr << ")" << std::dec << "\n";
+        }
+    }
+    
+    DetectorStats st = stats();
+    out << "Stats: " << st.lock_after_calls << " acquisitions, " << st.unlock_calls << " unlocks, "
+        << st.failed_lock_calls << " failed trylock/timedlock, "
+        << st.spin_waits << " spin waits (" << st.spin_cpu_ns / 1000000 << " ms CPU spinning), "
+        << st.detections_run << " detections (last " << st.last_scan_ns / 1000 << " us, max "
+        << st.max_scan_ns / 1000 << " us), " << st.deadlocks_found << " deadlock(s), "
+        << st.self_deadlocks << " self-deadlock(s), "
+        << st.live_mutexes << " live mutex(es) (" << st.mutex_inits << " init, "
+        << st.mutex_destroys << " destroyed), " << st.registered_threads << " live thread(s) ("
+        << st.thread_exits << " exited, " << st.locks_leaked_at_exit << " lock(s) leaked at exit)\n";
+    
+    out << "=============================================\n\n";
+}
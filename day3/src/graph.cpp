@@ -1,6 +1,8 @@
 #include "graph.h"
-#include <iostream>
+#include "report_sink.h"
 #include <iomanip>
+#include <algorithm>
+#include <unordered_map>
 
 // ============================================
 // 确保节点存在于图中
@@ -24,6 +26,7 @@ void DirectedGraph::add_edge(uint64_t from, uint64_t to) {
     
     // 3. to 的入度 +1（因为有一条边指向它）
     graph_[to].indegree++;
+    edges_++;
 }
 
 // ============================================
@@ -78,6 +81,182 @@ bool DirectedGraph::has_cycle() {
     return processed_count < graph_.size();
 }
 
+// ============================================
+// 资源分配图（RAG）
+// ============================================
+void DirectedGraph::set_wait_any(uint64_t node) {
+    ensure_node_exists(node);
+    GraphVertex& vertex = graph_[node];
+    if (!vertex.wait_any) {
+        vertex.wait_any = true;
+        wait_any_count_++;
+    }
+}
+
+void DirectedGraph::add_resource(uint64_t resource, uint32_t available) {
+    resources_[resource].available = available;
+}
+
+void DirectedGraph::add_allocation(uint64_t resource, uint64_t thread, uint32_t units) {
+    ensure_node_exists(thread);
+    graph_[thread].holds.push_back(std::make_pair(resource, units));
+    edges_++;
+}
+
+void DirectedGraph::add_request(uint64_t thread, uint64_t resource, uint32_t units) {
+    ensure_node_exists(thread);
+    resources_[resource].requests.push_back(std::make_pair(units, thread));
+    edges_++;
+}
+
+bool DirectedGraph::has_deadlock() {
+    if (resources_.empty() && wait_any_count_ == 0) {
+        reduced_ = false;
+        return has_cycle();
+    }
+    reduced_ = true;
+    return reduce();
+}
+
+std::vector<uint64_t> DirectedGraph::get_deadlocked_nodes() const {
+    return reduced_ ? blocked_ : get_all_nodes();
+}
+
+// ============================================
+// 图归约（Holt）
+// pending[t]：线程 t 还有多少个等待未被满足（"或"节点最多为 1）。
+// 为 0 的线程可以运行结束：移除它，满足等待它的线程，并把它持有的单位还给资源。
+// 归约过程中资源的空闲单位只增不减，因此每个资源的请求按单位数排序后用一个游标推进，
+// 每条边只处理一次
+// ============================================
+bool DirectedGraph::reduce() {
+    blocked_.clear();
+    size_t n = graph_.size();
+    if (n == 0) {
+        return false;
+    }
+    
+    // Step 1: 节点编号为稠密下标，建立反向边（CSR）
+    std::unordered_map<uint64_t, size_t> index;
+    index.reserve(n * 2);
+    std::vector<uint64_t> ids;
+    std::vector<const GraphVertex*> vertices;
+    ids.reserve(n);
+    vertices.reserve(n);
+    for (const auto& pair : graph_) {
+        index[pair.first] = ids.size();
+        ids.push_back(pair.first);
+        vertices.push_back(&pair.second);
+    }
+    
+    std::vector<size_t> waiters_begin(n + 1, 0);
+    for (size_t i = 0; i < n; i++) {
+        for (uint64_t neighbor : vertices[i]->neighbors) {
+            waiters_begin[index[neighbor] + 1]++;
+        }
+    }
+    for (size_t i = 0; i < n; i++) {
+        waiters_begin[i + 1] += waiters_begin[i];
+    }
+    std::vector<size_t> waiters(waiters_begin[n]);
+    std::vector<size_t> fill(waiters_begin.begin(), waiters_begin.end() - 1);
+    std::vector<size_t> pending(n, 0);
+    for (size_t i = 0; i < n; i++) {
+        for (uint64_t neighbor : vertices[i]->neighbors) {
+            waiters[fill[index[neighbor]]++] = i;
+        }
+        pending[i] = vertices[i]->neighbors.size();
+    }
+    
+    // Step 2: 资源请求计入 pending，每个资源的请求按单位数升序排列
+    struct ResourceState {
+        uint64_t available;
+        std::vector<std::pair<uint32_t, size_t> > requests;
+        size_t next;
+    };
+    std::unordered_map<uint64_t, size_t> resource_index;
+    resource_index.reserve(resources_.size() * 2);
+    std::vector<ResourceState> resources(resources_.size());
+    size_t r = 0;
+    for (const auto& pair : resources_) {
+        resource_index[pair.first] = r;
+        ResourceState& state = resources[r++];
+        state.available = pair.second.available;
+        state.next = 0;
+        state.requests.reserve(pair.second.requests.size());
+        for (const auto& request : pair.second.requests) {
+            size_t thread = index[request.second];
+            state.requests.push_back(std::make_pair(request.first, thread));
+            pending[thread]++;
+        }
+        std::sort(state.requests.begin(), state.requests.end());
+    }
+    for (size_t i = 0; i < n; i++) {
+        if (vertices[i]->wait_any && pending[i] > 0) {
+            pending[i] = 1;
+        }
+    }
+    
+    // Step 3: 归约
+    std::deque<size_t> queue;
+    for (size_t i = 0; i < n; i++) {
+        if (pending[i] == 0) {
+            queue.push_back(i);
+        }
+    }
+    
+    // 满足线程 t 的一个等待（"或"节点一次满足即可）
+    auto satisfy = [&](size_t t) {
+        if (pending[t] == 0) {
+            return; // 已经入队
+        }
+        pending[t] = vertices[t]->wait_any ? 0 : pending[t] - 1;
+        if (pending[t] == 0) {
+            queue.push_back(t);
+        }
+    };
+    
+    // 满足资源上所有单位数不超过空闲单位数的请求
+    auto grant = [&](ResourceState& state) {
+        while (state.next < state.requests.size() &&
+               state.requests[state.next].first <= state.available) {
+            satisfy(state.requests[state.next].second);
+            state.next++;
+        }
+    };
+    
+    for (size_t i = 0; i < resources.size(); i++) {
+        grant(resources[i]);
+    }
+    
+    std::vector<bool> removed(n, false);
+    while (!queue.empty()) {
+        size_t t = queue.front();
+        queue.pop_front();
+        removed[t] = true;
+        
+        for (size_t w = waiters_begin[t]; w < waiters_begin[t + 1]; w++) {
+            satisfy(waiters[w]);
+        }
+        for (const auto& hold : vertices[t]->holds) {
+            auto it = resource_index.find(hold.first);
+            if (it == resource_index.end()) {
+                continue; // 没有人在等这个资源
+            }
+            resources[it->second].available += hold.second;
+            grant(resources[it->second]);
+        }
+    }
+    
+    // Step 4: 无法移除的线程即死锁
+    for (size_t i = 0; i < n; i++) {
+        if (!removed[i]) {
+            blocked_.push_back(ids[i]);
+        }
+    }
+    return !blocked_.empty();
+}
+
 // ============================================
 // 获取所有节点ID
 // ============================================
@@ -94,31 +273,62 @@ std::vector<uint64_t> DirectedGraph::get_all_nodes() const {
 // ============================================
 void DirectedGraph::clear() {
     graph_.clear();
+    edges_ = 0;
+    resources_.clear();
+    wait_any_count_ = 0;
+    blocked_.clear();
+    reduced_ = false;
 }
 
 // ============================================
 // 打印图结构（调试用）
 // ============================================
 void DirectedGraph::print_graph() const {
-    std::cout << "\n========== Graph Structure ==========\n";
-    std::cout << "Total nodes: " << graph_.size() << "\n";
+    ReportWriter out;
+    print_graph(out);
+}
+
+void DirectedGraph::print_graph(ReportWriter& out) const {
+    out << "\n========== Graph Structure ==========\n";
+    out << "Total nodes: " << graph_.size() << "\n";
     
     for (const auto& pair : graph_) {
         uint64_t node_id = pair.first;
         const GraphVertex& vertex = pair.second;
         
-        std::cout << "Thread " << node_id 
-                  << " (indegree=" << vertex.indegree << ")";
+        out << "Thread " << node_id 
+            << " (indegree=" << vertex.indegree << ")";
         
         if (!vertex.neighbors.empty()) {
-            std::cout << " → [";
+            out << (vertex.wait_any ? " → any of [" : " → [");
             for (size_t i = 0; i < vertex.neighbors.size(); i++) {
-                if (i > 0) std::cout << ", ";
-                std::cout << vertex.neighbors[i];
+                if (i > 0) out << ", ";
+                out << vertex.neighbors[i];
+            }
+            out << "]";
+        }
+        if (!vertex.holds.empty()) {
+            out << " holds [";
+            for (size_t i = 0; i < vertex.holds.size(); i++) {
+                if (i > 0) out << ", ";
+                out << "0x" << std::hex << vertex.holds[i].first << std::dec << " x" << vertex.holds[i].second;
+            }
+            out << "]";
+        }
+        out << "\n";
+    }
+    for (const auto& pair : resources_) {
+        out << "Resource 0x" << std::hex << pair.first << std::dec
+            << " (available=" << pair.second.available << ")";
+        if (!pair.second.requests.empty()) {
+            out << " ← requested by [";
+            for (size_t i = 0; i < pair.second.requests.size(); i++) {
+                if (i > 0) out << ", ";
+                out << pair.second.requests[i].second << " x" << pair.second.requests[i].first;
             }
-            std::cout << "]";
+            out << "]";
         }
-        std::cout << "\n";
+        out << "\n";
     }
-    std::cout << "====================================\n\n";
+    out << "====================================\n\n";
 }
\ No newline at end of file
@@ -0,0 +1,157 @@
+#include "heavy_hitters.h"
+#include <algorithm>
+
+void SpaceSaving::clear() {
+    std::lock_guard<std::mutex> guard(mutex_);
+    for (size_t i = 0; i < kIndexSize; i++) {
+        index_[i] = -1;
+    }
+    size_ = 0;
+    total_ = 0;
+}
+
+uint64_t SpaceSaving::total() const {
+    std::lock_guard<std::mutex> guard(mutex_);
+    return total_;
+}
+
+// ============================================
+// 索引：线性探测 + 向后移位删除（不留墓碑，探测链始终紧凑）
+// ============================================
+long SpaceSaving::find_slot(uint64_t key) const {
+    size_t i = hash(key);
+    for (size_t probes = 0; probes < kIndexSize; probes++) {
+        int32_t pos = index_[i];
+        if (pos < 0) {
+            return -1;
+        }
+        if (heap_[pos].key == key) {
+            return static_cast<long>(i);
+        }
+        i = (i + 1) & (kIndexSize - 1);
+    }
+    return -1;
+}
+
+void SpaceSaving::insert_index(uint32_t heap_pos) {
+    size_t i = hash(heap_[heap_pos].key);
+    while (index_[i] >= 0) {
+        i = (i + 1) & (kIndexSize - 1);
+    }
+    index_[i] = static_cast<int32_t>(heap_pos);
+    heap_[heap_pos].slot = static_cast<uint32_t>(i);
+}
+
+void SpaceSaving::erase_index(uint32_t slot) {
+    size_t hole = slot;
+    size_t i = (hole + 1) & (kIndexSize - 1);
+    while (index_[i] >= 0) {
+        size_t home = hash(heap_[index_[i]].key);
+        // 若 i 的理想位置不在 (hole, i] 区间内，则可以前移填补空洞
+        bool movable = (i > hole) ? (home <= hole || home > i)
+                                  : (home <= hole && home > i);
+        if (movable) {
+            index_[hole] = index_[i];
+            heap_[index_[hole]].slot = static_cast<uint32_t>(hole);
+            hole = i;
+        }
+        i = (i + 1) & (kIndexSize - 1);
+    }
+    index_[hole] = -1;
+}
+
+// ============================================
+// 最小堆（按 count）
+// ============================================
+void SpaceSaving::swap_heap(size_t a, size_t b) {
+    std::swap(heap_[a], heap_[b]);
+    index_[heap_[a].slot] = static_cast<int32_t>(a);
+    index_[heap_[b].slot] = static_cast<int32_t>(b);
+}
+
+void SpaceSaving::sift_down(size_t pos) {
+    for (;;) {
+        size_t smallest = pos;
+        size_t left = pos * 2 + 1;
+        size_t right = left + 1;
+        if (left < size_ && heap_[left].count < heap_[smallest].count) smallest = left;
+        if (right < size_ && heap_[right].count < heap_[smallest].count) smallest = right;
+        if (smallest == pos) {
+            return;
+        }
+        swap_heap(pos, smallest);
+        pos = smallest;
+    }
+}
+
+void SpaceSaving::sift_up(size_t pos) {
+    while (pos > 0) {
+        size_t parent = (pos - 1) / 2;
+        if (heap_[parent].count <= heap_[pos].count) {
+            return;
+        }
+        swap_heap(pos, parent);
+        pos = parent;
+    }
+}
+
+// ============================================
+// Space-Saving 更新规则
+// 1. 已监控：计数 += weight
+// 2. 未监控且有空位：新建计数器
+// 3. 未监控且已满：替换计数最小者，新计数 = 最小计数 + weight，error = 最小计数
+// ============================================
+void SpaceSaving::offer(uint64_t key, uint64_t weight) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    total_ += weight;
+
+    long slot = find_slot(key);
+    if (slot >= 0) {
+        size_t pos = static_cast<size_t>(index_[slot]);
+        heap_[pos].count += weight;
+        sift_down(pos); // 计数只增不减，只可能下沉
+        return;
+    }
+
+    if (size_ < kCapacity) {
+        size_t pos = size_++;
+        heap_[pos].key = key;
+        heap_[pos].count = weight;
+        heap_[pos].error = 0;
+        insert_index(static_cast<uint32_t>(pos));
+        sift_up(pos);
+        return;
+    }
+
+    // 替换堆顶（最小计数）
+    uint64_t min_count = heap_[0].count;
+    erase_index(heap_[0].slot);
+    heap_[0].key = key;
+    heap_[0].count = min_count + weight;
+    heap_[0].error = min_count;
+    insert_index(0);
+    sift_down(0);
+}
+
+std::vector<SpaceSaving::Item> SpaceSaving::top(size_t n) const {
+    std::vector<Item> items;
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        items.reserve(size_);
+        for (size_t i = 0; i < size_; i++) {
+            Item item;
+            item.key = heap_[i].key;
+            item.count = heap_[i].count;
+            item.error = heap_[i].error;
+            items.push_back(item);
+        }
+    }
+    auto more = [](const Item& a, const Item& b) { return a.count > b.count; };
+    if (items.size() > n) {
+        std::partial_sort(items.begin(), items.begin() + n, items.end(), more);
+        items.resize(n);
+    } else {
+        std::sort(items.begin(), items.end(), more);
+    }
+    return items;
+}
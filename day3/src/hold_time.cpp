@@ -0,0 +1,171 @@
+#include "hold_time.h"
+
+// ============================================
+// 配置
+// ============================================
+HoldTimeTracker::HoldTimeTracker()
+    : enabled_(false),
+      default_budget_ns_(0),
+      class_budgets_set_(0),
+      ring_pos_(0) {
+    for (size_t i = 0; i < kMaxLockClasses; i++) {
+        class_budget_ns_[i].store(0, std::memory_order_relaxed);
+    }
+    for (size_t i = 0; i < kViolationRingSize; i++) {
+        ring_[i].seq.store(0, std::memory_order_relaxed);
+    }
+}
+
+void HoldTimeTracker::update_enabled() {
+    bool on = default_budget_ns_.load() > 0 ||
+              class_budgets_set_.load() > 0 ||
+              lock_budgets_.size() > 0;
+    enabled_.store(on);
+}
+
+void HoldTimeTracker::set_default_budget_ns(uint64_t budget_ns) {
+    default_budget_ns_.store(budget_ns);
+    update_enabled();
+}
+
+bool HoldTimeTracker::set_lock_budget_ns(uint64_t lock_addr, uint64_t budget_ns) {
+    bool ok = budget_ns > 0 ? lock_budgets_.put(lock_addr, budget_ns)
+                            : (lock_budgets_.erase(lock_addr), true);
+    update_enabled();
+    return ok;
+}
+
+bool HoldTimeTracker::set_lock_class(uint64_t lock_addr, uint32_t class_id) {
+    if (class_id >= kMaxLockClasses) {
+        return false;
+    }
+    // 存 class_id + 1，0 表示未分类
+    return lock_classes_.put(lock_addr, class_id + 1);
+}
+
+void HoldTimeTracker::set_class_budget_ns(uint32_t class_id, uint64_t budget_ns) {
+    if (class_id >= kMaxLockClasses) {
+        return;
+    }
+    uint64_t old = class_budget_ns_[class_id].exchange(budget_ns);
+    if (old == 0 && budget_ns > 0) {
+        class_budgets_set_.fetch_add(1);
+    } else if (old > 0 && budget_ns == 0) {
+        class_budgets_set_.fetch_sub(1);
+    }
+    update_enabled();
+}
+
+void HoldTimeTracker::forget_lock(uint64_t lock_addr) {
+    lock_classes_.erase(lock_addr);
+    if (lock_budgets_.erase(lock_addr)) {
+        update_enabled();
+    }
+}
+
+uint64_t HoldTimeTracker::budget_for(uint64_t lock_addr) const {
+    uint64_t budget = lock_budgets_.get(lock_addr);
+    if (budget > 0) {
+        return budget;
+    }
+    if (class_budgets_set_.load(std::memory_order_relaxed) > 0) {
+        uint64_t cls = lock_classes_.get(lock_addr);
+        if (cls > 0) {
+            budget = class_budget_ns_[cls - 1].load(std::memory_order_relaxed);
+            if (budget > 0) {
+                return budget;
+            }
+        }
+    }
+    return default_budget_ns_.load(std::memory_order_relaxed);
+}
+
+// ============================================
+// 热路径：解锁时比较持有时长
+// ============================================
+void HoldTimeTracker::on_release(uint64_t thread_id, const HeldLockInfo& info, uint64_t now_ns) {
+    if (info.acquired_ns == 0 || now_ns <= info.acquired_ns) {
+        return;
+    }
+    uint64_t budget = budget_for(info.lock_addr);
+    uint64_t hold = now_ns - info.acquired_ns;
+    if (budget == 0 || hold <= budget) {
+        return;
+    }
+
+    // 写入环形缓冲（覆盖最旧的记录）
+    uint64_t pos = ring_pos_.fetch_add(1, std::memory_order_relaxed);
+    RingEntry& e = ring_[pos & (kViolationRingSize - 1)];
+    e.seq.store(2 * pos + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    e.lock_addr.store(info.lock_addr, std::memory_order_relaxed);
+    e.thread_id.store(thread_id, std::memory_order_relaxed);
+    e.hold_ns.store(hold, std::memory_order_relaxed);
+    e.budget_ns.store(budget, std::memory_order_relaxed);
+    e.acquired_ns.store(info.acquired_ns, std::memory_order_relaxed);
+    e.site.store(info.site, std::memory_order_relaxed);
+    e.seq.store(2 * pos + 2, std::memory_order_release);
+}
+
+// ============================================
+// 检测线程：读取
+// ============================================
+std::vector<HoldViolation> HoldTimeTracker::recent_violations() const {
+    std::vector<HoldViolation> result;
+    uint64_t end = ring_pos_.load(std::memory_order_acquire);
+    uint64_t begin = end > kViolationRingSize ? end - kViolationRingSize : 0;
+    for (uint64_t i = begin; i < end; i++) {
+        const RingEntry& e = ring_[i & (kViolationRingSize - 1)];
+        uint64_t seq = e.seq.load(std::memory_order_acquire);
+        if (seq != 2 * i + 2) {
+            continue; // 正在写入或已被覆盖
+        }
+        HoldViolation v;
+        v.lock_addr = e.lock_addr.load(std::memory_order_relaxed);
+        v.thread_id = e.thread_id.load(std::memory_order_relaxed);
+        v.hold_ns = e.hold_ns.load(std::memory_order_relaxed);
+        v.budget_ns = e.budget_ns.load(std::memory_order_relaxed);
+        v.acquired_ns = e.acquired_ns.load(std::memory_order_relaxed);
+        v.site = e.site.load(std::memory_order_relaxed);
+        v.still_held = false;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (e.seq.load(std::memory_order_relaxed) == seq) {
+            result.push_back(v);
+        }
+    }
+    return result;
+}
+
+void HoldTimeTracker::scan_held(uint64_t now_ns, std::vector<HoldViolation>& out) const {
+    if (!enabled()) {
+        return;
+    }
+    std::vector<HeldLockInfo> held;
+    ThreadRegistry::instance().for_each([&](const ThreadSlot& slot) {
+        uint32_t life = slot.life_begin();
+        uint64_t tid = slot.tid.load(std::memory_order_relaxed);
+        slot.read_held(held);
+        if (!slot.life_unchanged(life)) {
+            return; // 槽位刚换了主人
+        }
+        for (size_t i = 0; i < held.size(); i++) {
+            const HeldLockInfo& info = held[i];
+            if (info.acquired_ns == 0 || now_ns <= info.acquired_ns) {
+                continue;
+            }
+            uint64_t budget = budget_for(info.lock_addr);
+            if (budget == 0 || now_ns - info.acquired_ns <= budget) {
+                continue;
+            }
+            HoldViolation v;
+            v.lock_addr = info.lock_addr;
+            v.thread_id = tid;
+            v.hold_ns = now_ns - info.acquired_ns;
+            v.budget_ns = budget;
+            v.acquired_ns = info.acquired_ns;
+            v.site = info.site;
+            v.still_held = true;
+            out.push_back(v);
+        }
+    });
+}
@@ -0,0 +1,267 @@
+#include "report_sink.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <chrono>
+
+// ============================================
+// FdSink / FileSink
+// ============================================
+FdSink::~FdSink() {
+    if (owns_fd_ && fd_ >= 0) {
+        close(fd_);
+    }
+}
+
+void FdSink::write_record(const char* data, size_t len) {
+    // 正常情况下一次 write(2) 写完；被信号打断或部分写时补写剩余部分
+    while (len > 0 && fd_ >= 0) {
+        ssize_t n = ::write(fd_, data, len);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return; // 管道关闭等错误：丢弃，不影响检测器
+        }
+        data += n;
+        len -= static_cast<size_t>(n);
+    }
+}
+
+void StdioSink::write_record(const char* data, size_t len) {
+    if (stream_) {
+        fwrite(data, 1, len, stream_);
+        fflush(stream_);
+    }
+}
+
+FileSink::FileSink(const std::string& path)
+    : FdSink(open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644), true) {}
+
+// ============================================
+// MemorySink
+// ============================================
+void MemorySink::write_record(const char* data, size_t len) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    buffer_.append(data, len);
+}
+
+std::string MemorySink::contents() const {
+    std::lock_guard<std::mutex> guard(mutex_);
+    return buffer_;
+}
+
+void MemorySink::clear() {
+    std::lock_guard<std::mutex> guard(mutex_);
+    buffer_.clear();
+}
+
+// ============================================
+// AsyncReporter
+// 队列算法：Dmitry Vyukov 的有界 MPMC 队列（这里只有一个消费者）。
+// 每个槽位的 sequence 表示它当前可被哪个位置的生产者/消费者使用。
+// ============================================
+AsyncReporter::AsyncReporter()
+    : enqueue_pos_(0),
+      dequeue_pos_(0),
+      dropped_(0),
+      submitted_(0),
+      written_(0),
+      sink_(new FdSink(STDOUT_FILENO)),
+      running_(true) {
+    for (size_t i = 0; i < kQueueSlots; i++) {
+        slots_[i].sequence.store(i, std::memory_order_relaxed);
+        slots_[i].len = 0;
+        slots_[i].more = false;
+    }
+    writer_thread_ = std::thread(&AsyncReporter::writer_loop, this);
+}
+
+AsyncReporter::~AsyncReporter() {
+    flush();
+    {
+        std::lock_guard<std::mutex> guard(mutex_wake_);
+        running_.store(false);
+    }
+    cv_wake_.notify_all();
+    if (writer_thread_.joinable()) {
+        writer_thread_.join();
+    }
+}
+
+void AsyncReporter::set_sink(const std::shared_ptr<ReportSink>& sink) {
+    flush();
+    std::lock_guard<std::mutex> guard(mutex_sink_);
+    sink_ = sink;
+}
+
+bool AsyncReporter::submit(const char* data, size_t len) {
+    if (len == 0) {
+        return true;
+    }
+    if (len > kRecordSize * kMaxRecordSlots) {
+        len = kRecordSize * kMaxRecordSlots;
+    }
+    size_t count = (len + kRecordSize - 1) / kRecordSize;
+
+    // 一次预留 count 个连续位置。写线程按顺序归还槽位，
+    // 所以最后一个槽位已归还时前面的也都已归还
+    size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+    for (;;) {
+        Slot* first = &slots_[pos & (kQueueSlots - 1)];
+        size_t seq = first->sequence.load(std::memory_order_acquire);
+        intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+        if (diff == 0) {
+            Slot* last = &slots_[(pos + count - 1) & (kQueueSlots - 1)];
+            size_t last_seq = last->sequence.load(std::memory_order_acquire);
+            if (last_seq != pos + count - 1) {
+                // 剩余空间放不下整条记录：丢弃而不是阻塞
+                dropped_.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            if (enqueue_pos_.compare_exchange_weak(pos, pos + count, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            // 队列已满：丢弃而不是阻塞
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        } else {
+            pos = enqueue_pos_.load(std::memory_order_relaxed);
+        }
+    }
+
+    submitted_.fetch_add(count, std::memory_order_relaxed);
+    for (size_t i = 0; i < count; i++) {
+        Slot* slot = &slots_[(pos + i) & (kQueueSlots - 1)];
+        size_t n = len < kRecordSize ? len : kRecordSize;
+        memcpy(slot->data, data, n);
+        slot->len = static_cast<uint32_t>(n);
+        slot->more = i + 1 < count;
+        slot->sequence.store(pos + i + 1, std::memory_order_release);
+        data += n;
+        len -= n;
+    }
+
+    // 不持锁通知：写线程带超时等待，偶尔丢失的唤醒最多延迟一个超时周期
+    cv_wake_.notify_one();
+    return true;
+}
+
+bool AsyncReporter::try_pop(Slot*& slot) {
+    slot = &slots_[dequeue_pos_ & (kQueueSlots - 1)];
+    size_t seq = slot->sequence.load(std::memory_order_acquire);
+    return seq == dequeue_pos_ + 1;
+}
+
+void AsyncReporter::flush() {
+    uint64_t target = submitted_.load(std::memory_order_acquire);
+    std::unique_lock<std::mutex> lk(mutex_wake_);
+    while (written_.load(std::memory_order_acquire) < target && running_.load()) {
+        cv_wake_.notify_one();
+        cv_drained_.wait_for(lk, std::chrono::milliseconds(10));
+    }
+}
+
+void AsyncReporter::writer_loop() {
+    for (;;) {
+        Slot* slot = nullptr;
+        if (try_pop(slot)) {
+            if (slot->more || !pending_.empty()) {
+                pending_.append(slot->data, slot->len);
+            }
+            if (!slot->more) {
+                // 单槽位记录直接写出；多槽位记录拼接完整后一次写出
+                std::lock_guard<std::mutex> guard(mutex_sink_);
+                if (sink_) {
+                    if (pending_.empty()) {
+                        sink_->write_record(slot->data, slot->len);
+                    } else {
+                        sink_->write_record(pending_.data(), pending_.size());
+                    }
+                }
+                pending_.clear();
+            }
+            // 归还槽位给下一圈的生产者
+            slot->sequence.store(dequeue_pos_ + kQueueSlots, std::memory_order_release);
+            dequeue_pos_++;
+            written_.fetch_add(1, std::memory_order_release);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lk(mutex_wake_);
+        cv_drained_.notify_all();
+        if (!running_.load()) {
+            break;
+        }
+        cv_wake_.wait_for(lk, std::chrono::milliseconds(50));
+    }
+}
+
+// ============================================
+// ReportWriter
+// ============================================
+ReportWriter& ReportWriter::write(const char* data, size_t len) {
+    while (len > 0) {
+        size_t room = sizeof(buffer_) - len_;
+        if (room == 0) {
+            overflow_.append(buffer_, len_); // 超出一个槽位：转存，提交时整条提交
+            len_ = 0;
+            room = sizeof(buffer_);
+        }
+        size_t n = len < room ? len : room;
+        memcpy(buffer_ + len_, data, n);
+        len_ += n;
+        data += n;
+        len -= n;
+    }
+    return *this;
+}
+
+ReportWriter& ReportWriter::operator<<(const char* s) {
+    return s ? write(s, strlen(s)) : write("(null)", 6);
+}
+
+ReportWriter& ReportWriter::write_signed(long long v) {
+    if (hex_) {
+        return write_unsigned(static_cast<unsigned long long>(v));
+    }
+    char tmp[32];
+    int n = snprintf(tmp, sizeof(tmp), "%lld", v);
+    return write(tmp, static_cast<size_t>(n));
+}
+
+ReportWriter& ReportWriter::write_unsigned(unsigned long long v) {
+    char tmp[32];
+    int n = snprintf(tmp, sizeof(tmp), hex_ ? "%llx" : "%llu", v);
+    return write(tmp, static_cast<size_t>(n));
+}
+
+ReportWriter& ReportWriter::operator<<(double v) {
+    char tmp[64];
+    int n = snprintf(tmp, sizeof(tmp), "%g", v);
+    return write(tmp, static_cast<size_t>(n));
+}
+
+ReportWriter& ReportWriter::operator<<(std::ios_base& (*manip)(std::ios_base&)) {
+    if (manip == static_cast<std::ios_base& (*)(std::ios_base&)>(std::hex)) {
+        hex_ = true;
+    } else if (manip == static_cast<std::ios_base& (*)(std::ios_base&)>(std::dec)) {
+        hex_ = false;
+    }
+    return *this;
+}
+
+void ReportWriter::commit() {
+    if (!overflow_.empty()) {
+        overflow_.append(buffer_, len_);
+        AsyncReporter::instance().submit(overflow_.data(), overflow_.size());
+        overflow_.clear();
+        len_ = 0;
+    } else if (len_ > 0) {
+        AsyncReporter::instance().submit(buffer_, len_);
+        len_ = 0;
+    }
+}
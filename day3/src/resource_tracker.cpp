@@ -0,0 +1,201 @@
+#include "resource_tracker.h"
+#include <stdio.h>
+#include <vector>
+
+// ============================================
+// 计数资源
+// ============================================
+void ResourceTracker::define(uint64_t resource, uint32_t units, const char* name) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    Resource& res = resources_[resource];
+    res.name = name;
+    res.counted = true;
+    res.declared = true;
+    res.free_units = units;
+    res.holders.clear();
+}
+
+void ResourceTracker::define_semaphore(uint64_t resource, uint32_t units) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    Resource& res = resources_[resource];
+    res.name = nullptr;
+    res.counted = true;
+    res.declared = false;
+    res.free_units = units;
+    res.holders.clear();
+}
+
+void ResourceTracker::remove(uint64_t resource) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    resources_.erase(resource);
+}
+
+void ResourceTracker::acquire_begin(uint64_t thread_id, uint64_t resource, uint32_t units, const char* site) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    resources_[resource];   // 未登记的资源（例如 sem_open 打开的信号量）按不可判定处理
+    ResourceWait& wait = waits_[thread_id];
+    wait.resource = resource;
+    wait.units = units;
+    wait.site = site;
+}
+
+void ResourceTracker::acquire_end(uint64_t thread_id, uint64_t resource, uint32_t units, bool acquired) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    waits_.erase(thread_id);
+    if (!acquired) {
+        return;
+    }
+    Resource& res = resources_[resource];
+    res.free_units = res.free_units > units ? res.free_units - units : 0;
+    if (res.counted) {
+        res.holders[thread_id] += units;
+    }
+}
+
+void ResourceTracker::release(uint64_t thread_id, uint64_t resource, uint32_t units) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    Resource& res = resources_[resource];
+    res.free_units += units;
+    auto holder = res.holders.find(thread_id);
+    if (holder == res.holders.end() || holder->second < units) {
+        // 非持有者补充单位：单位可能来自任何线程，不再跟踪持有关系
+        res.counted = false;
+        res.holders.clear();
+        return;
+    }
+    holder->second -= units;
+    if (holder->second == 0) {
+        res.holders.erase(holder);
+    }
+}
+
+// ============================================
+// 屏障
+// ============================================
+void ResourceTracker::barrier_init(uint64_t barrier, uint32_t count) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    Barrier& b = barriers_[barrier];
+    b.count = count;
+    b.participants.clear();
+    b.waiting.clear();
+}
+
+void ResourceTracker::barrier_destroy(uint64_t barrier) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    barriers_.erase(barrier);
+}
+
+void ResourceTracker::barrier_wait_begin(uint64_t thread_id, uint64_t barrier) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    Barrier& b = barriers_[barrier];
+    b.participants.insert(thread_id);
+    b.waiting.insert(thread_id);
+    barrier_waits_[thread_id] = barrier;
+}
+
+void ResourceTracker::barrier_wait_end(uint64_t thread_id, uint64_t barrier) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    auto b = barriers_.find(barrier);
+    if (b != barriers_.end()) {
+        b->second.waiting.erase(thread_id);
+    }
+    barrier_waits_.erase(thread_id);
+}
+
+// ============================================
+// 线程退出
+// ============================================
+void ResourceTracker::forget_thread(uint64_t thread_id) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    waits_.erase(thread_id);
+    barrier_waits_.erase(thread_id);
+    for (auto& pair : resources_) {
+        pair.second.holders.erase(thread_id);
+    }
+    for (auto& pair : barriers_) {
+        pair.second.participants.erase(thread_id);
+        pair.second.waiting.erase(thread_id);
+    }
+}
+
+// ============================================
+// 检测线程
+// ============================================
+void ResourceTracker::add_to_graph(DirectedGraph& graph) const {
+    std::lock_guard<std::mutex> guard(mutex_);
+
+    // 计数资源：资源顶点、分配边、请求边
+    std::map<uint64_t, std::vector<const std::pair<const uint64_t, ResourceWait>*> > by_resource;
+    for (const auto& pair : waits_) {
+        by_resource[pair.second.resource].push_back(&pair);
+    }
+    for (const auto& group : by_resource) {
+        auto res = resources_.find(group.first);
+        if (res == resources_.end() || !res->second.counted || res->second.holders.empty()) {
+            continue; // 不可判定
+        }
+        const Resource& r = res->second;
+        std::vector<const std::pair<const uint64_t, ResourceWait>*> requests;
+        for (size_t i = 0; i < group.second.size(); i++) {
+            uint64_t waiter = group.second[i]->first;
+            // 未声明的信号量：只有自己持有单位的等待者随时可能被别的线程 post 唤醒
+            bool others_hold = r.holders.size() > 1 ||
+                               (r.holders.size() == 1 && r.holders.begin()->first != waiter);
+            if (r.declared || others_hold) {
+                requests.push_back(group.second[i]);
+            }
+        }
+        if (requests.empty()) {
+            continue;
+        }
+        graph.add_resource(group.first, r.free_units);
+        for (const auto& holder : r.holders) {
+            graph.add_allocation(group.first, holder.first, holder.second);
+        }
+        for (size_t i = 0; i < requests.size(); i++) {
+            graph.add_request(requests[i]->first, group.first, requests[i]->second.units);
+        }
+    }
+
+    // 屏障：学到的参与者恰好是屏障人数时，等待者等待每一个尚未到达的参与者
+    for (const auto& pair : barrier_waits_) {
+        auto b = barriers_.find(pair.second);
+        if (b == barriers_.end() || b->second.count == 0 ||
+            b->second.participants.size() != b->second.count) {
+            continue;
+        }
+        for (uint64_t participant : b->second.participants) {
+            if (!b->second.waiting.count(participant)) {
+                graph.add_edge(pair.first, participant);
+            }
+        }
+    }
+}
+
+bool ResourceTracker::describe_wait(uint64_t thread_id, std::string& out) const {
+    char buf[192];
+    std::lock_guard<std::mutex> guard(mutex_);
+    auto wait = waits_.find(thread_id);
+    if (wait != waits_.end()) {
+        auto res = resources_.find(wait->second.resource);
+        const char* name = res != resources_.end() && res->second.name ? res->second.name : "semaphore";
+        size_t holders = res != resources_.end() ? res->second.holders.size() : 0;
+        uint32_t free_units = res != resources_.end() ? res->second.free_units : 0;
+        snprintf(buf, sizeof(buf), "is waiting for %u unit(s) of %s 0x%llx at %s (%u free, held by %zu thread(s))",
+                 wait->second.units, name, static_cast<unsigned long long>(wait->second.resource),
+                 wait->second.site ? wait->second.site : "?", free_units, holders);
+        out = buf;
+        return true;
+    }
+    auto barrier = barrier_waits_.find(thread_id);
+    if (barrier != barrier_waits_.end()) {
+        auto b = barriers_.find(barrier->second);
+        size_t arrived = b != barriers_.end() ? b->second.waiting.size() : 0;
+        uint32_t count = b != barriers_.end() ? b->second.count : 0;
+        snprintf(buf, sizeof(buf), "is waiting at barrier 0x%llx (%zu of %u arrived)",
+                 static_cast<unsigned long long>(barrier->second), arrived, count);
+        out = buf;
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,54 @@
+#include "self_profile.h"
+#include <algorithm>
+#include <vector>
+
+void SelfProfileWindow::add(const PassProfile& pass) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    ring_[count_ % kWindow] = pass;
+    count_++;
+}
+
+SelfProfileSummary SelfProfileWindow::summary() const {
+    SelfProfileSummary result;
+    std::vector<PassProfile> passes;
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        size_t n = count_ < kWindow ? static_cast<size_t>(count_) : kWindow;
+        passes.assign(ring_, ring_ + n);
+    }
+    result.passes = passes.size();
+
+    std::vector<uint64_t> values(passes.size());
+    for (size_t m = 0; m < PASS_METRIC_COUNT; m++) {
+        MetricSummary& s = result.metrics[m];
+        s.p50 = s.p99 = s.max = 0;
+        if (passes.empty()) {
+            continue;
+        }
+        for (size_t i = 0; i < passes.size(); i++) {
+            values[i] = passes[i].values[m];
+        }
+        std::sort(values.begin(), values.end());
+        size_t n = values.size();
+        s.p50 = values[(n - 1) * 50 / 100];
+        s.p99 = values[(n - 1) * 99 / 100];
+        s.max = values[n - 1];
+    }
+    return result;
+}
+
+const char* SelfProfileWindow::metric_name(PassMetric metric) {
+    switch (metric) {
+        case PASS_TOTAL_NS:        return "total_ns";
+        case PASS_SNAPSHOT_NS:     return "snapshot_ns";
+        case PASS_BUILD_NS:        return "build_ns";
+        case PASS_CYCLE_NS:        return "cycle_ns";
+        case PASS_HOLD_OWNERS_NS:  return "hold_lock_owners_ns";
+        case PASS_HOLD_WAITING_NS: return "hold_thread_waiting_ns";
+        case PASS_HOLD_STACKS_NS:  return "hold_thread_stacks_ns";
+        case PASS_VERTICES:        return "vertices";
+        case PASS_EDGES:           return "edges";
+        case PASS_BYTES_COPIED:    return "bytes_copied";
+        default:                   return "unknown";
+    }
+}
@@ -0,0 +1,253 @@
+#include "stats_segment.h"
+#include <algorithm>
+#include <ctime>
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+std::string default_stats_segment_name(uint32_t pid) {
+    char name[64];
+    snprintf(name, sizeof(name), "/deadlock_detector.%u", pid);
+    return name;
+}
+
+static void store_wait(SegWait& dst, const LiveWait& src) {
+    dst.thread_id.store(src.thread_id, std::memory_order_relaxed);
+    dst.lock_addr.store(src.lock_addr, std::memory_order_relaxed);
+    dst.owner_thread.store(src.owner_thread, std::memory_order_relaxed);
+    dst.waited_ns.store(src.waited_ns, std::memory_order_relaxed);
+}
+
+static LiveWait load_wait(const SegWait& src) {
+    LiveWait w;
+    w.thread_id = src.thread_id.load(std::memory_order_relaxed);
+    w.lock_addr = src.lock_addr.load(std::memory_order_relaxed);
+    w.owner_thread = src.owner_thread.load(std::memory_order_relaxed);
+    w.waited_ns = src.waited_ns.load(std::memory_order_relaxed);
+    return w;
+}
+
+// ============================================
+// 写者
+// ============================================
+bool StatsPublisher::open(const std::string& name) {
+    close();
+
+    int fd = shm_open(name.c_str(), O_CREAT | O_RDWR | O_TRUNC, 0640);
+    if (fd < 0) {
+        return false;
+    }
+    if (ftruncate(fd, sizeof(StatsSegment)) != 0) {
+        ::close(fd);
+        shm_unlink(name.c_str());
+        return false;
+    }
+    void* addr = mmap(nullptr, sizeof(StatsSegment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd); // 映射建立后不再需要描述符
+    if (addr == MAP_FAILED) {
+        shm_unlink(name.c_str());
+        return false;
+    }
+
+    // ftruncate 出来的页全为 0，只需填写头部；magic 最后发布
+    segment_ = static_cast<StatsSegment*>(addr);
+    segment_->version = kStatsSegmentVersion;
+    segment_->segment_size = sizeof(StatsSegment);
+    segment_->pid = static_cast<uint32_t>(getpid());
+    segment_->created_wall_s = static_cast<uint64_t>(std::time(nullptr));
+    segment_->magic.store(kStatsSegmentMagic, std::memory_order_release);
+    name_ = name;
+    return true;
+}
+
+void StatsPublisher::close() {
+    if (!segment_) {
+        return;
+    }
+    munmap(segment_, sizeof(StatsSegment));
+    shm_unlink(name_.c_str());
+    segment_ = nullptr;
+    name_.clear();
+}
+
+void StatsPublisher::write_begin() {
+    segment_->seq.store(segment_->seq.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+}
+
+void StatsPublisher::write_end() {
+    segment_->seq.store(segment_->seq.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+void StatsPublisher::publish(const uint64_t counters[SEG_COUNTER_COUNT],
+                             const std::vector<LiveWait>& waits, uint64_t edge_total) {
+    if (!segment_) {
+        return;
+    }
+
+    // 先在段外选出最久的等待，缩短写者处于奇数 seq 的时间
+    std::vector<const LiveWait*> oldest;
+    oldest.reserve(waits.size());
+    for (size_t i = 0; i < waits.size(); i++) {
+        oldest.push_back(&waits[i]);
+    }
+    size_t oldest_n = std::min(oldest.size(), kSegOldestWaits);
+    std::partial_sort(oldest.begin(), oldest.begin() + oldest_n, oldest.end(),
+                      [](const LiveWait* a, const LiveWait* b) { return a->waited_ns > b->waited_ns; });
+
+    write_begin();
+    segment_->publish_count.store(segment_->publish_count.load(std::memory_order_relaxed) + 1,
+                                  std::memory_order_relaxed);
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    segment_->publish_wall_s.store(static_cast<uint64_t>(now.tv_sec), std::memory_order_relaxed);
+    segment_->publish_wall_ns.store(static_cast<uint64_t>(now.tv_sec) * 1000000000ull + now.tv_nsec,
+                                    std::memory_order_relaxed);
+    for (size_t c = 0; c < SEG_COUNTER_COUNT; c++) {
+        segment_->counters[c].store(counters[c], std::memory_order_relaxed);
+    }
+
+    size_t edges = 0;
+    for (size_t i = 0; i < waits.size() && edges < kSegEdges; i++) {
+        if (waits[i].owner_thread != 0) {
+            store_wait(segment_->edges[edges++], waits[i]);
+        }
+    }
+    segment_->edge_total.store(edge_total, std::memory_order_relaxed);
+    segment_->edge_count.store(edges, std::memory_order_relaxed);
+
+    for (size_t i = 0; i < oldest_n; i++) {
+        store_wait(segment_->oldest[i], *oldest[i]);
+    }
+    segment_->oldest_count.store(oldest_n, std::memory_order_relaxed);
+    write_end();
+}
+
+void StatsPublisher::add_detection(const std::vector<uint64_t>& threads) {
+    if (!segment_) {
+        return;
+    }
+    write_begin();
+    uint64_t total = segment_->detection_total.load(std::memory_order_relaxed);
+    SegDetection& d = segment_->detections[total % kSegDetections];
+    d.wall_time_s.store(static_cast<uint64_t>(std::time(nullptr)), std::memory_order_relaxed);
+    d.thread_count.store(threads.size(), std::memory_order_relaxed);
+    for (size_t i = 0; i < kSegCycleThreads; i++) {
+        d.threads[i].store(i < threads.size() ? threads[i] : 0, std::memory_order_relaxed);
+    }
+    segment_->detection_total.store(total + 1, std::memory_order_relaxed);
+    write_end();
+}
+
+// ============================================
+// 读者
+// ============================================
+bool StatsSegmentReader::open(const std::string& name) {
+    close();
+
+    int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0) {
+        error_ = std::string("shm_open ") + name + ": " + strerror(errno);
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(StatsSegment)) {
+        ::close(fd);
+        error_ = name + ": segment too small (incompatible version?)";
+        return false;
+    }
+    void* addr = mmap(nullptr, sizeof(StatsSegment), PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (addr == MAP_FAILED) {
+        error_ = std::string("mmap ") + name + ": " + strerror(errno);
+        return false;
+    }
+
+    const StatsSegment* segment = static_cast<const StatsSegment*>(addr);
+    if (segment->magic.load(std::memory_order_acquire) != kStatsSegmentMagic) {
+        error_ = name + ": not a deadlock detector stats segment (or not initialized yet)";
+    } else if (segment->version != kStatsSegmentVersion || segment->segment_size != sizeof(StatsSegment)) {
+        error_ = name + ": unsupported segment version";
+    } else {
+        segment_ = segment;
+        error_.clear();
+        return true;
+    }
+    munmap(addr, sizeof(StatsSegment));
+    return false;
+}
+
+void StatsSegmentReader::close() {
+    if (segment_) {
+        munmap(const_cast<StatsSegment*>(segment_), sizeof(StatsSegment));
+        segment_ = nullptr;
+    }
+}
+
+bool StatsSegmentReader::owner_alive() const {
+    return segment_ && (kill(static_cast<pid_t>(segment_->pid), 0) == 0 || errno == EPERM);
+}
+
+bool StatsSegmentReader::read(StatsSnapshot& out, int max_attempts) const {
+    if (!segment_) {
+        return false;
+    }
+    const StatsSegment& s = *segment_;
+    out.pid = s.pid;
+    out.created_wall_s = s.created_wall_s;
+
+    for (int attempt = 0; attempt < max_attempts; attempt++) {
+        uint64_t begin = s.seq.load(std::memory_order_acquire);
+        if (begin & 1) {
+            sched_yield(); // 写者正在写
+            continue;
+        }
+
+        out.publish_count = s.publish_count.load(std::memory_order_relaxed);
+        out.publish_wall_s = s.publish_wall_s.load(std::memory_order_relaxed);
+        out.publish_wall_ns = s.publish_wall_ns.load(std::memory_order_relaxed);
+        for (size_t c = 0; c < SEG_COUNTER_COUNT; c++) {
+            out.counters[c] = s.counters[c].load(std::memory_order_relaxed);
+        }
+
+        out.edge_total = s.edge_total.load(std::memory_order_relaxed);
+        size_t edges = std::min<size_t>(s.edge_count.load(std::memory_order_relaxed), kSegEdges);
+        out.edges.clear();
+        for (size_t i = 0; i < edges; i++) {
+            out.edges.push_back(load_wait(s.edges[i]));
+        }
+
+        size_t oldest = std::min<size_t>(s.oldest_count.load(std::memory_order_relaxed), kSegOldestWaits);
+        out.oldest.clear();
+        for (size_t i = 0; i < oldest; i++) {
+            out.oldest.push_back(load_wait(s.oldest[i]));
+        }
+
+        out.detection_total = s.detection_total.load(std::memory_order_relaxed);
+        size_t detections = std::min<uint64_t>(out.detection_total, kSegDetections);
+        out.detections.clear();
+        for (size_t i = 0; i < detections; i++) {
+            const SegDetection& d = s.detections[(out.detection_total - 1 - i) % kSegDetections];
+            LiveDetection ld;
+            ld.wall_time_s = d.wall_time_s.load(std::memory_order_relaxed);
+            ld.thread_count = d.thread_count.load(std::memory_order_relaxed);
+            size_t n = std::min<uint64_t>(ld.thread_count, kSegCycleThreads);
+            for (size_t t = 0; t < n; t++) {
+                ld.threads.push_back(d.threads[t].load(std::memory_order_relaxed));
+            }
+            out.detections.push_back(ld);
+        }
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (s.seq.load(std::memory_order_relaxed) == begin) {
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,213 @@
+#include "thread_registry.h"
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// ============================================
+// ThreadSlot：持有锁栈
+// 持有锁基本按栈的顺序释放，所以从栈顶开始查找
+// ============================================
+void ThreadSlot::push_held(uint64_t lock_addr, uint64_t acquired_ns, const char* site) {
+    uint32_t n = held_count_.load(std::memory_order_relaxed);
+    if (n >= kMaxHeldLocks) {
+        return; // 嵌套过深：不跟踪，释放时 pop_held 会找不到并返回 false
+    }
+    write_begin();
+    held_[n].lock_addr.store(lock_addr, std::memory_order_relaxed);
+    held_[n].acquired_ns.store(acquired_ns, std::memory_order_relaxed);
+    held_[n].site.store(site, std::memory_order_relaxed);
+    held_count_.store(n + 1, std::memory_order_relaxed);
+    write_end();
+}
+
+bool ThreadSlot::pop_held(uint64_t lock_addr, HeldLockInfo& info) {
+    uint32_t n = held_count_.load(std::memory_order_relaxed);
+    for (uint32_t i = n; i-- > 0;) {
+        if (held_[i].lock_addr.load(std::memory_order_relaxed) != lock_addr) {
+            continue;
+        }
+        info.lock_addr = lock_addr;
+        info.acquired_ns = held_[i].acquired_ns.load(std::memory_order_relaxed);
+        info.site = held_[i].site.load(std::memory_order_relaxed);
+
+        // 非栈顶释放时，后面的元素整体前移，保持获取顺序
+        write_begin();
+        for (uint32_t j = i + 1; j < n; j++) {
+            held_[j - 1].lock_addr.store(held_[j].lock_addr.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            held_[j - 1].acquired_ns.store(held_[j].acquired_ns.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            held_[j - 1].site.store(held_[j].site.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        }
+        held_count_.store(n - 1, std::memory_order_relaxed);
+        write_end();
+        return true;
+    }
+    return false;
+}
+
+bool ThreadSlot::holds(uint64_t lock_addr) const {
+    uint32_t n = held_count_.load(std::memory_order_relaxed);
+    for (uint32_t i = 0; i < n; i++) {
+        if (held_[i].lock_addr.load(std::memory_order_relaxed) == lock_addr) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadSlot::clear_held() {
+    write_begin();
+    held_count_.store(0, std::memory_order_relaxed);
+    write_end();
+    for (size_t i = 0; i < kMaxHeldSpins; i++) {
+        spin_held_[i].store(0, std::memory_order_release);
+    }
+    wait_begin_ns = 0;
+}
+
+void ThreadSlot::read_held(std::vector<HeldLockInfo>& out) const {
+    for (;;) {
+        out.clear();
+        uint32_t seq = held_seq_.load(std::memory_order_acquire);
+        if (seq & 1) {
+            continue; // 所属线程正在修改
+        }
+        uint32_t n = held_count_.load(std::memory_order_relaxed);
+        for (uint32_t i = 0; i < n && i < kMaxHeldLocks; i++) {
+            HeldLockInfo info;
+            info.lock_addr = held_[i].lock_addr.load(std::memory_order_relaxed);
+            info.acquired_ns = held_[i].acquired_ns.load(std::memory_order_relaxed);
+            info.site = held_[i].site.load(std::memory_order_relaxed);
+            out.push_back(info);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (held_seq_.load(std::memory_order_relaxed) == seq) {
+            return;
+        }
+    }
+}
+
+// ============================================
+// ThreadRegistry
+// ============================================
+ThreadRegistry::ThreadRegistry() : high_water_(0), exit_hook_(nullptr) {
+    for (size_t i = 0; i < kMaxThreadSlots; i++) {
+        slots_[i].store(nullptr, std::memory_order_relaxed);
+        storage_[i] = nullptr;
+    }
+    exit_key_valid_ = pthread_key_create(&exit_key_, &ThreadRegistry::on_thread_exit) == 0;
+}
+
+ThreadSlot* ThreadRegistry::register_current() {
+    ThreadSlot* slot;
+    {
+        std::lock_guard<std::mutex> guard(mutex_register_);
+        uint32_t ordinal;
+        if (!free_ordinals_.empty()) {
+            ordinal = free_ordinals_.back();
+            free_ordinals_.pop_back();
+        } else {
+            ordinal = high_water_.load(std::memory_order_relaxed);
+            if (ordinal >= kMaxThreadSlots) {
+                return nullptr;
+            }
+        }
+
+        if (!storage_[ordinal]) {
+            storage_[ordinal] = new ThreadSlot();
+        }
+        slot = storage_[ordinal];
+        slot->ordinal = ordinal;
+        slot->life_start(static_cast<uint64_t>(syscall(SYS_gettid)), pthread_self());
+
+        slots_[ordinal].store(slot, std::memory_order_release);
+        if (ordinal >= high_water_.load(std::memory_order_relaxed)) {
+            high_water_.store(ordinal + 1, std::memory_order_release);
+        }
+    }
+    if (exit_key_valid_) {
+        pthread_setspecific(exit_key_, slot);
+    }
+    return slot;
+}
+
+// 线程退出时在该线程上运行（pthread 线程私有数据析构函数）
+void ThreadRegistry::on_thread_exit(void* slot) {
+    instance().unregister(static_cast<ThreadSlot*>(slot));
+}
+
+void ThreadRegistry::unregister(ThreadSlot* slot) {
+    ExitHook hook = exit_hook_.load();
+    if (hook) {
+        hook(*slot);
+    }
+    slot->clear_held();
+    cached_slot() = nullptr;   // 之后的析构函数再经过钩子时重新注册
+
+    std::lock_guard<std::mutex> guard(mutex_register_);
+    slots_[slot->ordinal].store(nullptr, std::memory_order_release);
+    slot->life_end();
+    free_ordinals_.push_back(slot->ordinal);
+}
+
+uint64_t ThreadRegistry::find_tid_by_handle(pthread_t handle) const {
+    uint64_t found = 0;
+    for_each([&](ThreadSlot& slot) {
+        uint32_t life = slot.life_begin();
+        uint64_t tid = slot.tid.load(std::memory_order_relaxed);
+        bool match = pthread_equal(slot.handle.load(std::memory_order_relaxed), handle);
+        if (match && slot.life_unchanged(life)) {
+            found = tid;
+        }
+    });
+    return found;
+}
+
+uint64_t ThreadRegistry::find_spin_holder(uint64_t lock_addr) const {
+    uint64_t found = 0;
+    for_each([&](ThreadSlot& slot) {
+        uint32_t life = slot.life_begin();
+        uint64_t tid = slot.tid.load(std::memory_order_relaxed);
+        bool match = slot.holds_spin(lock_addr);
+        if (match && slot.life_unchanged(life)) {
+            found = tid;
+        }
+    });
+    return found;
+}
+
+bool ThreadRegistry::read_held_of(uint64_t tid, std::vector<HeldLockInfo>& out) const {
+    bool found = false;
+    for_each([&](ThreadSlot& slot) {
+        if (found) {
+            return;
+        }
+        uint32_t life = slot.life_begin();
+        if (slot.tid.load(std::memory_order_relaxed) != tid) {
+            return;
+        }
+        slot.read_held(out);
+        found = slot.life_unchanged(life);
+    });
+    if (!found) {
+        out.clear();
+    }
+    return found;
+}
+
+bool ThreadRegistry::cpu_clock_of(uint64_t tid, clockid_t& clock) {
+    // 注销在退出线程上、持有该锁时进行，线程结束（pthread_t 失效）一定在那之后
+    std::lock_guard<std::mutex> guard(mutex_register_);
+    uint32_t limit = high_water_.load(std::memory_order_relaxed);
+    for (uint32_t i = 0; i < limit; i++) {
+        ThreadSlot* slot = slots_[i].load(std::memory_order_relaxed);
+        if (slot && slot->tid.load(std::memory_order_relaxed) == tid) {
+            return pthread_getcpuclockid(slot->handle.load(std::memory_order_relaxed), &clock) == 0;
+        }
+    }
+    return false;
+}
+
+size_t ThreadRegistry::size() const {
+    size_t count = 0;
+    for_each([&](ThreadSlot&) { count++; });
+    return count;
+}
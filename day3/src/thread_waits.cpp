@@ -0,0 +1,205 @@
+#include "thread_waits.h"
+#include "thread_registry.h"
+#include <stdio.h>
+
+// 当前线程的内核线程 ID（槽位中已缓存，无需系统调用）
+static uint64_t current_tid() {
+    ThreadSlot* slot = ThreadRegistry::current();
+    return slot ? slot->tid.load(std::memory_order_relaxed) : 0;
+}
+
+// ============================================
+// pthread_join
+// ============================================
+void ThreadWaitTracker::join_begin(uint64_t thread_id, pthread_t target, const char* site) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    JoinWait& wait = joins_[thread_id];
+    wait.target = target;
+    wait.site = site;
+}
+
+void ThreadWaitTracker::join_end(uint64_t thread_id) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    joins_.erase(thread_id);
+}
+
+// ============================================
+// 线程池任务依赖
+// ============================================
+void ThreadWaitTracker::worker_begin(uint64_t pool_id) {
+    uint64_t tid = current_tid();
+    std::lock_guard<std::mutex> guard(mutex_);
+    pools_[pool_id].insert(tid);
+    worker_task_[tid] = 0;
+}
+
+void ThreadWaitTracker::worker_end(uint64_t pool_id) {
+    uint64_t tid = current_tid();
+    std::lock_guard<std::mutex> guard(mutex_);
+    auto pool = pools_.find(pool_id);
+    if (pool != pools_.end()) {
+        pool->second.erase(tid);
+        if (pool->second.empty()) {
+            pools_.erase(pool);
+        }
+    }
+    worker_task_.erase(tid);
+}
+
+void ThreadWaitTracker::task_submit(uint64_t pool_id, uint64_t task_id) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    TaskState& task = tasks_[task_id];
+    task.pool_id = pool_id;
+    task.runner = 0;
+}
+
+void ThreadWaitTracker::task_begin(uint64_t task_id) {
+    uint64_t tid = current_tid();
+    std::lock_guard<std::mutex> guard(mutex_);
+    auto task = tasks_.find(task_id);
+    if (task != tasks_.end()) {
+        task->second.runner = tid;
+    }
+    auto worker = worker_task_.find(tid);
+    if (worker != worker_task_.end()) {
+        worker->second = task_id;
+    }
+}
+
+void ThreadWaitTracker::task_end(uint64_t task_id) {
+    uint64_t tid = current_tid();
+    std::lock_guard<std::mutex> guard(mutex_);
+    tasks_.erase(task_id);
+    auto worker = worker_task_.find(tid);
+    if (worker != worker_task_.end() && worker->second == task_id) {
+        worker->second = 0;
+    }
+}
+
+void ThreadWaitTracker::task_wait_begin(uint64_t task_id) {
+    uint64_t tid = current_tid();
+    std::lock_guard<std::mutex> guard(mutex_);
+    task_waits_[tid] = task_id;
+}
+
+void ThreadWaitTracker::task_wait_end(uint64_t task_id) {
+    uint64_t tid = current_tid();
+    std::lock_guard<std::mutex> guard(mutex_);
+    auto it = task_waits_.find(tid);
+    if (it != task_waits_.end() && it->second == task_id) {
+        task_waits_.erase(it);
+    }
+}
+
+void ThreadWaitTracker::forget_thread(uint64_t thread_id) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    joins_.erase(thread_id);
+    task_waits_.erase(thread_id);
+    if (worker_task_.erase(thread_id) == 0) {
+        return; // 不是工作线程
+    }
+    for (auto pool = pools_.begin(); pool != pools_.end();) {
+        pool->second.erase(thread_id);
+        if (pool->second.empty()) {
+            pool = pools_.erase(pool);
+        } else {
+            ++pool;
+        }
+    }
+    for (auto task = tasks_.begin(); task != tasks_.end();) {
+        if (task->second.runner == thread_id) {
+            task = tasks_.erase(task);
+        } else {
+            ++task;
+        }
+    }
+}
+
+// ============================================
+// 检测线程
+// ============================================
+void ThreadWaitTracker::collect_edges(std::vector<Edge>& edges, std::vector<uint64_t>& wait_any) const {
+    std::vector<std::pair<uint64_t, pthread_t> > joins;
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        for (const auto& pair : joins_) {
+            joins.push_back(std::make_pair(pair.first, pair.second.target));
+        }
+
+        for (const auto& pair : task_waits_) {
+            uint64_t waiter = pair.first;
+            auto task = tasks_.find(pair.second);
+            if (task == tasks_.end()) {
+                continue; // 已完成（或未登记）的任务
+            }
+            if (task->second.runner != 0) {
+                if (task->second.runner != waiter) {
+                    edges.push_back(Edge(waiter, task->second.runner));
+                }
+                continue;
+            }
+            // 仍在队列中：要等某个工作线程空出来
+            auto pool = pools_.find(task->second.pool_id);
+            if (pool == pools_.end()) {
+                continue;
+            }
+            bool has_idle = false;
+            for (uint64_t worker : pool->second) {
+                auto running = worker_task_.find(worker);
+                if (running == worker_task_.end() || running->second == 0) {
+                    has_idle = true;
+                    break;
+                }
+            }
+            if (has_idle) {
+                continue;
+            }
+            // 等待者自己也是工作线程时保留自环：只有一个工作线程时它在等自己
+            wait_any.push_back(waiter);
+            for (uint64_t worker : pool->second) {
+                edges.push_back(Edge(waiter, worker));
+            }
+        }
+    }
+
+    // pthread_t → 内核线程 ID（线性扫描注册表，放在锁外）
+    const ThreadRegistry& registry = ThreadRegistry::instance();
+    for (size_t i = 0; i < joins.size(); i++) {
+        uint64_t target = registry.find_tid_by_handle(joins[i].second);
+        if (target != 0 && target != joins[i].first) {
+            edges.push_back(Edge(joins[i].first, target));
+        }
+    }
+}
+
+bool ThreadWaitTracker::describe_wait(uint64_t thread_id, std::string& out) const {
+    char buf[160];
+    std::lock_guard<std::mutex> guard(mutex_);
+    auto join = joins_.find(thread_id);
+    if (join != joins_.end()) {
+        uint64_t target = ThreadRegistry::instance().find_tid_by_handle(join->second.target);
+        snprintf(buf, sizeof(buf), "is joining Thread %llu at %s",
+                 static_cast<unsigned long long>(target),
+                 join->second.site ? join->second.site : "?");
+        out = buf;
+        return true;
+    }
+    auto wait = task_waits_.find(thread_id);
+    if (wait != task_waits_.end()) {
+        auto task = tasks_.find(wait->second);
+        if (task != tasks_.end() && task->second.runner != 0) {
+            snprintf(buf, sizeof(buf), "is waiting for task 0x%llx (running on Thread %llu)",
+                     static_cast<unsigned long long>(wait->second),
+                     static_cast<unsigned long long>(task->second.runner));
+        } else if (task != tasks_.end()) {
+            snprintf(buf, sizeof(buf), "is waiting for task 0x%llx (queued in pool 0x%llx, all workers busy)",
+                     static_cast<unsigned long long>(wait->second),
+                     static_cast<unsigned long long>(task->second.pool_id));
+        } else {
+            snprintf(buf, sizeof(buf), "is waiting for task 0x%llx", static_cast<unsigned long long>(wait->second));
+        }
+        out = buf;
+        return true;
+    }
+    return false;
+}
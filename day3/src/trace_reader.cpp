@@ -0,0 +1,175 @@
+#include "trace_reader.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+
+// ============================================
+// 打开与校验
+// ============================================
+bool TraceReader::open(const std::string& path) {
+    close();
+    path_ = path;
+
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        error_ = path + ": " + strerror(errno);
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < kTraceHeaderSize) {
+        ::close(fd);
+        error_ = path + ": file too small for a trace header";
+        return false;
+    }
+    void* addr = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (addr == MAP_FAILED) {
+        error_ = path + ": mmap failed: " + strerror(errno);
+        return false;
+    }
+    base_ = static_cast<const char*>(addr);
+    size_ = static_cast<size_t>(st.st_size);
+    header_ = reinterpret_cast<const TraceFileHeader*>(base_);
+
+    const TraceFileHeader& h = *header_;
+    if (memcmp(h.magic, kTraceMagic, sizeof(kTraceMagic)) != 0) {
+        error_ = path + ": not a lock trace (bad magic)";
+    } else if (h.version != kTraceVersion || h.event_size != sizeof(TraceEvent) ||
+               h.header_size != kTraceHeaderSize) {
+        error_ = path + ": unsupported trace version";
+    } else if (h.ring_capacity == 0 || (h.ring_capacity & (h.ring_capacity - 1)) != 0 ||
+               h.file_size > size_ ||
+               h.rings_offset + h.ring_stride * h.ring_count > size_ ||
+               h.sites_offset + static_cast<uint64_t>(h.max_sites) * sizeof(TraceSite) > h.rings_offset ||
+               h.ticks_per_ns <= 0) {
+        error_ = path + ": corrupt or truncated trace header";
+    } else {
+        error_.clear();
+        madvise(const_cast<char*>(base_), size_, MADV_SEQUENTIAL);
+        return true;
+    }
+    close();
+    return false;
+}
+
+void TraceReader::close() {
+    if (base_) {
+        munmap(const_cast<char*>(base_), size_);
+    }
+    base_ = nullptr;
+    header_ = nullptr;
+    size_ = 0;
+}
+
+TraceRingView TraceReader::ring(uint32_t index) const {
+    const TraceFileHeader& h = *header_;
+    const TraceRingHeader* rh = reinterpret_cast<const TraceRingHeader*>(
+        base_ + h.rings_offset + h.ring_stride * index);
+
+    TraceRingView view;
+    view.ring = index;
+    view.events = reinterpret_cast<const TraceEvent*>(rh + 1);
+    view.mask = h.ring_capacity - 1;
+    view.end = rh->head.load(std::memory_order_acquire);
+    // 回绕后 head % capacity 处的槽位可能写了一半，丢弃
+    view.begin = view.end >= h.ring_capacity ? view.end - h.ring_capacity + 1 : 0;
+    view.first_tid = TraceRingView::unknown_tid(index);
+
+    // 视图内没有 THREAD_START 时，所有事件都属于环头记录的最近线程
+    bool has_start = false;
+    for (uint64_t i = view.begin; i < view.end; i++) {
+        if (view.at(i).kind == TRACE_THREAD_START) {
+            has_start = true;
+            break;
+        }
+    }
+    if (!has_start && view.end > view.begin) {
+        view.first_tid = rh->tid.load(std::memory_order_relaxed);
+    }
+    return view;
+}
+
+const char* TraceReader::site(uint32_t site_id) const {
+    uint32_t count = header_->site_count.load(std::memory_order_acquire);
+    if (site_id == 0 || site_id > count || site_id > header_->max_sites) {
+        return "?";
+    }
+    const TraceSite* sites = reinterpret_cast<const TraceSite*>(base_ + header_->sites_offset);
+    const TraceSite& s = sites[site_id - 1];
+    return memchr(s.text, '\0', kTraceSiteLen) ? s.text : "?";
+}
+
+// ============================================
+// 多环归并
+// ============================================
+TraceMerger::TraceMerger(const TraceReader& reader) {
+    for (uint32_t r = 0; r < reader.ring_count(); r++) {
+        TraceRingView view = reader.ring(r);
+        if (view.size() > 0) {
+            cursors_.push_back(TraceRingCursor(view));
+        }
+    }
+    for (size_t c = 0; c < cursors_.size(); c++) {
+        push(c);
+    }
+}
+
+void TraceMerger::push(size_t cursor) {
+    HeapItem item;
+    if (!cursors_[cursor].peek_ticks(item.ticks)) {
+        return;
+    }
+    item.cursor = cursor;
+    heap_.push_back(item);
+    size_t pos = heap_.size() - 1;
+    while (pos > 0) {
+        size_t parent = (pos - 1) / 2;
+        if (heap_[parent].ticks <= heap_[pos].ticks) {
+            break;
+        }
+        std::swap(heap_[parent], heap_[pos]);
+        pos = parent;
+    }
+}
+
+void TraceMerger::sift_down(size_t pos) {
+    for (;;) {
+        size_t smallest = pos;
+        size_t left = pos * 2 + 1;
+        size_t right = left + 1;
+        if (left < heap_.size() && heap_[left].ticks < heap_[smallest].ticks) smallest = left;
+        if (right < heap_.size() && heap_[right].ticks < heap_[smallest].ticks) smallest = right;
+        if (smallest == pos) {
+            return;
+        }
+        std::swap(heap_[pos], heap_[smallest]);
+        pos = smallest;
+    }
+}
+
+bool TraceMerger::next(const TraceEvent*& event, uint64_t& tid, uint32_t& ring) {
+    if (heap_.empty()) {
+        return false;
+    }
+    size_t cursor = heap_[0].cursor;
+    TraceRingCursor& c = cursors_[cursor];
+    c.next(event, tid);
+    ring = c.ring();
+
+    // 用同一环的下一个事件替换堆顶；环读完则移除
+    uint64_t ticks;
+    if (c.peek_ticks(ticks)) {
+        heap_[0].ticks = ticks;
+    } else {
+        heap_[0] = heap_.back();
+        heap_.pop_back();
+    }
+    if (!heap_.empty()) {
+        sift_down(0);
+    }
+    return true;
+}
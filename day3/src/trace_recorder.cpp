@@ -0,0 +1,154 @@
+#include "trace_recorder.h"
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+static uint64_t round_up_pow2(uint64_t value) {
+    uint64_t result = 1;
+    while (result < value) {
+        result <<= 1;
+    }
+    return result;
+}
+
+static uint64_t round_up(uint64_t value, uint64_t align) {
+    return (value + align - 1) / align * align;
+}
+
+// ============================================
+// 时间戳标定：在约 10ms 内同时采样 ticks 与单调时钟，求出每纳秒的 tick 数
+// ============================================
+static double calibrate_ticks_per_ns(uint64_t& start_ticks, uint64_t& start_mono_ns) {
+    start_ticks = trace_ticks();
+    start_mono_ns = precise_now_ns();
+#if defined(__x86_64__) || defined(__i386__)
+    struct timespec ts = {0, 10000000};
+    nanosleep(&ts, nullptr);
+    uint64_t ticks = trace_ticks();
+    uint64_t mono = precise_now_ns();
+    if (mono > start_mono_ns && ticks > start_ticks) {
+        return static_cast<double>(ticks - start_ticks) / static_cast<double>(mono - start_mono_ns);
+    }
+#endif
+    return 1.0;
+}
+
+// ============================================
+// 打开 / 关闭
+// ============================================
+bool TraceRecorder::open(const TraceConfig& config) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    if (active_.load() || config.path.empty() || config.max_threads == 0) {
+        return false;
+    }
+
+    uint64_t capacity = round_up_pow2(config.events_per_thread < 16 ? 16 : config.events_per_thread);
+    uint64_t sites_offset = kTraceHeaderSize;
+    uint64_t rings_offset = round_up(sites_offset + static_cast<uint64_t>(config.max_sites) * sizeof(TraceSite), 4096);
+    uint64_t ring_stride = round_up(sizeof(TraceRingHeader) + capacity * sizeof(TraceEvent), 4096);
+    uint64_t file_size = rings_offset + ring_stride * config.max_threads;
+
+    int fd = ::open(config.path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    // 稀疏文件：只有实际写到的页才占用空间
+    if (ftruncate(fd, static_cast<off_t>(file_size)) != 0) {
+        ::close(fd);
+        return false;
+    }
+    void* addr = mmap(nullptr, file_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (addr == MAP_FAILED) {
+        return false;
+    }
+
+    Mapping* m = new Mapping();
+    m->base = static_cast<char*>(addr);
+    m->size = file_size;
+    m->header = reinterpret_cast<TraceFileHeader*>(addr);
+    m->path = config.path;
+
+    TraceFileHeader* h = m->header;
+    h->version = kTraceVersion;
+    h->header_size = kTraceHeaderSize;
+    h->event_size = sizeof(TraceEvent);
+    h->ring_count = config.max_threads;
+    h->ring_capacity = static_cast<uint32_t>(capacity);
+    h->max_sites = config.max_sites;
+    h->sites_offset = sites_offset;
+    h->rings_offset = rings_offset;
+    h->ring_stride = ring_stride;
+    h->file_size = file_size;
+    h->ticks_per_ns = calibrate_ticks_per_ns(h->start_ticks, h->start_mono_ns);
+    struct timespec wall;
+    clock_gettime(CLOCK_REALTIME, &wall);
+    h->start_wall_ns = static_cast<uint64_t>(wall.tv_sec) * 1000000000ull + static_cast<uint64_t>(wall.tv_nsec);
+    h->pid = static_cast<uint32_t>(getpid());
+    h->site_count.store(0, std::memory_order_relaxed);
+    // magic 最后写入：崩溃在初始化途中的文件不会被读者当成有效追踪
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(h->magic, kTraceMagic, sizeof(kTraceMagic));
+
+    mappings_.push_back(m);
+    active_.store(m, std::memory_order_release);
+    return true;
+}
+
+void TraceRecorder::close() {
+    std::lock_guard<std::mutex> guard(mutex_);
+    Mapping* m = active_.exchange(nullptr);
+    if (m) {
+        msync(m->base, m->size, MS_ASYNC);
+    }
+}
+
+std::string TraceRecorder::path() const {
+    std::lock_guard<std::mutex> guard(mutex_);
+    return mappings_.empty() ? std::string() : mappings_.back()->path;
+}
+
+// ============================================
+// 慢路径：线程绑定环、登记调用位置
+// ============================================
+void TraceRecorder::attach(Mapping* m, const ThreadSlot& slot, LocalState& local) {
+    memset(&local, 0, sizeof(local));
+    local.mapping = m;
+
+    const TraceFileHeader* h = m->header;
+    if (slot.ordinal >= h->ring_count) {
+        return; // 不记录该线程
+    }
+    local.ring = reinterpret_cast<TraceRingHeader*>(m->base + h->rings_offset + h->ring_stride * slot.ordinal);
+    local.events = reinterpret_cast<TraceEvent*>(local.ring + 1);
+    local.mask = h->ring_capacity - 1;
+
+    // 序号可能被新线程复用：环头记录最近的线程，事件流中的 THREAD_START 标记分界
+    local.ring->ordinal = slot.ordinal;
+    uint64_t tid = slot.tid.load(std::memory_order_relaxed);
+    local.ring->tid.store(tid, std::memory_order_relaxed);
+    append(local, TRACE_THREAD_START, tid, 0);
+}
+
+uint32_t TraceRecorder::intern_site(Mapping* m, const char* site) {
+    std::lock_guard<std::mutex> guard(mutex_sites_);
+    auto it = m->site_ids.find(site);
+    if (it != m->site_ids.end()) {
+        return it->second;
+    }
+
+    TraceFileHeader* h = m->header;
+    uint32_t count = h->site_count.load(std::memory_order_relaxed);
+    if (count >= h->max_sites) {
+        return 0;
+    }
+    TraceSite* sites = reinterpret_cast<TraceSite*>(m->base + h->sites_offset);
+    strncpy(sites[count].text, site, kTraceSiteLen - 1);
+    sites[count].text[kTraceSiteLen - 1] = '\0';
+    h->site_count.store(count + 1, std::memory_order_release);
+
+    uint32_t id = count + 1;
+    m->site_ids[site] = id;
+    return id;
+}
@@ -1,7 +1,15 @@
 #include "deadlock_detector.h"
+#include "trace_reader.h"
+#include "tracked_mutex.h"
 #include <pthread.h>
 #include <unistd.h>
 #include <iostream>
+#include <errno.h>
+#include <time.h>
+#include <sys/epoll.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
 
 pthread_mutex_t mutex1 = PTHREAD_MUTEX_INITIALIZER;
 pthread_mutex_t mutex2 = PTHREAD_MUTEX_INITIALIZER;
@@ -46,6 +54,9 @@ void test_auto_detection() {
     std::cout << "║  Test 1: Auto Detection (2 threads)    ║\n";
     std::cout << "╚═════════════════════════════════════════╝\n\n";
     
+    // 发布共享内存统计段，可在另一个终端用 ddstat 查看
+    DeadlockDetector::instance().publish_stats();
+    
     // 启动后台检测（每1秒检测一次）
     DeadlockDetector::instance().start(1); // 自动化
     
@@ -60,7 +71,9 @@ void test_auto_detection() {
     // 停止检测器
     DeadlockDetector::instance().stop();
     
-    std::cout << "\n[Main] Test finished. Press Ctrl+C to exit.\n";
+    std::cout << "\n[Main] Test finished. Inspect with: ddstat -n "
+              << DeadlockDetector::instance().stats_segment_name() << "\n";
+    std::cout << "[Main] Press Ctrl+C to exit.\n";
     pthread_join(t1, nullptr);
     pthread_join(t2, nullptr);
 }
@@ -163,9 +176,1303 @@ void test_no_false_positive() {
     
     DeadlockDetector::instance().stop();
     
+    DetectorStats stats = DeadlockDetector::instance().stats();
+    std::cout << "[Main] " << stats.lock_after_calls << " acquisitions, "
+              << stats.detections_run << " detections, "
+              << stats.deadlocks_found << " deadlocks found\n";
+    
+    SelfProfileSummary profile = DeadlockDetector::instance().self_profile();
+    std::cout << "[Main] Detection pass p50/max: "
+              << profile.metrics[PASS_TOTAL_NS].p50 << "/" << profile.metrics[PASS_TOTAL_NS].max
+              << " ns, snapshot copied " << profile.metrics[PASS_BYTES_COPIED].max << " bytes max\n";
     std::cout << " No deadlock detected - this is correct!\n";
 }
 
+// ============================================
+// 测试4：事件循环模式（无检测线程，epoll + poll_once）
+// ============================================
+void test_event_loop() {
+    std::cout << "\n╔═════════════════════════════════════════╗\n";
+    std::cout << "║  Test 4: Event Loop Integration        ║\n";
+    std::cout << "╚═════════════════════════════════════════╝\n\n";
+    
+    DeadlockDetector& detector = DeadlockDetector::instance();
+    detector.set_interval(1);
+    
+    int epfd = epoll_create1(0);
+    struct epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.fd = detector.event_fd();
+    epoll_ctl(epfd, EPOLL_CTL_ADD, ev.data.fd, &ev);
+    
+    pthread_t t1, t2;
+    pthread_create(&t1, nullptr, deadlock_thread1, nullptr);
+    pthread_create(&t2, nullptr, deadlock_thread2, nullptr);
+    
+    // 宿主事件循环：每次只处理 1 个等待线程，演示分片扫描
+    bool found = false;
+    for (int i = 0; i < 200 && !found; i++) {
+        // 分片扫描未完成时不阻塞，下一轮循环继续推进
+        struct epoll_event ready;
+        int timeout_ms = detector.poll_pending() ? 0 : 100;
+        if (epoll_wait(epfd, &ready, 1, timeout_ms) > 0 || detector.poll_pending()) {
+            found = detector.poll_once(1);
+        }
+    }
+    
+    std::cout << "\n[Main] Event loop " << (found ? "found" : "did not find")
+              << " the deadlock. Press Ctrl+C to exit.\n";
+    detector.close_event_fd();
+    close(epfd);
+    
+    pthread_join(t1, nullptr);
+    pthread_join(t2, nullptr);
+}
+
+// ============================================
+// 测试5：长等待看门狗（持有者卡在慢调用上，不构成环）
+// ============================================
+void* slow_holder_thread(void* arg) {
+    pthread_mutex_lock(&mutex1);
+    std::cout << "[SlowHolder] Acquired mutex1, sleeping 4 seconds...\n";
+    sleep(4); // 模拟持锁期间的慢 I/O
+    pthread_mutex_unlock(&mutex1);
+    return nullptr;
+}
+
+void* starved_thread(void* arg) {
+    usleep(200000);
+    std::cout << "[Starved] Trying to acquire mutex1...\n";
+    pthread_mutex_lock(&mutex1);
+    std::cout << "[Starved] Finally acquired mutex1\n";
+    pthread_mutex_unlock(&mutex1);
+    return nullptr;
+}
+
+void test_long_wait_watchdog() {
+    std::cout << "\n╔═════════════════════════════════════════╗\n";
+    std::cout << "║  Test 5: Long Wait Watchdog            ║\n";
+    std::cout << "╚═════════════════════════════════════════╝\n\n";
+    
+    AdaptiveIntervalConfig config;
+    config.min_interval_ms = 100;
+    config.max_interval_ms = 500;
+    config.long_wait_ms = 500;
+    DeadlockDetector::instance().set_adaptive(config);
+    DeadlockDetector::instance().set_wait_budget_ms(1000);
+    DeadlockDetector::instance().start();
+    
+    pthread_t t1, t2;
+    pthread_create(&t1, nullptr, slow_holder_thread, nullptr);
+    pthread_create(&t2, nullptr, starved_thread, nullptr);
+    
+    pthread_join(t1, nullptr);
+    pthread_join(t2, nullptr);
+    
+    DeadlockDetector::instance().stop();
+    std::cout << " Long wait reported without a deadlock report - this is correct!\n";
+}
+
+// ============================================
+// 测试6：锁竞争剖析
+// ============================================
+void* contention_thread(void* arg) {
+    for (int i = 0; i < 2000; i++) {
+        pthread_mutex_lock(&mutex1);      // 热点锁：4 个线程争抢
+        usleep(10);
+        pthread_mutex_unlock(&mutex1);
+        
+        pthread_mutex_lock(&mutex2);      // 冷锁：持有时间极短
+        pthread_mutex_unlock(&mutex2);
+    }
+    return nullptr;
+}
+
+void test_contention_profile() {
+    std::cout << "\n╔═════════════════════════════════════════╗\n";
+    std::cout << "║  Test 6: Lock Contention Profile       ║\n";
+    std::cout << "╚═════════════════════════════════════════╝\n\n";
+    
+    DeadlockDetector& detector = DeadlockDetector::instance();
+    detector.profiler().set_enabled(true);
+    
+    pthread_t threads[4];
+    for (int i = 0; i < 4; i++) {
+        pthread_create(&threads[i], nullptr, contention_thread, nullptr);
+    }
+    for (int i = 0; i < 4; i++) {
+        pthread_join(threads[i], nullptr);
+    }
+    
+    std::vector<LockContentionStats> top = detector.top_contended(2);
+    for (size_t i = 0; i < top.size(); i++) {
+        std::cout << "  lock 0x" << std::hex << top[i].key << std::dec
+                  << (top[i].key == reinterpret_cast<uint64_t>(&mutex1) ? " (mutex1)" : " (mutex2)")
+                  << ": acquisitions=" << top[i].acquisitions
+                  << " contended=" << top[i].contended
+                  << " wait p99=" << top[i].wait_hist.percentile(99) << " ns"
+                  << " hold p50=" << top[i].hold_hist.percentile(50) << " ns\n";
+    }
+    
+    std::vector<SpaceSaving::Item> sites = detector.profiler().heavy_hitter_sites(1);
+    if (!sites.empty()) {
+        std::cout << "  hottest site: " << reinterpret_cast<const char*>(sites[0].key)
+                  << " (contended=" << sites[0].count << ", err=" << sites[0].error << ")\n";
+    }
+    detector.profiler().set_enabled(false);
+    std::cout << " mutex1 should be the most contended lock.\n";
+}
+
+// ============================================
+// 测试7：锁事件追踪（飞行记录仪）
+// ============================================
+void test_trace_recorder() {
+    std::cout << "\n╔═════════════════════════════════════════╗\n";
+    std::cout << "║  Test 7: Lock Event Trace Recorder     ║\n";
+    std::cout << "╚═════════════════════════════════════════╝\n\n";
+    
+    DeadlockDetector& detector = DeadlockDetector::instance();
+    TraceConfig config;
+    config.path = "/tmp/deadlock_trace.bin";
+    config.max_threads = 16;
+    config.events_per_thread = 4096;
+    if (!detector.trace().open(config)) {
+        std::cout << "[Main] Failed to open " << config.path << "\n";
+        return;
+    }
+    
+    pthread_t threads[2];
+    for (int i = 0; i < 2; i++) {
+        pthread_create(&threads[i], nullptr, contention_thread, nullptr);
+    }
+    for (int i = 0; i < 2; i++) {
+        pthread_join(threads[i], nullptr);
+    }
+    detector.trace().close();
+    
+    // 用 TraceReader 映射文件读回（进程被 kill 后也可以这样读，离线分析见 ddtrace analyze）
+    TraceReader reader;
+    if (!reader.open(config.path)) {
+        std::cout << "[Main] " << reader.error() << "\n";
+        return;
+    }
+    std::cout << "[Main] " << config.path << ": " << reader.ring_count() << " rings x "
+              << reader.header().ring_capacity << " events, " << reader.header().site_count.load()
+              << " sites, " << reader.header().ticks_per_ns << " ticks/ns\n";
+    for (uint32_t r = 0; r < reader.ring_count(); r++) {
+        TraceRingView view = reader.ring(r);
+        if (view.end != 0) {
+            uint32_t site_id = 0;
+            for (uint64_t i = view.end; i > view.begin && site_id == 0; i--) {
+                site_id = view.at(i - 1).site_id;
+            }
+            std::cout << "  ring " << r << ": " << view.end << " events recorded, "
+                      << view.size() << " readable, last site " << reader.site(site_id) << "\n";
+        }
+    }
+    std::cout << " Two worker rings with 12003 events each: thread start, create/exit sync\n"
+              << " events and 12000 lock events (only the newest 4095 are kept).\n";
+}
+
+// ============================================
+// 测试8：trylock / timedlock
+// 线程1 用 trylock 拿到 mutex1，线程2 用 timedlock 拿到 mutex2，随后交叉等待。
+// 检测器应在 timedlock 超时前发现死锁；超时后等待被撤回，线程2 放弃并释放 mutex2
+// ============================================
+static struct timespec deadline_after(int seconds) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    ts.tv_sec += seconds;
+    return ts;
+}
+
+void* trylock_thread(void* arg) {
+    if (pthread_mutex_trylock(&mutex1) != 0) {
+        std::cout << "[TryThread] trylock(mutex1) failed unexpectedly\n";
+        return nullptr;
+    }
+    std::cout << "[TryThread] trylock acquired mutex1\n";
+    sleep(1);
+    
+    std::cout << "[TryThread] Trying to acquire mutex2...\n";
+    pthread_mutex_lock(&mutex2);
+    std::cout << "[TryThread] Acquired mutex2 after the timed waiter gave up\n";
+    
+    pthread_mutex_unlock(&mutex2);
+    pthread_mutex_unlock(&mutex1);
+    return nullptr;
+}
+
+void* timedlock_thread(void* arg) {
+    struct timespec ts = deadline_after(5);
+    if (pthread_mutex_timedlock(&mutex2, &ts) != 0) {
+        std::cout << "[TimedThread] timedlock(mutex2) failed unexpectedly\n";
+        return nullptr;
+    }
+    std::cout << "[TimedThread] timedlock acquired mutex2\n";
+    sleep(1);
+    
+    std::cout << "[TimedThread] Trying mutex1 with a 3 second timeout...\n";
+    ts = deadline_after(3);
+    int rc = pthread_mutex_timedlock(&mutex1, &ts);
+    if (rc == ETIMEDOUT) {
+        std::cout << "[TimedThread] Timed out, backing off\n";
+    } else if (rc == 0) {
+        pthread_mutex_unlock(&mutex1);
+    }
+    
+    pthread_mutex_unlock(&mutex2);
+    return nullptr;
+}
+
+void test_trylock_timedlock() {
+    std::cout << "\n╔═════════════════════════════════════════╗\n";
+    std::cout << "║  Test 8: trylock / timedlock           ║\n";
+    std::cout << "╚═════════════════════════════════════════╝\n\n";
+    
+    DeadlockDetector& detector = DeadlockDetector::instance();
+    detector.start(1);
+    
+    pthread_t t1, t2;
+    pthread_create(&t1, nullptr, trylock_thread, nullptr);
+    pthread_create(&t2, nullptr, timedlock_thread, nullptr);
+    pthread_join(t1, nullptr);
+    pthread_join(t2, nullptr);
+    
+    detector.stop();
+    
+    // 超时的等待已撤回：状态中不应再有等待线程
+    detector.print_status();
+    AsyncReporter::instance().flush();
+    std::cout << "[Main] " << detector.stats().failed_lock_calls
+              << " failed trylock/timedlock call(s) (expected 1)\n";
+}
+
+// ============================================
+// 测试9：读写锁（写者等待多个读者）
+// 两个读者持有读锁，写者持有 mutex1 后请求写锁（等待两个读者），
+// 其中一个读者再去拿 mutex1：写者 → 读者 → 写者 成环。
+// 写者用 timedwrlock，超时后放弃，测试可以正常结束。
+// 看门狗预算 300ms：长等待报告应把两个读者列为写者等待的持有者
+// ============================================
+pthread_rwlock_t rwlock = PTHREAD_RWLOCK_INITIALIZER;
+
+void* reader_thread(void* arg) {
+    bool wants_mutex = arg != nullptr;
+    pthread_rwlock_rdlock(&rwlock);
+    std::cout << "[Reader] Holding read lock\n";
+    sleep(1);
+    if (wants_mutex) {
+        std::cout << "[Reader] Trying to acquire mutex1...\n";
+        pthread_mutex_lock(&mutex1);
+        pthread_mutex_unlock(&mutex1);
+    } else {
+        sleep(4);
+    }
+    pthread_rwlock_unlock(&rwlock);
+    return nullptr;
+}
+
+void* writer_thread(void* arg) {
+    pthread_mutex_lock(&mutex1);
+    std::cout << "[Writer] Holding mutex1\n";
+    usleep(500 * 1000);
+    
+    std::cout << "[Writer] Waiting for the write lock (3 second timeout)...\n";
+    struct timespec ts = deadline_after(3);
+    if (pthread_rwlock_timedwrlock(&rwlock, &ts) == 0) {
+        pthread_rwlock_unlock(&rwlock);
+    } else {
+        std::cout << "[Writer] Timed out, releasing mutex1\n";
+    }
+    pthread_mutex_unlock(&mutex1);
+    return nullptr;
+}
+
+void test_rwlock() {
+    std::cout << "\n╔═════════════════════════════════════════╗\n";
+    std::cout << "║  Test 9: Reader-Writer Lock            ║\n";
+    std::cout << "╚═════════════════════════════════════════╝\n\n";
+    
+    DeadlockDetector& detector = DeadlockDetector::instance();
+    detector.set_wait_budget_ms(300);
+    detector.start(1);
+    
+    pthread_t readers[2], writer;
+    pthread_create(&readers[0], nullptr, reader_thread, nullptr);
+    pthread_create(&readers[1], nullptr, reader_thread, &readers[1]);
+    usleep(100 * 1000);
+    pthread_create(&writer, nullptr, writer_thread, nullptr);
+    
+    // 写者等待期间查看状态：写锁等待两个读者
+    sleep(2);
+    detector.print_status();
+    
+    pthread_join(writer, nullptr);
+    pthread_join(readers[0], nullptr);
+    pthread_join(readers[1], nullptr);
+    detector.stop();
+    detector.set_wait_budget_ms(0);
+}
+
+// ============================================
+// 测试10：TrackedMutex 系列（std::lock_guard / std::unique_lock / std::lock）
+// 线程1 持有 tracked_a 后用 try_lock_for 请求 tracked_b，线程2 持有 tracked_b 后请求 tracked_a，
+// 检测器从锁对象内联的持有者字段建图发现死锁；线程1 超时放弃后两者都能完成
+// ============================================
+TrackedMutex tracked_a("tracked_a");
+TrackedTimedMutex tracked_b("tracked_b");
+TrackedRecursiveMutex tracked_r("tracked_r");
+
+void* tracked_thread1(void* arg) {
+    std::lock_guard<TrackedMutex> a(tracked_a);
+    std::cout << "[Tracked1] Holding tracked_a\n";
+    sleep(1);
+    std::cout << "[Tracked1] Trying tracked_b with a 3 second timeout...\n";
+    std::unique_lock<TrackedTimedMutex> b(tracked_b, std::chrono::seconds(3));
+    if (!b.owns_lock()) {
+        std::cout << "[Tracked1] Timed out, backing off\n";
+    }
+    return nullptr;
+}
+
+void* tracked_thread2(void* arg) {
+    std::lock_guard<TrackedTimedMutex> b(tracked_b);
+    std::cout << "[Tracked2] Holding tracked_b\n";
+    sleep(1);
+    std::cout << "[Tracked2] Trying tracked_a...\n";
+    std::lock_guard<TrackedMutex> a(tracked_a);
+    std::cout << "[Tracked2] Acquired tracked_a\n";
+    return nullptr;
+}
+
+void test_tracked_mutex() {
+    std::cout << "\n╔═════════════════════════════════════════╗\n";
+    std::cout << "║  Test 10: TrackedMutex (C++ wrappers)  ║\n";
+    std::cout << "╚═════════════════════════════════════════╝\n\n";
+    
+    // std::lock 与递归锁：持有者直接从锁对象读取
+    {
+        std::lock(tracked_a, tracked_r);
+        std::lock_guard<TrackedMutex> a(tracked_a, std::adopt_lock);
+        std::lock_guard<TrackedRecursiveMutex> r(tracked_r, std::adopt_lock);
+        std::lock_guard<TrackedRecursiveMutex> again(tracked_r);
+        std::cout << "[Main] std::lock: tracked_a owner " << tracked_a.owner()
+                  << ", tracked_r owner " << tracked_r.owner() << " (self " << get_thread_id() << ")\n";
+    }
+    std::cout << "[Main] After unlock: owners " << tracked_a.owner() << ", " << tracked_r.owner() << "\n";
+    
+    DeadlockDetector& detector = DeadlockDetector::instance();
+    detector.start(1);
+    
+    pthread_t t1, t2;
+    pthread_create(&t1, nullptr, tracked_thread1, nullptr);
+    pthread_create(&t2, nullptr, tracked_thread2, nullptr);
+    pthread_join(t1, nullptr);
+    pthread_join(t2, nullptr);
+    
+    detector.stop();
+    detector.print_status();
+}
+
+// ============================================
+// 测试11：条件变量等待
+// 消费者持有 mutex2 时在 queue_cond 上睡眠（queue_mutex 在睡眠期间被释放）。
+// 看门狗应报告长时间的条件等待及其互斥锁，并指出睡眠时仍持有 mutex2；
+// 睡眠期间 queue_mutex 不应显示为被持有，生产者可以正常拿到它。
+// 最后在别的线程持有的检错锁上 cond_wait：立即返回 EPERM，
+// 真正持有者的记录必须保留，它参与的 ABBA 死锁仍能被检测到
+// ============================================
+pthread_mutex_t queue_mutex = PTHREAD_MUTEX_INITIALIZER;
+pthread_mutex_t unowned_cond_mutex = PTHREAD_ERRORCHECK_MUTEX_INITIALIZER_NP;
+pthread_mutex_t unowned_cond_other = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t queue_cond = PTHREAD_COND_INITIALIZER;
+int queue_items = 0;
+
+void* consumer_thread(void* arg) {
+    pthread_mutex_lock(&mutex2);
+    pthread_mutex_lock(&queue_mutex);
+    std::cout << "[Consumer] Waiting for an item (still holding mutex2)...\n";
+    while (queue_items == 0) {
+        pthread_cond_wait(&queue_cond, &queue_mutex);
+    }
+    queue_items--;
+    std::cout << "[Consumer] Got an item\n";
+    pthread_mutex_unlock(&queue_mutex);
+    pthread_mutex_unlock(&mutex2);
+    return nullptr;
+}
+
+void* cond_owner_thread(void* arg) {
+    (void)arg;
+    pthread_mutex_lock(&unowned_cond_mutex);
+    usleep(500000);
+    pthread_mutex_lock(&unowned_cond_other);   // 与 cond_other_thread 构成 ABBA，永远阻塞
+    return nullptr;
+}
+
+void* cond_other_thread(void* arg) {
+    (void)arg;
+    pthread_mutex_lock(&unowned_cond_other);
+    usleep(500000);
+    pthread_mutex_lock(&unowned_cond_mutex);
+    return nullptr;
+}
+
+void test_cond_wait() {
+    std::cout << "\n╔═════════════════════════════════════════╗\n";
+    std::cout << "║  Test 11: Condition Variable Waits     ║\n";
+    std::cout << "╚═════════════════════════════════════════╝\n\n";
+    
+    DeadlockDetector& detector = DeadlockDetector::instance();
+    detector.set_wait_budget_ms(1000);
+    detector.start(1);
+    
+    pthread_t consumer;
+    pthread_create(&consumer, nullptr, consumer_thread, nullptr);
+    sleep(3);
+    
+    // 消费者睡眠中：queue_mutex 空闲，只有 mutex2 被持有
+    detector.print_status();
+    AsyncReporter::instance().flush();
+    
+    pthread_mutex_lock(&queue_mutex);
+    queue_items++;
+    std::cout << "[Producer] Produced an item\n";
+    pthread_cond_signal(&queue_cond);
+    pthread_mutex_unlock(&queue_mutex);
+    
+    pthread_join(consumer, nullptr);
+    detector.stop();
+    detector.set_wait_budget_ms(0);
+    
+    pthread_t owner, other;
+    pthread_create(&owner, nullptr, cond_owner_thread, nullptr);
+    pthread_create(&other, nullptr, cond_other_thread, nullptr);
+    pthread_detach(owner);
+    pthread_detach(other);
+    usleep(200000);   // 两个线程都已拿到各自的第一把锁
+    
+    int rc = pthread_cond_wait(&queue_cond, &unowned_cond_mutex);
+    std::cout << "[Main] cond_wait on a mutex held by another thread returned "
+              << rc << (rc == EPERM ? " (EPERM)" : "") << ", the owner's record must survive\n";
+    usleep(800000);   // 两个线程进入 ABBA
+    bool found = detector.check_deadlock();
+    AsyncReporter::instance().flush();
+    std::cout << "[Main] ABBA through the error-checking mutex "
+              << (found ? "detected - this is correct!" : "NOT detected") << "\n";
+    detector.print_status();
+}
+
+// ============================================
+// 测试12：线程 → 线程 的等待（pthread_join、线程池任务）
+// A. 主线程持有 mutex1 后 join 线程 T，而 T 在等 mutex1：join 边与锁边构成环。
+//    T 用 timedlock，超时后退出，join 随之返回
+// B. 两个工作线程的线程池，每个任务又向同一线程池提交子任务并等待其结果：
+//    子任务排在队列中，而所有工作线程都在等，构成线程池饥饿环（用 sleep 代替阻塞的等待）
+// ============================================
+void* joinee_thread(void* arg) {
+    usleep(500 * 1000);
+    std::cout << "[Joinee] Trying mutex1 with a 3 second timeout...\n";
+    struct timespec ts = deadline_after(3);
+    if (pthread_mutex_timedlock(&mutex1, &ts) == 0) {
+        pthread_mutex_unlock(&mutex1);
+    } else {
+        std::cout << "[Joinee] Timed out, exiting\n";
+    }
+    return nullptr;
+}
+
+static const uint64_t kTestPool = 0x9001;
+
+void* pool_worker_thread(void* arg) {
+    uint64_t task = reinterpret_cast<uint64_t>(arg);
+    uint64_t subtask = task + 100;
+    ThreadWaitTracker& waits = DeadlockDetector::instance().thread_waits();
+    
+    waits.worker_begin(kTestPool);
+    waits.task_begin(task);
+    std::cout << "[Worker] Running task " << task << ", waiting for subtask " << subtask << "...\n";
+    waits.task_submit(kTestPool, subtask);
+    waits.task_wait_begin(subtask);
+    sleep(3);                        // 真实线程池中这里会永远阻塞
+    waits.task_wait_end(subtask);
+    waits.task_end(task);
+    waits.worker_end(kTestPool);
+    return nullptr;
+}
+
+void test_thread_waits() {
+    std::cout << "\n╔═════════════════════════════════════════╗\n";
+    std::cout << "║  Test 12: Join / Thread Pool Waits     ║\n";
+    std::cout << "╚═════════════════════════════════════════╝\n\n";
+    
+    DeadlockDetector& detector = DeadlockDetector::instance();
+    
+    std::cout << "--- A. Joining a thread that needs a lock we hold ---\n";
+    detector.start(1);
+    pthread_mutex_lock(&mutex1);
+    pthread_t joinee;
+    pthread_create(&joinee, nullptr, joinee_thread, nullptr);
+    std::cout << "[Main] Holding mutex1, joining the thread...\n";
+    pthread_join(joinee, nullptr);
+    pthread_mutex_unlock(&mutex1);
+    detector.stop();
+    AsyncReporter::instance().flush();
+    
+    std::cout << "\n--- B. Thread pool starvation ---\n";
+    detector.start(1);
+    ThreadWaitTracker& waits = detector.thread_waits();
+    waits.task_submit(kTestPool, 1);
+    waits.task_submit(kTestPool, 2);
+    pthread_t workers[2];
+    pthread_create(&workers[0], nullptr, pool_worker_thread, reinterpret_cast<void*>(1));
+    pthread_create(&workers[1], nullptr, pool_worker_thread, reinterpret_cast<void*>(2));
+    pthread_join(workers[0], nullptr);
+    pthread_join(workers[1], nullptr);
+    detector.stop();
+}
+
+// ============================================
+// 测试13：信号量与屏障（资源分配图归约）
+// A. 3 个单位的信号量：T1 持有 1 个单位和 mutex1 后再要 1 个单位，T2 持有 1 个单位并等 mutex1，
+//    T3 持有最后 1 个单位但没有阻塞——图中有环，但 T3 归还后 T1 即可推进，不是死锁
+// B. 2 个单位的信号量：同样的 T1 / T2，但没有 T3——无法归约，是死锁（T1 超时后放弃）
+// C. 2 方屏障：第一轮正常通过（学习参与者）；第二轮 B1 持有 mutex2 到达屏障，
+//    B2 在到达前等 mutex2——屏障上唯一未到达的参与者阻塞，构成环（B2 超时后放弃）
+// D. 3 方屏障：同样的 B1 / B2，外加一个只在计算、没有阻塞的 B3——
+//    屏障要所有人到齐才放行，B2 永远到不了，仍是死锁
+// E. 有界缓冲区：2 个空位的信号量，生产者连续 wait 3 次，消费者 3 秒后才开始 post——
+//    生产者自己持有全部单位并等待更多，但任何线程都能 post，不是死锁
+// ============================================
+sem_t units_sem;
+
+void* sem_holder_thread(void* arg) {
+    bool wants_more = arg != nullptr;
+    sem_wait(&units_sem);
+    if (wants_more) {
+        pthread_mutex_lock(&mutex1);
+        usleep(500 * 1000);
+        std::cout << "[SemHolder] Holding 1 unit and mutex1, waiting for another unit (3 second timeout)...\n";
+        struct timespec ts = deadline_after(3);
+        if (sem_timedwait(&units_sem, &ts) == 0) {
+            std::cout << "[SemHolder] Got the second unit\n";
+            sem_post(&units_sem);
+        } else {
+            std::cout << "[SemHolder] Timed out, backing off\n";
+        }
+        pthread_mutex_unlock(&mutex1);
+    } else {
+        usleep(200 * 1000);
+        std::cout << "[SemWaiter] Holding 1 unit, waiting for mutex1...\n";
+        pthread_mutex_lock(&mutex1);
+        pthread_mutex_unlock(&mutex1);
+    }
+    sem_post(&units_sem);
+    return nullptr;
+}
+
+void* sem_idle_thread(void* arg) {
+    sem_wait(&units_sem);
+    std::cout << "[SemIdle] Holding 1 unit for 2 seconds (not blocked)\n";
+    sleep(2);
+    sem_post(&units_sem);
+    return nullptr;
+}
+
+void run_semaphore_scenario(unsigned units) {
+    DeadlockDetector& detector = DeadlockDetector::instance();
+    sem_init(&units_sem, 0, units);
+    detector.start(1);
+    
+    pthread_t threads[3];
+    size_t count = 0;
+    if (units == 3) {
+        pthread_create(&threads[count++], nullptr, sem_idle_thread, nullptr);
+        usleep(100 * 1000);
+    }
+    pthread_create(&threads[count++], nullptr, sem_holder_thread, &units_sem);
+    usleep(100 * 1000);
+    pthread_create(&threads[count++], nullptr, sem_holder_thread, nullptr);
+    for (size_t i = 0; i < count; i++) {
+        pthread_join(threads[i], nullptr);
+    }
+    
+    detector.stop();
+    AsyncReporter::instance().flush();
+    sem_destroy(&units_sem);
+}
+
+sem_t buffer_slots;
+
+void* buffer_producer_thread(void* arg) {
+    (void)arg;
+    for (int i = 0; i < 3; i++) {
+        sem_wait(&buffer_slots);
+        std::cout << "[Producer] Filled slot " << i + 1 << "\n";
+    }
+    return nullptr;
+}
+
+void* buffer_consumer_thread(void* arg) {
+    (void)arg;
+    sleep(3);
+    std::cout << "[Consumer] Freeing a slot\n";
+    sem_post(&buffer_slots);
+    return nullptr;
+}
+
+void run_bounded_buffer_scenario() {
+    DeadlockDetector& detector = DeadlockDetector::instance();
+    sem_init(&buffer_slots, 0, 2);
+    detector.start(1);
+    pthread_t producer, consumer;
+    pthread_create(&producer, nullptr, buffer_producer_thread, nullptr);
+    pthread_create(&consumer, nullptr, buffer_consumer_thread, nullptr);
+    pthread_join(producer, nullptr);
+    pthread_join(consumer, nullptr);
+    detector.stop();
+    AsyncReporter::instance().flush();
+    sem_destroy(&buffer_slots);
+}
+
+pthread_barrier_t phase_barrier;
+
+// 屏障参与者的角色：持有 mutex2 后到达 / 到达前先请求 mutex2 / 只是计算得慢
+enum BarrierRole {
+    BARRIER_HOLDER = 0,
+    BARRIER_BLOCKED,
+    BARRIER_SLOW
+};
+
+void* barrier_thread(void* arg) {
+    int role = static_cast<int>(reinterpret_cast<intptr_t>(arg));
+    pthread_barrier_wait(&phase_barrier);   // 第一轮：检测器学到全部参与者
+    if (role == BARRIER_HOLDER) {
+        pthread_mutex_lock(&mutex2);
+        std::cout << "[BarrierHolder] Holding mutex2, arriving at the barrier\n";
+        pthread_barrier_wait(&phase_barrier);
+        pthread_mutex_unlock(&mutex2);
+    } else if (role == BARRIER_BLOCKED) {
+        usleep(500 * 1000);
+        std::cout << "[BarrierBlocked] Trying mutex2 before arriving (3 second timeout)...\n";
+        struct timespec ts = deadline_after(3);
+        if (pthread_mutex_timedlock(&mutex2, &ts) == 0) {
+            pthread_mutex_unlock(&mutex2);
+        } else {
+            std::cout << "[BarrierBlocked] Timed out, arriving at the barrier\n";
+        }
+        pthread_barrier_wait(&phase_barrier);
+    } else {
+        std::cout << "[BarrierSlow] Computing for 4 seconds before arriving (not blocked)\n";
+        sleep(4);
+        pthread_barrier_wait(&phase_barrier);
+    }
+    return nullptr;
+}
+
+void run_barrier_scenario(unsigned parties) {
+    DeadlockDetector& detector = DeadlockDetector::instance();
+    pthread_barrier_init(&phase_barrier, nullptr, parties);
+    detector.start(1);
+    pthread_t threads[3];
+    for (unsigned i = 0; i < parties; i++) {
+        pthread_create(&threads[i], nullptr, barrier_thread, reinterpret_cast<void*>(static_cast<intptr_t>(i)));
+    }
+    for (unsigned i = 0; i < parties; i++) {
+        pthread_join(threads[i], nullptr);
+    }
+    detector.stop();
+    AsyncReporter::instance().flush();
+    pthread_barrier_destroy(&phase_barrier);
+}
+
+void test_semaphore_barrier() {
+    std::cout << "\n╔═════════════════════════════════════════╗\n";
+    std::cout << "║  Test 13: Semaphores and Barriers      ║\n";
+    std::cout << "╚═════════════════════════════════════════╝\n\n";
+    
+    DeadlockDetector& detector = DeadlockDetector::instance();
+    
+    std::cout << "--- A. 3-unit semaphore: cycle, but not a deadlock ---\n";
+    run_semaphore_scenario(3);
+    std::cout << "[Main] " << detector.stats().deadlocks_found << " deadlock(s) found so far (expected 0)\n";
+    
+    std::cout << "\n--- B. 2-unit semaphore: deadlock ---\n";
+    run_semaphore_scenario(2);
+    
+    std::cout << "\n--- C. 2-party barrier knot ---\n";
+    run_barrier_scenario(2);
+    
+    // 第三个参与者没有阻塞，但屏障要等所有人到齐：被阻塞的参与者永远到不了
+    std::cout << "\n--- D. 3-party barrier, one participant still computing: deadlock ---\n";
+    run_barrier_scenario(3);
+    
+    std::cout << "\n--- E. Bounded buffer: producer holds every slot before the first post ---\n";
+    uint64_t before = detector.stats().deadlocks_found;
+    run_bounded_buffer_scenario();
+    std::cout << "[Main] " << detector.stats().deadlocks_found - before << " new deadlock(s) (expected 0)\n";
+}
+
+// ============================================
+// 测试14：自旋锁
+// 线程 A 持有自旋锁后请求 mutex1，线程 B 持有 mutex1 后自旋等待该自旋锁：
+// B 自旋超过阈值后登记等待，检测器报告环和 B 已消耗的自旋 CPU 时间；A 超时后放弃
+// ============================================
+pthread_spinlock_t spin;
+
+void* spin_holder_thread(void* arg) {
+    pthread_spin_lock(&spin);
+    std::cout << "[SpinHolder] Holding the spinlock\n";
+    usleep(300 * 1000);
+    std::cout << "[SpinHolder] Trying mutex1 with a 3 second timeout...\n";
+    struct timespec ts = deadline_after(3);
+    if (pthread_mutex_timedlock(&mutex1, &ts) == 0) {
+        pthread_mutex_unlock(&mutex1);
+    } else {
+        std::cout << "[SpinHolder] Timed out, releasing the spinlock\n";
+    }
+    pthread_spin_unlock(&spin);
+    return nullptr;
+}
+
+void* spin_waiter_thread(void* arg) {
+    pthread_mutex_lock(&mutex1);
+    std::cout << "[SpinWaiter] Holding mutex1\n";
+    usleep(100 * 1000);
+    std::cout << "[SpinWaiter] Spinning on the spinlock...\n";
+    pthread_spin_lock(&spin);
+    std::cout << "[SpinWaiter] Acquired the spinlock\n";
+    pthread_spin_unlock(&spin);
+    pthread_mutex_unlock(&mutex1);
+    return nullptr;
+}
+
+void test_spinlock() {
+    std::cout << "\n╔═════════════════════════════════════════╗\n";
+    std::cout << "║  Test 14: Spinlocks                    ║\n";
+    std::cout << "╚═════════════════════════════════════════╝\n\n";
+    
+    pthread_spin_init(&spin, PTHREAD_PROCESS_PRIVATE);
+    DeadlockDetector& detector = DeadlockDetector::instance();
+    detector.start(1);
+    
+    pthread_t holder, waiter;
+    pthread_create(&holder, nullptr, spin_holder_thread, nullptr);
+    usleep(100 * 1000);
+    pthread_create(&waiter, nullptr, spin_waiter_thread, nullptr);
+    pthread_join(holder, nullptr);
+    pthread_join(waiter, nullptr);
+    
+    detector.stop();
+    detector.print_status();
+    pthread_spin_destroy(&spin);
+}
+
+// ============================================
+// 测试15：递归锁 / 检错锁语义与即时自死锁检测
+// 递归锁重入后内层解锁不应丢失持有关系；检错锁重复加锁返回 EDEADLK；
+// 普通锁用 timedlock 重复加锁只会超时：只有警告，不算死锁；
+// 用 lock 重复加锁会永远阻塞：立即报告自死锁（在单独的线程里做，该线程永远不会返回）
+// ============================================
+pthread_mutex_t recursive_mutex = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+pthread_mutex_t errorcheck_mutex = PTHREAD_ERRORCHECK_MUTEX_INITIALIZER_NP;
+pthread_mutex_t self_deadlock_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+void* self_deadlock_thread(void* arg) {
+    (void)arg;
+    pthread_mutex_lock(&self_deadlock_mutex);
+    std::cout << "[SelfLocker] Relocking self_deadlock_mutex with pthread_mutex_lock (blocks forever)...\n";
+    pthread_mutex_lock(&self_deadlock_mutex);
+    return nullptr;
+}
+
+void test_mutex_kinds() {
+    std::cout << "\n╔═════════════════════════════════════════╗\n";
+    std::cout << "║  Test 15: Recursive / Error-checking   ║\n";
+    std::cout << "╚═════════════════════════════════════════╝\n\n";
+    
+    DeadlockDetector& detector = DeadlockDetector::instance();
+    
+    // 递归锁：加锁两次、解锁一次后仍由本线程持有
+    pthread_mutex_lock(&recursive_mutex);
+    pthread_mutex_lock(&recursive_mutex);
+    pthread_mutex_unlock(&recursive_mutex);
+    std::cout << "[Main] Recursive mutex locked twice, unlocked once (should still be held):\n";
+    detector.print_status();
+    AsyncReporter::instance().flush();
+    pthread_mutex_unlock(&recursive_mutex);
+    
+    // 检错锁：重复加锁返回 EDEADLK，解锁未持有的锁返回 EPERM
+    pthread_mutex_lock(&errorcheck_mutex);
+    int rc = pthread_mutex_lock(&errorcheck_mutex);
+    std::cout << "[Main] Error-checking mutex relock returned " << (rc == EDEADLK ? "EDEADLK" : "unexpected")
+              << "\n";
+    pthread_mutex_unlock(&errorcheck_mutex);
+    rc = pthread_mutex_unlock(&errorcheck_mutex);
+    std::cout << "[Main] Error-checking mutex extra unlock returned " << (rc == EPERM ? "EPERM" : "unexpected")
+              << "\n";
+    
+    // 普通锁 + timedlock：只会超时，检测器只给出警告
+    detector.start(1);
+    pthread_mutex_lock(&mutex2);
+    std::cout << "[Main] Relocking mutex2 with timedlock (2 second timeout)...\n";
+    struct timespec ts = deadline_after(2);
+    if (pthread_mutex_timedlock(&mutex2, &ts) == ETIMEDOUT) {
+        std::cout << "[Main] Timed out\n";
+    }
+    pthread_mutex_unlock(&mutex2);
+    AsyncReporter::instance().flush();
+    DetectorStats st = detector.stats();
+    std::cout << "[Main] After the timedlock relock: " << st.deadlocks_found << " deadlock(s), "
+              << st.self_deadlocks << " self-deadlock(s) (expected 0 and 0)\n";
+    
+    // 普通锁 + lock：永远阻塞，钩子在阻塞前立即报告
+    pthread_t self_locker;
+    pthread_create(&self_locker, nullptr, self_deadlock_thread, nullptr);
+    pthread_detach(self_locker);
+    sleep(2);
+    detector.stop();
+    detector.print_status();
+}
+
+// ============================================
+// 测试16：互斥锁生命周期（init / destroy）
+// 大量短命的堆上互斥锁反复创建销毁（分配器会复用地址），
+// 检测器状态和竞争统计不应随之增长；绕过包装的解锁在 destroy 时被发现并清除
+// ============================================
+struct HeapLock {
+    pthread_mutex_t mutex;
+};
+
+void* lifetime_churn_thread(void* arg) {
+    (void)arg;
+    for (int i = 0; i < 20000; i++) {
+        HeapLock* lock = new HeapLock;
+        pthread_mutex_init(&lock->mutex, nullptr);
+        pthread_mutex_lock(&lock->mutex);
+        pthread_mutex_unlock(&lock->mutex);
+        pthread_mutex_destroy(&lock->mutex);
+        delete lock;
+    }
+    return nullptr;
+}
+
+void test_mutex_lifetime() {
+    std::cout << "\n╔═════════════════════════════════════════╗\n";
+    std::cout << "║  Test 16: Mutex init / destroy         ║\n";
+    std::cout << "╚═════════════════════════════════════════╝\n\n";
+    
+    DeadlockDetector& detector = DeadlockDetector::instance();
+    detector.profiler().set_enabled(true);
+    
+    pthread_t threads[4];
+    for (int i = 0; i < 4; i++) {
+        pthread_create(&threads[i], nullptr, lifetime_churn_thread, nullptr);
+    }
+    for (int i = 0; i < 4; i++) {
+        pthread_join(threads[i], nullptr);
+    }
+    DetectorStats st = detector.stats();
+    std::cout << "[Main] " << st.mutex_inits << " mutexes initialized, " << st.mutex_destroys << " destroyed, "
+              << st.live_mutexes << " live (should be 0)\n";
+    std::cout << "[Main] Locks in contention profile: " << detector.profiler().snapshot().size()
+              << " (should be 0)\n";
+    detector.profiler().set_enabled(false);
+    
+    // 同一地址上的两把锁：代号不同，第一把锁绕过包装的解锁在销毁时被清除
+    HeapLock* lock = new HeapLock;
+    pthread_mutex_init(&lock->mutex, nullptr);
+    uint64_t addr = reinterpret_cast<uint64_t>(&lock->mutex);
+    detector.hold_time().set_lock_budget_ns(addr, 1000000);
+    std::cout << "[Main] First lock generation: " << detector.lock_generation(addr) << "\n";
+    pthread_mutex_lock(&lock->mutex);
+    (pthread_mutex_unlock)(&lock->mutex);   // 未经包装：检测器仍认为它被持有
+    pthread_mutex_destroy(&lock->mutex);
+    AsyncReporter::instance().flush();
+    std::cout << "[Main] Budget after destroy: " << detector.hold_time().budget_for(addr) << " ns (should be 0)\n";
+    
+    pthread_mutex_init(&lock->mutex, nullptr);
+    std::cout << "[Main] Second lock at the same address, generation: " << detector.lock_generation(addr) << "\n";
+    pthread_mutex_lock(&lock->mutex);
+    detector.print_status();
+    AsyncReporter::instance().flush();
+    pthread_mutex_unlock(&lock->mutex);
+    pthread_mutex_destroy(&lock->mutex);
+    delete lock;
+}
+
+// ============================================
+// 测试17：线程退出清理
+// 成批创建大量短命线程，注册表只保留存活线程（序号被复用）；
+// 退出时仍持有锁的线程给出泄漏警告，持有记录被丢弃；
+// 线程用过的 3000 把从不销毁的锁并入"已退出线程"汇总，汇总条目数有上限
+// ============================================
+pthread_mutex_t leaked_mutex = PTHREAD_MUTEX_INITIALIZER;
+pthread_rwlock_t leaked_rwlock = PTHREAD_RWLOCK_INITIALIZER;
+pthread_mutex_t never_destroyed[3000];   // 全零即 PTHREAD_MUTEX_INITIALIZER（glibc）
+
+void* short_lived_thread(void* arg) {
+    size_t index = static_cast<size_t>(reinterpret_cast<intptr_t>(arg)) % 3000;
+    pthread_mutex_lock(&mutex1);
+    pthread_mutex_unlock(&mutex1);
+    pthread_mutex_lock(&never_destroyed[index]);
+    pthread_mutex_unlock(&never_destroyed[index]);
+    return nullptr;
+}
+
+void* leaking_thread(void* arg) {
+    (void)arg;
+    pthread_mutex_lock(&leaked_mutex);
+    pthread_rwlock_rdlock(&leaked_rwlock);
+    return nullptr;   // 两把锁都没有释放
+}
+
+void test_thread_exit() {
+    std::cout << "\n╔═════════════════════════════════════════╗\n";
+    std::cout << "║  Test 17: Thread exit cleanup          ║\n";
+    std::cout << "╚═════════════════════════════════════════╝\n\n";
+    
+    DeadlockDetector& detector = DeadlockDetector::instance();
+    detector.profiler().set_enabled(true);
+    
+    pthread_t threads[100];
+    for (int round = 0; round < 50; round++) {
+        for (int i = 0; i < 100; i++) {
+            pthread_create(&threads[i], nullptr, short_lived_thread,
+                           reinterpret_cast<void*>(static_cast<intptr_t>(round * 100 + i)));
+        }
+        for (int i = 0; i < 100; i++) {
+            pthread_join(threads[i], nullptr);
+        }
+    }
+    DetectorStats st = detector.stats();
+    std::cout << "[Main] 5000 threads created, " << st.thread_exits << " exited, "
+              << st.registered_threads << " still registered (only live threads)\n";
+    std::vector<LockContentionStats> profile = detector.profiler().snapshot();
+    std::cout << "[Main] Locks in contention profile: " << profile.size()
+              << " (3001 used, at most " << ContentionProfiler::kMaxRetiredLocks + 1 << " kept)\n";
+    for (size_t i = 0; i < profile.size(); i++) {
+        if (profile[i].key == reinterpret_cast<uint64_t>(&mutex1)) {
+            std::cout << "[Main] mutex1 acquisitions kept after exit: " << profile[i].acquisitions << "\n";
+        } else if (profile[i].key == 0) {
+            std::cout << "[Main] Evicted locks folded into (other locks): " << profile[i].acquisitions
+                      << " acquisitions\n";
+        }
+    }
+    detector.profiler().set_enabled(false);
+    
+    pthread_t leaker;
+    pthread_create(&leaker, nullptr, leaking_thread, nullptr);
+    pthread_join(leaker, nullptr);
+    AsyncReporter::instance().flush();
+    std::cout << "[Main] After the leaking thread exited (no owners, no readers expected):\n";
+    detector.print_status();
+}
+
+// ============================================
+// 测试18：自适应检测间隔
+// 空闲时间隔指数退避；出现等待后不再退避，并在最久的等待
+// 接近 long_wait_ms 时提前检测；变成长等待后收紧到下限；释放后再次退避
+// ============================================
+void* pressure_holder_thread(void* arg) {
+    (void)arg;
+    pthread_mutex_lock(&mutex1);
+    usleep(2000000); // 采样期间不打印，避免打乱采样行
+    pthread_mutex_unlock(&mutex1);
+    return nullptr;
+}
+
+void* pressure_waiter_thread(void* arg) {
+    (void)arg;
+    usleep(50000); // 让持有者先拿到锁
+    pthread_mutex_lock(&mutex1);
+    pthread_mutex_unlock(&mutex1);
+    return nullptr;
+}
+
+// 每 100ms 采样一次当前间隔
+void sample_intervals(const char* phase, int samples) {
+    std::cout << "[Main] " << phase << " interval (ms):";
+    for (int i = 0; i < samples; i++) {
+        usleep(100000);
+        std::cout << " " << DeadlockDetector::instance().current_interval_ms();
+    }
+    std::cout << "\n";
+}
+
+void test_adaptive_interval() {
+    std::cout << "\n╔═════════════════════════════════════════╗\n";
+    std::cout << "║  Test 18: Adaptive detection interval  ║\n";
+    std::cout << "╚═════════════════════════════════════════╝\n\n";
+    
+    AdaptiveIntervalConfig config;
+    config.min_interval_ms = 20;
+    config.max_interval_ms = 800;
+    config.long_wait_ms = 600;
+    config.cpu_budget = 0; // 关闭 CPU 预算下限，只看等待压力
+    DeadlockDetector& detector = DeadlockDetector::instance();
+    detector.set_adaptive(config);
+    detector.start();
+    
+    sample_intervals("Idle    ", 15);
+    
+    pthread_t holder, waiter;
+    pthread_create(&holder, nullptr, pressure_holder_thread, nullptr);
+    pthread_create(&waiter, nullptr, pressure_waiter_thread, nullptr);
+    std::cout << "[Main] Holder keeps mutex1 for 2 s, waiter blocks on it (long_wait_ms = 600)\n";
+    sample_intervals("Pressure", 20);
+    
+    pthread_join(holder, nullptr);
+    pthread_join(waiter, nullptr);
+    sample_intervals("Idle    ", 15);
+    
+    detector.stop();
+}
+
+// ============================================
+// 测试19：持锁时长预算
+// 优先级：单锁预算 > 类别预算 > 默认预算。
+//   budget_a：单锁预算 20ms，持有 40ms  → 超预算
+//   budget_b：类别 3（50ms），持有 80ms → 超预算
+//   budget_c：类别 3，但单锁预算 1s 优先，持有 80ms → 不超
+//   mutex1：只有默认预算 500ms，持有 100ms → 不超
+// 之前先对 20000 个地址反复设置、删除单锁预算（模拟锁的创建/销毁），
+// 预算表里的墓碑不应让未命中的查找变慢
+// ============================================
+pthread_mutex_t budget_a = PTHREAD_MUTEX_INITIALIZER;
+pthread_mutex_t budget_b = PTHREAD_MUTEX_INITIALIZER;
+pthread_mutex_t budget_c = PTHREAD_MUTEX_INITIALIZER;
+
+static void hold_for_ms(pthread_mutex_t* mutex, int ms) {
+    pthread_mutex_lock(mutex);
+    usleep(ms * 1000);
+    pthread_mutex_unlock(mutex);
+}
+
+void test_hold_budgets() {
+    std::cout << "\n╔═════════════════════════════════════════╗\n";
+    std::cout << "║  Test 19: Hold-Time Budgets            ║\n";
+    std::cout << "╚═════════════════════════════════════════╝\n\n";
+    
+    HoldTimeTracker& budgets = DeadlockDetector::instance().hold_time();
+    
+    // 预算表容量 4096：20000 次插入 / 删除留下大量墓碑
+    for (uint64_t i = 0; i < 20000; i++) {
+        uint64_t addr = 0x10000000ull + i * 64;
+        budgets.set_lock_budget_ns(addr, 1000000);
+        budgets.set_lock_budget_ns(addr, 0);
+    }
+    uint64_t begin = precise_now_ns();
+    uint64_t sum = 0;
+    for (uint64_t i = 0; i < 100000; i++) {
+        sum += budgets.budget_for(0x20000000ull + i * 64);
+    }
+    uint64_t per_lookup = (precise_now_ns() - begin) / 100000;
+    std::cout << "[Main] After 20000 budget set/erase cycles, a missing lookup takes " << per_lookup
+              << " ns (sum " << sum << ")\n";
+    
+    uint64_t a = reinterpret_cast<uint64_t>(&budget_a);
+    uint64_t b = reinterpret_cast<uint64_t>(&budget_b);
+    uint64_t c = reinterpret_cast<uint64_t>(&budget_c);
+    budgets.set_default_budget_ns(500000000ull);
+    budgets.set_lock_budget_ns(a, 20000000ull);
+    budgets.set_lock_class(b, 3);
+    budgets.set_lock_class(c, 3);
+    budgets.set_class_budget_ns(3, 50000000ull);
+    budgets.set_lock_budget_ns(c, 1000000000ull);
+    
+    uint64_t before = budgets.violation_count();
+    hold_for_ms(&budget_a, 40);
+    hold_for_ms(&budget_b, 80);
+    hold_for_ms(&budget_c, 80);
+    hold_for_ms(&mutex1, 100);
+    
+    std::vector<HoldViolation> violations = budgets.recent_violations();
+    std::cout << "[Main] " << budgets.violation_count() - before << " violation(s) (expected 2: budget_a, budget_b)\n";
+    for (size_t i = 0; i < violations.size(); i++) {
+        const char* name = violations[i].lock_addr == a ? "budget_a"
+                         : violations[i].lock_addr == b ? "budget_b"
+                         : violations[i].lock_addr == c ? "budget_c" : "other";
+        std::cout << "  " << name << " held " << violations[i].hold_ns / 1000000 << " ms, budget "
+                  << violations[i].budget_ns / 1000000 << " ms, at " << violations[i].site << "\n";
+    }
+    
+    budgets.set_lock_budget_ns(a, 0);
+    budgets.set_lock_budget_ns(c, 0);
+    budgets.set_class_budget_ns(3, 0);
+    budgets.set_default_budget_ns(0);
+}
+
+// ============================================
+// 测试20：离线工具
+// 写一份已知内容的追踪，再用同目录下的 ddtrace / ddstat 检查输出：
+//   order_p / order_q：两个并发线程以相反顺序加锁       → 1 个潜在死锁
+//   guarded_r / guarded_s：相反顺序，但都在 guard_g 之内 → 1 个 guarded
+//   hb_x / hb_y：主线程先 X→Y，之后创建的线程 Y→X       → 1 个 happens-before ordered
+// 没有真正的死锁：analyze 应报告 0 个；chrome 应输出持有区间。
+// ddstat 读取本进程发布的统计段，应认出本进程的 pid
+// ============================================
+pthread_mutex_t order_p = PTHREAD_MUTEX_INITIALIZER;
+pthread_mutex_t order_q = PTHREAD_MUTEX_INITIALIZER;
+pthread_mutex_t guard_g = PTHREAD_MUTEX_INITIALIZER;
+pthread_mutex_t guarded_r = PTHREAD_MUTEX_INITIALIZER;
+pthread_mutex_t guarded_s = PTHREAD_MUTEX_INITIALIZER;
+pthread_mutex_t hb_x = PTHREAD_MUTEX_INITIALIZER;
+pthread_mutex_t hb_y = PTHREAD_MUTEX_INITIALIZER;
+
+static void lock_pair(pthread_mutex_t* first, pthread_mutex_t* second) {
+    pthread_mutex_lock(first);
+    pthread_mutex_lock(second);
+    pthread_mutex_unlock(second);
+    pthread_mutex_unlock(first);
+}
+
+void* order_pq_thread(void* arg) {
+    (void)arg;
+    lock_pair(&order_p, &order_q);
+    return nullptr;
+}
+
+void* order_qp_thread(void* arg) {
+    (void)arg;
+    usleep(100 * 1000);   // 错开执行，本次运行不会真的死锁
+    lock_pair(&order_q, &order_p);
+    return nullptr;
+}
+
+void* guarded_thread(void* arg) {
+    bool reverse = arg != nullptr;
+    if (reverse) {
+        usleep(100 * 1000);
+    }
+    pthread_mutex_lock(&guard_g);
+    if (reverse) {
+        lock_pair(&guarded_s, &guarded_r);
+    } else {
+        lock_pair(&guarded_r, &guarded_s);
+    }
+    pthread_mutex_unlock(&guard_g);
+    return nullptr;
+}
+
+void* hb_thread(void* arg) {
+    (void)arg;
+    lock_pair(&hb_y, &hb_x);
+    return nullptr;
+}
+
+// 与 test_background 同目录的工具
+static std::string tool_path(const char* name) {
+    char exe[1024];
+    ssize_t n = readlink("/proc/self/exe", exe, sizeof(exe) - 1);
+    if (n <= 0) {
+        return name;
+    }
+    exe[n] = '\0';
+    std::string dir(exe);
+    return dir.substr(0, dir.rfind('/') + 1) + name;
+}
+
+// 运行命令，返回全部标准输出
+static std::string run_tool(const std::string& command) {
+    std::string output;
+    FILE* pipe = popen(command.c_str(), "r");
+    if (!pipe) {
+        return output;
+    }
+    char buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), pipe)) > 0) {
+        output.append(buf, n);
+    }
+    pclose(pipe);
+    return output;
+}
+
+static size_t count_of(const std::string& text, const char* needle) {
+    size_t count = 0;
+    for (size_t pos = text.find(needle); pos != std::string::npos; pos = text.find(needle, pos + 1)) {
+        count++;
+    }
+    return count;
+}
+
+static const char* check(bool ok) {
+    return ok ? "OK" : "FAILED";
+}
+
+void test_offline_tools() {
+    std::cout << "\n╔═════════════════════════════════════════╗\n";
+    std::cout << "║  Test 20: ddtrace and ddstat           ║\n";
+    std::cout << "╚═════════════════════════════════════════╝\n\n";
+    
+    DeadlockDetector& detector = DeadlockDetector::instance();
+    TraceConfig config;
+    config.path = "/tmp/deadlock_tools_trace.bin";
+    config.max_threads = 16;
+    config.events_per_thread = 1024;
+    if (!detector.trace().open(config)) {
+        std::cout << "[Main] Failed to open " << config.path << "\n";
+        return;
+    }
+    
+    lock_pair(&hb_x, &hb_y);   // 先于 hb_thread 的创建
+    pthread_t threads[5];
+    pthread_create(&threads[0], nullptr, hb_thread, nullptr);
+    pthread_create(&threads[1], nullptr, order_pq_thread, nullptr);
+    pthread_create(&threads[2], nullptr, order_qp_thread, nullptr);
+    pthread_create(&threads[3], nullptr, guarded_thread, nullptr);
+    pthread_create(&threads[4], nullptr, guarded_thread, &threads[4]);
+    for (int i = 0; i < 5; i++) {
+        pthread_join(threads[i], nullptr);
+    }
+    detector.trace().close();
+    
+    std::string ddtrace = tool_path("ddtrace");
+    std::string predict = run_tool(ddtrace + " predict " + config.path);
+    unsigned long long single = 0, guarded = 0, ordered = 0;
+    size_t potential = 0;
+    const char* summary = strstr(predict.c_str(), "lock cycle(s): ");
+    if (summary) {
+        sscanf(summary, "lock cycle(s): %zu potential deadlock(s), %llu single-thread, %llu guarded, "
+                        "%llu happens-before ordered", &potential, &single, &guarded, &ordered);
+    }
+    std::cout << "[Main] ddtrace predict: " << potential << " potential, " << guarded << " guarded, "
+              << ordered << " happens-before ordered, " << single << " single-thread (expected 1/1/1/0) "
+              << check(potential == 1 && guarded == 1 && ordered == 1 && single == 0) << "\n";
+    
+    std::string analyze = run_tool(ddtrace + " analyze " + config.path);
+    bool no_deadlock = analyze.find("wait-for detection: ") != std::string::npos &&
+                       count_of(analyze, ", 0 deadlock(s)\n") == 1;
+    std::cout << "[Main] ddtrace analyze: no deadlock replayed (expected, the run never blocked) "
+              << check(no_deadlock) << "\n";
+    
+    std::string chrome = run_tool(ddtrace + " chrome " + config.path);
+    size_t spans = count_of(chrome, "\"ph\":\"X\"");
+    size_t holds = count_of(chrome, "\"cat\":\"hold\"");
+    std::cout << "[Main] ddtrace chrome: " << spans << " span(s), " << holds << " hold span(s) (expected at least 14) "
+              << check(holds >= 14) << "\n";
+    
+    if (!detector.publish_stats()) {
+        std::cout << "[Main] Failed to publish the stats segment\n";
+        return;
+    }
+    detector.check_deadlock();   // 检测一轮，计数器随之发布
+    std::string ddstat = run_tool(tool_path("ddstat") + " -n " + detector.stats_segment_name());
+    char expected[64];
+    snprintf(expected, sizeof(expected), "pid %u,", static_cast<unsigned>(getpid()));
+    unsigned long long passes = 0, found = 0;
+    const char* detection = strstr(ddstat.c_str(), "detection: ");
+    if (detection) {
+        sscanf(detection, "detection: %llu passes, %llu deadlock(s)", &passes, &found);
+    }
+    bool stat_ok = ddstat.compare(0, strlen(expected), expected) == 0 && passes >= 1 && found == 0;
+    std::cout << "[Main] ddstat: " << passes << " detection pass(es), " << found
+              << " deadlock(s) for this pid (expected >= 1 / 0) " << check(stat_ok) << "\n";
+    detector.unpublish_stats();
+}
+
 // ============================================
 // 主函数
 // ============================================
@@ -179,6 +1486,23 @@ int main(int argc, char* argv[]) {
         std::cout << "  1 - Auto detection (immediate deadlock)\n";
         std::cout << "  2 - Delayed deadlock\n";
         std::cout << "  3 - No false positive\n";
+        std::cout << "  4 - Event loop integration (no detector thread)\n";
+        std::cout << "  5 - Long wait watchdog\n";
+        std::cout << "  6 - Lock contention profile\n";
+        std::cout << "  7 - Lock event trace recorder\n";
+        std::cout << "  8 - trylock / timedlock (deadlock broken by timeout)\n";
+        std::cout << "  9 - Reader-writer lock (writer waiting on readers)\n";
+        std::cout << " 10 - TrackedMutex C++ wrappers (inline owner)\n";
+        std::cout << " 11 - Condition variable waits\n";
+        std::cout << " 12 - Join and thread pool waits (thread-to-thread edges)\n";
+        std::cout << " 13 - Semaphores and barriers (resource-allocation graph)\n";
+        std::cout << " 14 - Spinlocks (spin wait threshold, CPU burnt spinning)\n";
+        std::cout << " 15 - Recursive / error-checking mutexes and self-deadlock\n";
+        std::cout << " 16 - Mutex init / destroy (lock lifetime, address reuse)\n";
+        std::cout << " 17 - Thread exit cleanup (thread churn, locks leaked at exit)\n";
+        std::cout << " 18 - Adaptive detection interval (shrinks under pressure, grows when idle)\n";
+        std::cout << " 19 - Hold-time budgets (per-lock, per-class, default; budget table churn)\n";
+        std::cout << " 20 - ddtrace analyze / predict / chrome and ddstat on a known trace\n";
         return 1;
     }
     
@@ -194,6 +1518,57 @@ int main(int argc, char* argv[]) {
         case 3:
             test_no_false_positive();
             break;
+        case 4:
+            test_event_loop();
+            break;
+        case 5:
+            test_long_wait_watchdog();
+            break;
+        case 6:
+            test_contention_profile();
+            break;
+        case 7:
+            test_trace_recorder();
+            break;
+        case 8:
+            test_trylock_timedlock();
+            break;
+        case 9:
+            test_rwlock();
+            break;
+        case 10:
+            test_tracked_mutex();
+            break;
+        case 11:
+            test_cond_wait();
+            break;
+        case 12:
+            test_thread_waits();
+            break;
+        case 13:
+            test_semaphore_barrier();
+            break;
+        case 14:
+            test_spinlock();
+            break;
+        case 15:
+            test_mutex_kinds();
+            break;
+        case 16:
+            test_mutex_lifetime();
+            break;
+        case 17:
+            test_thread_exit();
+            break;
+        case 18:
+            test_adaptive_interval();
+            break;
+        case 19:
+            test_hold_budgets();
+            break;
+        case 20:
+            test_offline_tools();
+            break;
         default:
             std::cout << "Invalid test number!\n";
             return 1;
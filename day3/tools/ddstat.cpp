@@ -0,0 +1,165 @@
+// ============================================
+// ddstat：从另一个进程查看死锁检测器的实时状态
+// 只读映射目标进程发布的共享内存统计段（DeadlockDetector::publish_stats），
+// 不 attach、不发信号、不取目标进程的任何锁。
+//
+// 用法：
+//   ddstat -p <pid> | -n <segment>              打印一份完整报告
+//   ddstat -p <pid> | -n <segment> <秒> [次数]  类似 vmstat，按间隔输出一行
+//
+// 计数器只在检测器每轮发布时更新（自适应间隔下可能几秒一次），
+// 所以速率按两次发布之间的时间计算，采样期间没有新发布时不输出新行。
+// ============================================
+#include "stats_segment.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <ctime>
+#include <string>
+
+static void usage(const char* prog) {
+    fprintf(stderr,
+            "usage: %s (-p pid | -n segment) [interval_s [count]]\n"
+            "  without an interval, print one full report (counters, wait edges,\n"
+            "  oldest waits, recent deadlocks) and exit\n",
+            prog);
+}
+
+static void print_report(const StatsSnapshot& s, bool alive) {
+    const uint64_t* c = s.counters;
+    printf("pid %u%s, %llu publications, last at %llu\n", s.pid, alive ? "" : " (exited)",
+           static_cast<unsigned long long>(s.publish_count),
+           static_cast<unsigned long long>(s.publish_wall_s));
+    printf("hooks:     %llu lock, %llu acquired, %llu unlock, %llu contended\n",
+           static_cast<unsigned long long>(c[SEG_LOCK_BEFORE]),
+           static_cast<unsigned long long>(c[SEG_LOCK_AFTER]),
+           static_cast<unsigned long long>(c[SEG_UNLOCK]),
+           static_cast<unsigned long long>(c[SEG_CONTENDED]));
+    printf("detection: %llu passes, %llu deadlock(s), interval %llu ms, scan last %llu us / max %llu us\n",
+           static_cast<unsigned long long>(c[SEG_DETECTIONS]),
+           static_cast<unsigned long long>(c[SEG_DEADLOCKS]),
+           static_cast<unsigned long long>(c[SEG_INTERVAL_MS]),
+           static_cast<unsigned long long>(c[SEG_LAST_SCAN_NS] / 1000),
+           static_cast<unsigned long long>(c[SEG_MAX_SCAN_NS] / 1000));
+    printf("snapshot:  %llu held lock(s), %llu waiting thread(s), graph %llu nodes / %llu edges, "
+           "%llu threads registered, %llu reports dropped\n",
+           static_cast<unsigned long long>(c[SEG_LOCK_OWNERS]),
+           static_cast<unsigned long long>(c[SEG_WAITING_THREADS]),
+           static_cast<unsigned long long>(c[SEG_GRAPH_NODES]),
+           static_cast<unsigned long long>(c[SEG_GRAPH_EDGES]),
+           static_cast<unsigned long long>(c[SEG_REGISTERED_THREADS]),
+           static_cast<unsigned long long>(c[SEG_REPORTS_DROPPED]));
+
+    printf("\nwait-for edges (%zu of %llu):\n", s.edges.size(),
+           static_cast<unsigned long long>(s.edge_total));
+    for (size_t i = 0; i < s.edges.size(); i++) {
+        const LiveWait& w = s.edges[i];
+        printf("  thread %llu -> lock 0x%llx -> thread %llu\n",
+               static_cast<unsigned long long>(w.thread_id),
+               static_cast<unsigned long long>(w.lock_addr),
+               static_cast<unsigned long long>(w.owner_thread));
+    }
+
+    printf("\noldest waits:\n");
+    for (size_t i = 0; i < s.oldest.size(); i++) {
+        const LiveWait& w = s.oldest[i];
+        printf("  thread %llu waiting %.3f s for lock 0x%llx", static_cast<unsigned long long>(w.thread_id),
+               static_cast<double>(w.waited_ns) / 1e9, static_cast<unsigned long long>(w.lock_addr));
+        if (w.owner_thread) {
+            printf(" (held by thread %llu)\n", static_cast<unsigned long long>(w.owner_thread));
+        } else {
+            printf(" (no recorded holder)\n");
+        }
+    }
+
+    printf("\nrecent deadlocks (%llu total):\n", static_cast<unsigned long long>(s.detection_total));
+    for (size_t i = 0; i < s.detections.size(); i++) {
+        const LiveDetection& d = s.detections[i];
+        printf("  at %llu: %llu thread(s):", static_cast<unsigned long long>(d.wall_time_s),
+               static_cast<unsigned long long>(d.thread_count));
+        for (size_t t = 0; t < d.threads.size(); t++) {
+            printf(" %llu", static_cast<unsigned long long>(d.threads[t]));
+        }
+        printf("%s\n", d.thread_count > d.threads.size() ? " ..." : "");
+    }
+}
+
+static void print_header() {
+    printf("%10s %10s %10s %7s %7s %7s %7s %9s %9s %5s\n",
+           "acq/s", "unlock/s", "contend/s", "held", "wait", "nodes", "edges",
+           "scan_us", "maxscan", "dlk");
+}
+
+static void print_line(const StatsSnapshot& prev, const StatsSnapshot& cur, double seconds) {
+    const uint64_t* p = prev.counters;
+    const uint64_t* c = cur.counters;
+    printf("%10.0f %10.0f %10.0f %7llu %7llu %7llu %7llu %9llu %9llu %5llu\n",
+           (c[SEG_LOCK_AFTER] - p[SEG_LOCK_AFTER]) / seconds,
+           (c[SEG_UNLOCK] - p[SEG_UNLOCK]) / seconds,
+           (c[SEG_CONTENDED] - p[SEG_CONTENDED]) / seconds,
+           static_cast<unsigned long long>(c[SEG_LOCK_OWNERS]),
+           static_cast<unsigned long long>(c[SEG_WAITING_THREADS]),
+           static_cast<unsigned long long>(c[SEG_GRAPH_NODES]),
+           static_cast<unsigned long long>(c[SEG_GRAPH_EDGES]),
+           static_cast<unsigned long long>(c[SEG_LAST_SCAN_NS] / 1000),
+           static_cast<unsigned long long>(c[SEG_MAX_SCAN_NS] / 1000),
+           static_cast<unsigned long long>(c[SEG_DEADLOCKS]));
+    fflush(stdout);
+}
+
+int main(int argc, char* argv[]) {
+    std::string name;
+    int opt;
+    while ((opt = getopt(argc, argv, "p:n:h")) != -1) {
+        switch (opt) {
+            case 'p': name = default_stats_segment_name(static_cast<uint32_t>(atoi(optarg))); break;
+            case 'n': name = optarg; break;
+            default: usage(argv[0]); return opt == 'h' ? 0 : 2;
+        }
+    }
+    if (name.empty()) {
+        usage(argv[0]);
+        return 2;
+    }
+    int interval_s = optind < argc ? atoi(argv[optind]) : 0;
+    long count = optind + 1 < argc ? atol(argv[optind + 1]) : -1;
+
+    StatsSegmentReader reader;
+    if (!reader.open(name)) {
+        fprintf(stderr, "ddstat: %s\n", reader.error().c_str());
+        return 1;
+    }
+
+    StatsSnapshot prev;
+    if (!reader.read(prev)) {
+        fprintf(stderr, "ddstat: segment is being written continuously, giving up\n");
+        return 1;
+    }
+    if (interval_s <= 0) {
+        print_report(prev, reader.owner_alive());
+        return 0;
+    }
+
+    // 第一行与 vmstat 一样是自发布以来的平均值（以段创建时间为起点）
+    print_header();
+    uint64_t since = prev.publish_wall_s > prev.created_wall_s ? prev.publish_wall_s - prev.created_wall_s : 1;
+    StatsSnapshot zero = prev;
+    memset(zero.counters, 0, sizeof(zero.counters));
+    print_line(zero, prev, static_cast<double>(since));
+
+    for (long n = 1; count < 0 || n < count; n++) {
+        sleep(static_cast<unsigned>(interval_s));
+        StatsSnapshot cur;
+        if (reader.read(cur) && cur.publish_count != prev.publish_count &&
+            cur.publish_wall_ns > prev.publish_wall_ns) {
+            print_line(prev, cur, static_cast<double>(cur.publish_wall_ns - prev.publish_wall_ns) / 1e9);
+            prev = cur;
+        }
+        if (!reader.owner_alive()) {
+            fprintf(stderr, "ddstat: process %u has exited\n", prev.pid);
+            break;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,49 @@
+#ifndef DDTRACE_H
+#define DDTRACE_H
+
+#include <stddef.h>
+#include <atomic>
+#include <functional>
+#include <thread>
+#include <vector>
+
+// ============================================
+// ddtrace 子命令（每个子命令一个源文件）
+// ============================================
+int run_analyze(int argc, char* argv[]);
+int run_chrome(int argc, char* argv[]);
+int run_predict(int argc, char* argv[]);
+
+// ============================================
+// 公共工具
+// ============================================
+
+// 用 jobs 个线程并行执行 func(0) ... func(n-1)；任务顺序不确定
+inline void parallel_for(size_t n, unsigned jobs, const std::function<void(size_t)>& func) {
+    if (jobs <= 1 || n <= 1) {
+        for (size_t i = 0; i < n; i++) {
+            func(i);
+        }
+        return;
+    }
+    std::atomic<size_t> next(0);
+    std::vector<std::thread> workers;
+    for (unsigned j = 0; j < jobs && j < n; j++) {
+        workers.push_back(std::thread([&] {
+            for (size_t i = next.fetch_add(1); i < n; i = next.fetch_add(1)) {
+                func(i);
+            }
+        }));
+    }
+    for (size_t j = 0; j < workers.size(); j++) {
+        workers[j].join();
+    }
+}
+
+// 默认并行度
+inline unsigned default_jobs() {
+    unsigned n = std::thread::hardware_concurrency();
+    return n ? n : 4;
+}
+
+#endif // DDTRACE_H
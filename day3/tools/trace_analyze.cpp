@@ -0,0 +1,540 @@
+// ============================================
+// ddtrace analyze：离线回放 + 锁统计
+//
+// 1. 锁统计：每个环（线程）独立解码，before→after 为等待时长，after→unlock 为持有时长，
+//    所有环并行处理后合并。
+// 2. 死锁检测：按与 on_lock_before / on_lock_after / on_unlock_after 相同的状态转换
+//    重建 lock_owners / thread_waiting，在检查点上用 DirectedGraph 判环。
+//    检查点模式下各环按时间片批量推进：同一把锁的 unlock 只在持有者匹配时才清除，
+//    所以片内跨环的先后顺序不影响检查点时刻的状态。
+//    --every-event 模式按时间戳全局归并，在每个 before 事件后检查。
+// ============================================
+#include "ddtrace.h"
+#include "trace_reader.h"
+#include "graph.h"
+#include "contention_profiler.h"
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct AnalyzeOptions {
+    bool every_event;
+    uint64_t interval_ms;        // 检查点间隔（追踪时间）
+    unsigned jobs;
+    size_t top;
+    uint64_t contended_ns;
+
+    AnalyzeOptions() : every_event(false), interval_ms(100), jobs(default_jobs()), top(10), contended_ns(1000) {}
+};
+
+// ============================================
+// 单环统计
+// ============================================
+struct RingStats {
+    uint64_t events;
+    uint64_t unmatched;                                   // 找不到配对 after 的 unlock
+    uint64_t first_ticks;
+    uint64_t last_ticks;
+    std::set<uint64_t> threads;
+    std::unordered_map<uint64_t, LockContentionStats> locks;
+    std::unordered_map<uint64_t, uint32_t> lock_sites;    // 锁 → 第一次获取的位置
+
+    RingStats() : events(0), unmatched(0), first_ticks(0), last_ticks(0) {}
+};
+
+static void analyze_ring(const TraceReader& reader, uint32_t ring, const AnalyzeOptions& opt, RingStats& out) {
+    TraceRingView view = reader.ring(ring);
+    if (view.size() == 0) {
+        return;
+    }
+    TraceRingCursor cursor(view);
+
+    // 每线程状态：至多一个进行中的等待 + 持有锁栈
+    uint64_t current_tid = 0;
+    uint64_t pending_lock = 0;
+    uint64_t pending_ticks = 0;
+    std::vector<std::pair<uint64_t, uint64_t> > held;   // (锁, 获取时刻)
+
+    // 热锁缓存：连续事件大多落在同一把锁上，省掉一次哈希查找
+    uint64_t cached_lock = 0;
+    LockContentionStats* cached = nullptr;
+    auto stats_for = [&](uint64_t lock) -> LockContentionStats& {
+        if (lock != cached_lock || !cached) {
+            cached = &out.locks[lock];
+            cached->key = lock;
+            cached_lock = lock;
+        }
+        return *cached;
+    };
+
+    const TraceEvent* ev;
+    uint64_t tid;
+    while (cursor.next(ev, tid)) {
+        if (out.events == 0) {
+            out.first_ticks = ev->ticks;
+        }
+        out.events++;
+        out.last_ticks = ev->ticks;
+        if (tid != current_tid) {
+            current_tid = tid;
+            out.threads.insert(tid);
+            pending_lock = 0;
+            held.clear();
+        }
+
+        switch (ev->kind) {
+            case TRACE_LOCK_BEFORE:
+                pending_lock = ev->lock_addr;
+                pending_ticks = ev->ticks;
+                break;
+            case TRACE_LOCK_AFTER: {
+                LockContentionStats& s = stats_for(ev->lock_addr);
+                uint64_t wait_ns = 0;
+                if (pending_lock == ev->lock_addr && ev->ticks >= pending_ticks) {
+                    wait_ns = reader.ticks_to_ns(ev->ticks - pending_ticks);
+                }
+                pending_lock = 0;
+                s.acquisitions++;
+                s.wait_total_ns += wait_ns;
+                s.max_wait_ns = std::max(s.max_wait_ns, wait_ns);
+                s.wait_hist.counts[LatencyHistogram::bucket_of(wait_ns)]++;
+                if (wait_ns >= opt.contended_ns) {
+                    s.contended++;
+                }
+                if (ev->site_id != 0) {
+                    out.lock_sites.insert(std::make_pair(ev->lock_addr, ev->site_id));
+                }
+                held.push_back(std::make_pair(ev->lock_addr, ev->ticks));
+                break;
+            }
+            case TRACE_TRYLOCK_FAIL:
+                if (pending_lock == ev->lock_addr) {
+                    pending_lock = 0;
+                }
+                break;
+            case TRACE_UNLOCK: {
+                // 通常释放的是最后获取的锁，从栈顶往下找
+                size_t i = held.size();
+                while (i > 0 && held[i - 1].first != ev->lock_addr) {
+                    i--;
+                }
+                if (i == 0) {
+                    out.unmatched++;
+                    break;
+                }
+                uint64_t acquired = held[i - 1].second;
+                held.erase(held.begin() + static_cast<long>(i - 1));
+                LockContentionStats& s = stats_for(ev->lock_addr);
+                uint64_t hold_ns = ev->ticks >= acquired ? reader.ticks_to_ns(ev->ticks - acquired) : 0;
+                s.hold_total_ns += hold_ns;
+                s.max_hold_ns = std::max(s.max_hold_ns, hold_ns);
+                s.hold_hist.counts[LatencyHistogram::bucket_of(hold_ns)]++;
+                break;
+            }
+            default:
+                break;
+        }
+    }
+}
+
+// ============================================
+// 回放：与检测器相同的状态转换
+// ============================================
+class ReplayState {
+public:
+    struct Wait {
+        uint64_t lock_addr;
+        uint64_t since_ticks;
+        uint32_t site_id;
+    };
+
+    void apply(uint64_t tid, const TraceEvent& ev) {
+        switch (ev.kind) {
+            case TRACE_LOCK_BEFORE: {
+                Wait w;
+                w.lock_addr = ev.lock_addr;
+                w.since_ticks = ev.ticks;
+                w.site_id = ev.site_id;
+                thread_waiting_[tid] = w;
+                break;
+            }
+            case TRACE_LOCK_AFTER:
+                thread_waiting_.erase(tid);
+                if (!(ev.aux & kTraceLockShared)) {
+                    lock_owners_[ev.lock_addr] = tid;   // 读锁不是独占持有者，不参与回放的等待图
+                }
+                break;
+            case TRACE_TRYLOCK_FAIL: {
+                auto it = thread_waiting_.find(tid);
+                if (it != thread_waiting_.end() && it->second.lock_addr == ev.lock_addr) {
+                    thread_waiting_.erase(it);
+                }
+                break;
+            }
+            case TRACE_UNLOCK: {
+                auto it = lock_owners_.find(ev.lock_addr);
+                if (it != lock_owners_.end() && it->second == tid) {
+                    lock_owners_.erase(it);
+                }
+                break;
+            }
+            default:
+                break;
+        }
+    }
+
+    // 与 build_waiting_graph 相同的建图方式
+    bool has_cycle() {
+        DirectedGraph graph;
+        for (const auto& pair : thread_waiting_) {
+            auto owner = lock_owners_.find(pair.second.lock_addr);
+            if (owner != lock_owners_.end()) {
+                graph.add_edge(pair.first, owner->second);
+            }
+        }
+        return graph.has_cycle();
+    }
+
+    // 从 tid 出发沿 等待 → 持有者 走；回到 tid 时返回环上的线程（每个线程至多等一把锁，出度 ≤ 1）
+    bool cycle_from(uint64_t tid, std::vector<uint64_t>& cycle) const {
+        cycle.clear();
+        uint64_t current = tid;
+        for (size_t steps = 0; steps <= thread_waiting_.size(); steps++) {
+            auto w = thread_waiting_.find(current);
+            if (w == thread_waiting_.end()) {
+                return false;
+            }
+            auto owner = lock_owners_.find(w->second.lock_addr);
+            if (owner == lock_owners_.end()) {
+                return false;
+            }
+            cycle.push_back(current);
+            current = owner->second;
+            if (current == tid) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // 所有不同的环
+    std::vector<std::vector<uint64_t> > all_cycles() const {
+        std::vector<std::vector<uint64_t> > cycles;
+        std::set<uint64_t> seen;
+        std::vector<uint64_t> cycle;
+        for (const auto& pair : thread_waiting_) {
+            if (seen.count(pair.first) || !cycle_from(pair.first, cycle)) {
+                continue;
+            }
+            seen.insert(cycle.begin(), cycle.end());
+            cycles.push_back(cycle);
+        }
+        return cycles;
+    }
+
+    const Wait* waiting(uint64_t tid) const {
+        auto it = thread_waiting_.find(tid);
+        return it == thread_waiting_.end() ? nullptr : &it->second;
+    }
+
+    uint64_t owner(uint64_t lock_addr) const {
+        auto it = lock_owners_.find(lock_addr);
+        return it == lock_owners_.end() ? 0 : it->second;
+    }
+
+private:
+    std::unordered_map<uint64_t, uint64_t> lock_owners_;
+    std::unordered_map<uint64_t, Wait> thread_waiting_;
+};
+
+static std::string format_tid(uint64_t tid) {
+    char buf[48];
+    if (TraceRingView::is_unknown_tid(tid)) {
+        snprintf(buf, sizeof(buf), "ring%u(earlier thread)", static_cast<unsigned>(tid & 0xffffffffu));
+    } else {
+        snprintf(buf, sizeof(buf), "%llu", static_cast<unsigned long long>(tid));
+    }
+    return buf;
+}
+
+struct ReplayResult {
+    std::string report;
+    uint64_t checkpoints;
+    uint64_t deadlocks;
+
+    ReplayResult() : checkpoints(0), deadlocks(0) {}
+};
+
+// 报告新出现的环（同一组线程只报告一次）
+static void report_cycles(const TraceReader& reader, const ReplayState& state, uint64_t ticks,
+                          std::set<std::vector<uint64_t> >& reported, ReplayResult& result) {
+    std::vector<std::vector<uint64_t> > cycles = state.all_cycles();
+    for (size_t c = 0; c < cycles.size(); c++) {
+        std::vector<uint64_t> key = cycles[c];
+        std::sort(key.begin(), key.end());
+        if (!reported.insert(key).second) {
+            continue;
+        }
+        result.deadlocks++;
+        char line[512];
+        snprintf(line, sizeof(line), "[Deadlock] at +%.6f s: cycle of %zu thread(s)\n",
+                 static_cast<double>(reader.to_ns(ticks)) / 1e9, cycles[c].size());
+        result.report += line;
+        for (size_t i = 0; i < cycles[c].size(); i++) {
+            uint64_t tid = cycles[c][i];
+            const ReplayState::Wait* w = state.waiting(tid);
+            snprintf(line, sizeof(line), "    thread %s waits for lock 0x%llx at %s (held by thread %s)\n",
+                     format_tid(tid).c_str(), static_cast<unsigned long long>(w->lock_addr),
+                     reader.site(w->site_id), format_tid(state.owner(w->lock_addr)).c_str());
+            result.report += line;
+        }
+    }
+}
+
+static void replay_every_event(const TraceReader& reader, ReplayResult& result) {
+    ReplayState state;
+    std::set<std::vector<uint64_t> > reported;
+    std::vector<uint64_t> cycle;
+    TraceMerger merger(reader);
+    const TraceEvent* ev;
+    uint64_t tid;
+    uint32_t ring;
+    while (merger.next(ev, tid, ring)) {
+        state.apply(tid, *ev);
+        // 只有新的等待可能闭合一个环
+        if (ev->kind == TRACE_LOCK_BEFORE) {
+            result.checkpoints++;
+            if (state.cycle_from(tid, cycle)) {
+                report_cycles(reader, state, ev->ticks, reported, result);
+            }
+        }
+    }
+}
+
+static void replay_checkpoints(const TraceReader& reader, const AnalyzeOptions& opt, ReplayResult& result) {
+    std::vector<TraceRingCursor> cursors;
+    for (uint32_t r = 0; r < reader.ring_count(); r++) {
+        TraceRingView view = reader.ring(r);
+        if (view.size() > 0) {
+            cursors.push_back(TraceRingCursor(view));
+        }
+    }
+    uint64_t step = static_cast<uint64_t>(static_cast<double>(opt.interval_ms) * 1e6 *
+                                          reader.header().ticks_per_ns);
+    if (step == 0) {
+        step = 1;
+    }
+
+    ReplayState state;
+    std::set<std::vector<uint64_t> > reported;
+    for (;;) {
+        // 下一个检查点：所有环中最早的未处理事件之后的第一个间隔边界
+        uint64_t earliest = UINT64_MAX;
+        for (size_t c = 0; c < cursors.size(); c++) {
+            uint64_t ticks;
+            if (cursors[c].peek_ticks(ticks)) {
+                earliest = std::min(earliest, ticks);
+            }
+        }
+        if (earliest == UINT64_MAX) {
+            break;
+        }
+        uint64_t checkpoint = (earliest / step + 1) * step;
+
+        for (size_t c = 0; c < cursors.size(); c++) {
+            uint64_t ticks;
+            const TraceEvent* ev;
+            uint64_t tid;
+            while (cursors[c].peek_ticks(ticks) && ticks < checkpoint) {
+                cursors[c].next(ev, tid);
+                state.apply(tid, *ev);
+            }
+        }
+        result.checkpoints++;
+        if (state.has_cycle()) {
+            report_cycles(reader, state, checkpoint, reported, result);
+        }
+    }
+}
+
+// ============================================
+// 输出
+// ============================================
+static void print_lock_table(const TraceReader& reader, std::vector<LockContentionStats>& locks,
+                             const std::unordered_map<uint64_t, uint32_t>& sites, size_t top) {
+    std::sort(locks.begin(), locks.end(), [](const LockContentionStats& a, const LockContentionStats& b) {
+        if (a.contended != b.contended) return a.contended > b.contended;
+        return a.wait_total_ns > b.wait_total_ns;
+    });
+    if (locks.size() > top) {
+        locks.resize(top);
+    }
+    printf("  %-18s %10s %10s %12s %10s %10s %10s %12s  %s\n", "lock", "acquired", "contended",
+           "wait_ms", "wait_p99", "hold_p50", "hold_p99", "max_hold_us", "site");
+    for (size_t i = 0; i < locks.size(); i++) {
+        const LockContentionStats& s = locks[i];
+        auto site = sites.find(s.key);
+        printf("  0x%-16llx %10llu %10llu %12.3f %10llu %10llu %10llu %12llu  %s\n",
+               static_cast<unsigned long long>(s.key),
+               static_cast<unsigned long long>(s.acquisitions),
+               static_cast<unsigned long long>(s.contended),
+               static_cast<double>(s.wait_total_ns) / 1e6,
+               static_cast<unsigned long long>(s.wait_hist.percentile(99)),
+               static_cast<unsigned long long>(s.hold_hist.percentile(50)),
+               static_cast<unsigned long long>(s.hold_hist.percentile(99)),
+               static_cast<unsigned long long>(s.max_hold_ns / 1000),
+               site != sites.end() ? reader.site(site->second) : "?");
+    }
+}
+
+static void analyze_usage() {
+    fprintf(stderr,
+            "usage: ddtrace analyze [options] <trace-file>...\n"
+            "  --interval-ms N    wait-for check every N ms of trace time (default 100)\n"
+            "  --every-event      check after every lock request (global timestamp merge)\n"
+            "  --jobs N           decoding threads (default: hardware concurrency)\n"
+            "  --top N            locks to list per file (default 10)\n"
+            "  --contended-ns N   waits at least this long count as contended (default 1000)\n");
+}
+
+int run_analyze(int argc, char* argv[]) {
+    AnalyzeOptions opt;
+    static const struct option long_options[] = {
+        {"interval-ms", required_argument, nullptr, 'i'},
+        {"every-event", no_argument, nullptr, 'e'},
+        {"jobs", required_argument, nullptr, 'j'},
+        {"top", required_argument, nullptr, 't'},
+        {"contended-ns", required_argument, nullptr, 'c'},
+        {"help", no_argument, nullptr, 'h'},
+        {nullptr, 0, nullptr, 0}
+    };
+    int c;
+    while ((c = getopt_long(argc, argv, "i:ej:t:c:h", long_options, nullptr)) != -1) {
+        switch (c) {
+            case 'i': opt.interval_ms = strtoull(optarg, nullptr, 10); break;
+            case 'e': opt.every_event = true; break;
+            case 'j': opt.jobs = static_cast<unsigned>(atoi(optarg)); break;
+            case 't': opt.top = static_cast<size_t>(atoi(optarg)); break;
+            case 'c': opt.contended_ns = strtoull(optarg, nullptr, 10); break;
+            default: analyze_usage(); return c == 'h' ? 0 : 2;
+        }
+    }
+    if (optind >= argc) {
+        analyze_usage();
+        return 2;
+    }
+    if (opt.interval_ms == 0) {
+        opt.interval_ms = 1;
+    }
+
+    std::vector<std::string> paths(argv + optind, argv + argc);
+    std::vector<TraceReader*> readers;
+    for (size_t f = 0; f < paths.size(); f++) {
+        TraceReader* reader = new TraceReader();
+        if (!reader->open(paths[f])) {
+            fprintf(stderr, "ddtrace: %s\n", reader->error().c_str());
+            delete reader;
+            continue;
+        }
+        readers.push_back(reader);
+    }
+    if (readers.empty()) {
+        return 1;
+    }
+
+    auto started = std::chrono::steady_clock::now();
+
+    // 阶段 1：所有文件的所有环一起并行解码
+    struct RingTask {
+        size_t file;
+        uint32_t ring;
+    };
+    std::vector<RingTask> tasks;
+    for (size_t f = 0; f < readers.size(); f++) {
+        for (uint32_t r = 0; r < readers[f]->ring_count(); r++) {
+            RingTask t = {f, r};
+            tasks.push_back(t);
+        }
+    }
+    std::vector<RingStats> ring_stats(tasks.size());
+    parallel_for(tasks.size(), opt.jobs, [&](size_t i) {
+        analyze_ring(*readers[tasks[i].file], tasks[i].ring, opt, ring_stats[i]);
+    });
+
+    // 阶段 2：每个文件一个回放任务，文件之间并行
+    std::vector<ReplayResult> replays(readers.size());
+    parallel_for(readers.size(), opt.jobs, [&](size_t f) {
+        if (opt.every_event) {
+            replay_every_event(*readers[f], replays[f]);
+        } else {
+            replay_checkpoints(*readers[f], opt, replays[f]);
+        }
+    });
+
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+    // 合并并输出
+    uint64_t total_events = 0;
+    size_t task = 0;
+    for (size_t f = 0; f < readers.size(); f++) {
+        const TraceReader& reader = *readers[f];
+        std::unordered_map<uint64_t, LockContentionStats> merged;
+        std::unordered_map<uint64_t, uint32_t> sites;
+        std::set<uint64_t> threads;
+        uint64_t events = 0, unmatched = 0, first = UINT64_MAX, last = 0;
+        for (uint32_t r = 0; r < reader.ring_count(); r++, task++) {
+            const RingStats& rs = ring_stats[task];
+            if (rs.events == 0) {
+                continue;
+            }
+            events += rs.events;
+            unmatched += rs.unmatched;
+            first = std::min(first, rs.first_ticks);
+            last = std::max(last, rs.last_ticks);
+            threads.insert(rs.threads.begin(), rs.threads.end());
+            for (const auto& pair : rs.locks) {
+                LockContentionStats& s = merged[pair.first];
+                s.key = pair.first;
+                s.merge(pair.second);
+            }
+            for (const auto& pair : rs.lock_sites) {
+                sites.insert(pair);
+            }
+        }
+        total_events += events;
+
+        printf("==== %s (pid %u) ====\n", reader.path().c_str(), reader.header().pid);
+        printf("%llu events, %zu thread(s), %zu lock(s), span %.3f s, %llu unmatched unlock(s)\n",
+               static_cast<unsigned long long>(events), threads.size(), merged.size(),
+               events ? static_cast<double>(reader.ticks_to_ns(last - first)) / 1e9 : 0.0,
+               static_cast<unsigned long long>(unmatched));
+        printf("wait-for detection: %llu check(s) %s, %llu deadlock(s)\n",
+               static_cast<unsigned long long>(replays[f].checkpoints),
+               opt.every_event ? "(every lock request)" : "(checkpoints)",
+               static_cast<unsigned long long>(replays[f].deadlocks));
+        fputs(replays[f].report.c_str(), stdout);
+
+        std::vector<LockContentionStats> locks;
+        for (const auto& pair : merged) {
+            locks.push_back(pair.second);
+        }
+        printf("top locks by contention:\n");
+        print_lock_table(reader, locks, sites, opt.top);
+        printf("\n");
+    }
+    printf("processed %llu events from %zu file(s) in %.3f s (%.1f M events/s, %u jobs)\n",
+           static_cast<unsigned long long>(total_events), readers.size(), elapsed,
+           elapsed > 0 ? static_cast<double>(total_events) / elapsed / 1e6 : 0.0, opt.jobs);
+
+    for (size_t f = 0; f < readers.size(); f++) {
+        delete readers[f];
+    }
+    return 0;
+}
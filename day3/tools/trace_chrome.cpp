@@ -0,0 +1,323 @@
+// ============================================
+// ddtrace chrome：导出 Chrome trace-event JSON（chrome://tracing / ui.perfetto.dev 均可打开）
+//
+// 每个线程一条轨道；等待与持有各为一个 "X" 区间；锁在竞争下交接时，
+// 从释放线程的 unlock 画一条流箭头到下一个获得该锁的线程。
+// 事件按时间戳归并后边读边写：内存只与线程数、同时持有的锁数和
+// 正在交接中的锁数有关，与事件总数无关。
+// 轨迹结束时仍未结束的等待和持有（进程被杀时卡住的线程）输出为延伸到
+// 最后一个事件时间戳的区间，并带 "open":true。
+// ============================================
+#include "ddtrace.h"
+#include "trace_reader.h"
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <iterator>
+#include <list>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct ChromeOptions {
+    std::string output;          // 空表示标准输出
+    uint64_t min_wait_ns;        // 短于该值的等待不输出区间，也不画交接箭头
+    bool holds;                  // 是否输出持有区间
+
+    ChromeOptions() : min_wait_ns(1000), holds(true) {}
+};
+
+// 交接中的锁数量上限：超过后丢弃最早的释放记录（对应的箭头不再画出）
+static const size_t kMaxPendingHandoffs = 1 << 16;
+
+class ChromeWriter {
+public:
+    ChromeWriter(FILE* out, const TraceReader& reader, const ChromeOptions& opt)
+        : out_(out), reader_(reader), opt_(opt), first_(true), next_flow_id_(1), events_(0),
+          last_ticks_(0) {}
+
+    void begin() {
+        fprintf(out_, "{\"displayTimeUnit\":\"ns\",\"otherData\":{\"pid\":%u},\"traceEvents\":[\n",
+                reader_.header().pid);
+    }
+
+    void end() {
+        // 按线程号输出，结果与哈希表的遍历顺序无关
+        std::vector<uint64_t> tids;
+        for (const auto& pair : threads_) {
+            tids.push_back(pair.first);
+        }
+        std::sort(tids.begin(), tids.end());
+        for (uint64_t tid : tids) {
+            const ThreadState& t = threads_[tid];
+            if (t.wait_lock != 0 && last_ticks_ >= t.wait_ticks) {
+                span(tid, "wait", t.wait_lock, t.wait_ticks, last_ticks_, t.wait_site, true);
+            }
+            if (opt_.holds) {
+                for (const Held& h : t.held) {
+                    if (last_ticks_ >= h.ticks) {
+                        span(tid, "hold", h.lock_addr, h.ticks, last_ticks_, h.site_id, true);
+                    }
+                }
+            }
+        }
+        fprintf(out_, "\n]}\n");
+    }
+
+    void on_event(uint64_t tid, const TraceEvent& ev) {
+        ThreadState& t = thread(tid);
+        last_ticks_ = std::max(last_ticks_, ev.ticks);
+        switch (ev.kind) {
+            case TRACE_LOCK_BEFORE:
+                t.wait_lock = ev.lock_addr;
+                t.wait_ticks = ev.ticks;
+                t.wait_site = ev.site_id;
+                break;
+
+            case TRACE_LOCK_AFTER: {
+                uint64_t wait_ns = 0;
+                if (t.wait_lock == ev.lock_addr && ev.ticks >= t.wait_ticks) {
+                    wait_ns = reader_.ticks_to_ns(ev.ticks - t.wait_ticks);
+                    if (wait_ns >= opt_.min_wait_ns) {
+                        span(tid, "wait", ev.lock_addr, t.wait_ticks, ev.ticks, t.wait_site);
+                    }
+                }
+                t.wait_lock = 0;
+
+                // 竞争交接：上一个释放者 → 本线程
+                auto handoff = handoffs_.find(ev.lock_addr);
+                if (handoff != handoffs_.end()) {
+                    if (wait_ns >= opt_.min_wait_ns && handoff->second.tid != tid) {
+                        flow(handoff->second, tid, ev.ticks, ev.lock_addr);
+                    }
+                    handoff_order_.erase(handoff->second.order);
+                    handoffs_.erase(handoff);
+                }
+                Held h = {ev.lock_addr, ev.ticks, ev.site_id};
+                t.held.push_back(h);
+                break;
+            }
+
+            case TRACE_TRYLOCK_FAIL:
+                if (t.wait_lock == ev.lock_addr) {
+                    t.wait_lock = 0;
+                }
+                separator();
+                fprintf(out_, "{\"name\":\"trylock failed\",\"ph\":\"i\",\"s\":\"t\",\"pid\":%u,\"tid\":%llu,"
+                              "\"ts\":%.3f,\"args\":{\"lock\":\"0x%llx\"}}",
+                        reader_.header().pid, static_cast<unsigned long long>(tid), ts_us(ev.ticks),
+                        static_cast<unsigned long long>(ev.lock_addr));
+                break;
+
+            case TRACE_UNLOCK: {
+                size_t i = t.held.size();
+                while (i > 0 && t.held[i - 1].lock_addr != ev.lock_addr) {
+                    i--;
+                }
+                if (i > 0) {
+                    const Held& h = t.held[i - 1];
+                    if (opt_.holds) {
+                        span(tid, "hold", h.lock_addr, h.ticks, ev.ticks, h.site_id);
+                    }
+                    t.held.erase(t.held.begin() + static_cast<long>(i - 1));
+                }
+                auto pending = handoffs_.find(ev.lock_addr);
+                if (pending != handoffs_.end()) {
+                    // 同一把锁再次释放：更新记录并移到最新
+                    pending->second.tid = tid;
+                    pending->second.ticks = ev.ticks;
+                    handoff_order_.splice(handoff_order_.end(), handoff_order_, pending->second.order);
+                    break;
+                }
+                if (handoffs_.size() >= kMaxPendingHandoffs) {
+                    handoffs_.erase(handoff_order_.front());
+                    handoff_order_.pop_front();
+                }
+                handoff_order_.push_back(ev.lock_addr);
+                Release r = {tid, ev.ticks, std::prev(handoff_order_.end())};
+                handoffs_[ev.lock_addr] = r;
+                break;
+            }
+
+            default:
+                break;
+        }
+    }
+
+    uint64_t events() const { return events_; }
+
+private:
+    struct Held {
+        uint64_t lock_addr;
+        uint64_t ticks;
+        uint32_t site_id;
+    };
+
+    struct ThreadState {
+        uint64_t wait_lock;
+        uint64_t wait_ticks;
+        uint32_t wait_site;
+        std::vector<Held> held;
+
+        ThreadState() : wait_lock(0), wait_ticks(0), wait_site(0) {}
+    };
+
+    struct Release {
+        uint64_t tid;
+        uint64_t ticks;
+        std::list<uint64_t>::iterator order;  // 在 handoff_order_ 中的位置
+    };
+
+    ThreadState& thread(uint64_t tid) {
+        auto it = threads_.find(tid);
+        if (it != threads_.end()) {
+            return it->second;
+        }
+        // 第一次出现的线程：输出轨道名
+        separator();
+        if (TraceRingView::is_unknown_tid(tid)) {
+            fprintf(out_, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%u,\"tid\":%llu,"
+                          "\"args\":{\"name\":\"ring %u (earlier thread)\"}}",
+                    reader_.header().pid, static_cast<unsigned long long>(tid),
+                    static_cast<unsigned>(tid & 0xffffffffu));
+        } else {
+            fprintf(out_, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%u,\"tid\":%llu,"
+                          "\"args\":{\"name\":\"thread %llu\"}}",
+                    reader_.header().pid, static_cast<unsigned long long>(tid),
+                    static_cast<unsigned long long>(tid));
+        }
+        return threads_[tid];
+    }
+
+    double ts_us(uint64_t ticks) const {
+        return static_cast<double>(reader_.to_ns(ticks)) / 1000.0;
+    }
+
+    void separator() {
+        if (!first_) {
+            fputs(",\n", out_);
+        }
+        first_ = false;
+        events_++;
+    }
+
+    // open：轨迹结束时区间仍未结束，end 是最后一个事件的时间戳
+    void span(uint64_t tid, const char* kind, uint64_t lock_addr, uint64_t begin, uint64_t end,
+              uint32_t site_id, bool open = false) {
+        separator();
+        double ts = ts_us(begin);
+        double dur = static_cast<double>(reader_.ticks_to_ns(end - begin)) / 1000.0;
+        fprintf(out_, "{\"name\":\"%s 0x%llx\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":%u,\"tid\":%llu,"
+                      "\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"lock\":\"0x%llx\",\"site\":\"",
+                kind, static_cast<unsigned long long>(lock_addr), kind, reader_.header().pid,
+                static_cast<unsigned long long>(tid), ts, dur, static_cast<unsigned long long>(lock_addr));
+        write_escaped(reader_.site(site_id));
+        fputs(open ? "\",\"open\":true}}" : "\"}}", out_);
+    }
+
+    void flow(const Release& from, uint64_t to_tid, uint64_t to_ticks, uint64_t lock_addr) {
+        uint64_t id = next_flow_id_++;
+        separator();
+        fprintf(out_, "{\"name\":\"handoff 0x%llx\",\"cat\":\"handoff\",\"ph\":\"s\",\"id\":%llu,"
+                      "\"pid\":%u,\"tid\":%llu,\"ts\":%.3f}",
+                static_cast<unsigned long long>(lock_addr), static_cast<unsigned long long>(id),
+                reader_.header().pid, static_cast<unsigned long long>(from.tid), ts_us(from.ticks));
+        separator();
+        fprintf(out_, "{\"name\":\"handoff 0x%llx\",\"cat\":\"handoff\",\"ph\":\"f\",\"bp\":\"e\",\"id\":%llu,"
+                      "\"pid\":%u,\"tid\":%llu,\"ts\":%.3f}",
+                static_cast<unsigned long long>(lock_addr), static_cast<unsigned long long>(id),
+                reader_.header().pid, static_cast<unsigned long long>(to_tid), ts_us(to_ticks));
+    }
+
+    void write_escaped(const char* s) {
+        for (; *s; s++) {
+            unsigned char c = static_cast<unsigned char>(*s);
+            if (c == '"' || c == '\\') {
+                fputc('\\', out_);
+                fputc(c, out_);
+            } else if (c < 0x20) {
+                fprintf(out_, "\\u%04x", c);
+            } else {
+                fputc(c, out_);
+            }
+        }
+    }
+
+    FILE* out_;
+    const TraceReader& reader_;
+    const ChromeOptions& opt_;
+    bool first_;
+    uint64_t next_flow_id_;
+    uint64_t events_;
+    uint64_t last_ticks_;                              // 已归并事件的最大时间戳
+    std::unordered_map<uint64_t, ThreadState> threads_;
+    std::unordered_map<uint64_t, Release> handoffs_;   // 锁 → 最近一次释放（等待下一个获得者）
+    std::list<uint64_t> handoff_order_;                // 交接中的锁，按释放先后排列（最早的在前）
+};
+
+static void chrome_usage() {
+    fprintf(stderr,
+            "usage: ddtrace chrome [options] <trace-file>\n"
+            "  -o, --output FILE    write JSON to FILE (default: stdout)\n"
+            "  --min-wait-ns N      skip waits shorter than N ns (default 1000)\n"
+            "  --no-holds           do not emit hold spans\n");
+}
+
+int run_chrome(int argc, char* argv[]) {
+    ChromeOptions opt;
+    static const struct option long_options[] = {
+        {"output", required_argument, nullptr, 'o'},
+        {"min-wait-ns", required_argument, nullptr, 'w'},
+        {"no-holds", no_argument, nullptr, 'n'},
+        {"help", no_argument, nullptr, 'h'},
+        {nullptr, 0, nullptr, 0}
+    };
+    int c;
+    while ((c = getopt_long(argc, argv, "o:h", long_options, nullptr)) != -1) {
+        switch (c) {
+            case 'o': opt.output = optarg; break;
+            case 'w': opt.min_wait_ns = strtoull(optarg, nullptr, 10); break;
+            case 'n': opt.holds = false; break;
+            default: chrome_usage(); return c == 'h' ? 0 : 2;
+        }
+    }
+    if (optind + 1 != argc) {
+        chrome_usage();
+        return 2;
+    }
+
+    TraceReader reader;
+    if (!reader.open(argv[optind])) {
+        fprintf(stderr, "ddtrace: %s\n", reader.error().c_str());
+        return 1;
+    }
+    FILE* out = opt.output.empty() ? stdout : fopen(opt.output.c_str(), "w");
+    if (!out) {
+        perror(opt.output.c_str());
+        return 1;
+    }
+    static char buffer[1 << 20];
+    setvbuf(out, buffer, _IOFBF, sizeof(buffer));
+
+    ChromeWriter writer(out, reader, opt);
+    writer.begin();
+    TraceMerger merger(reader);
+    const TraceEvent* ev;
+    uint64_t tid;
+    uint32_t ring;
+    while (merger.next(ev, tid, ring)) {
+        writer.on_event(tid, *ev);
+    }
+    writer.end();
+
+    if (out != stdout) {
+        fclose(out);
+        fprintf(stderr, "ddtrace: wrote %llu trace events to %s\n",
+                static_cast<unsigned long long>(writer.events()), opt.output.c_str());
+    } else {
+        fflush(out);
+    }
+    return 0;
+}
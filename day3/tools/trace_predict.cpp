@@ -0,0 +1,638 @@
+// ============================================
+// ddtrace predict：基于追踪的死锁预测（GoodLock）
+//
+// 即使本次运行没有真正死锁，只要不同线程以相反顺序获取过同一组锁，
+// 换一种调度就可能死锁。做法：
+// 1. 锁序图：线程 t 持有锁集 G 时获取锁 m，则对 G 中每把锁 l 加边 l → m，
+//    边上标注 (线程 t, 持有锁集 G, 获取位置)。每个环（线程）独立构图，并行后合并。
+// 2. 在锁序图上枚举长度 2..max_length 的环，对每个环寻找一组可同时成立的边标注：
+//    - 各边来自不同线程（同一线程内的环不可能死锁）；
+//    - 各边的持有锁集两两不相交（有公共"守护锁"时这些获取互斥，不可能交错）；
+//    - 各边两两没有 happens-before 关系（见下）。
+//    找得到即报告为潜在死锁。
+//
+// happens-before 过滤：线程创建 / join、条件变量 signal → wait、屏障在线程之间建立
+// 先后关系（追踪中的 TRACE_SYNC_RELEASE / TRACE_SYNC_ACQUIRE）。例如主线程初始化时
+// 按 B→A 加锁、之后才创建按 A→B 加锁的工作线程，两段获取不可能交错，不应报告。
+// 按时间顺序回放同步事件维护每线程的向量时钟：
+//    release(o)：L(o) ⊔= C(t)；C(t)[t]++
+//    acquire(o)：C(t) ⊔= L(o)；C(t)[t]++
+// 线程 t 两次同步事件之间的锁获取属于同一个 epoch（= C(t)[t]）。事件 a（线程 ta，epoch ea）
+// happens-before 事件 b 当且仅当 b 所在 epoch 的时钟满足 C[ta] >= ea。
+// 时钟是稀疏的（只存非零分量），按 epoch 增量编码并定期存关键帧，数百线程时内存仍有界。
+// ============================================
+#include "ddtrace.h"
+#include "trace_reader.h"
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <queue>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct PredictOptions {
+    unsigned jobs;
+    size_t max_length;           // 环的最大长度（锁数）
+    size_t max_labels;           // 每条锁对边最多保留的不同标注数
+    size_t max_reports;
+    bool happens_before;         // 是否用同步事件排除有先后关系的环
+
+    PredictOptions()
+        : jobs(default_jobs()), max_length(4), max_labels(32), max_reports(100), happens_before(true) {}
+};
+
+// 边标注：哪个线程、持有哪些锁时、在哪里获取
+struct EdgeLabel {
+    uint64_t tid;
+    std::vector<uint64_t> guards;   // 获取 to 时持有的锁集（已排序，含 from）
+    uint32_t from_site;             // from 的获取位置
+    uint32_t to_site;               // to 的获取位置
+    uint64_t count;                 // 出现次数
+    uint32_t first_epoch;           // 出现过的最早 / 最晚 epoch（见 happens-before）
+    uint32_t last_epoch;
+};
+
+typedef std::pair<uint64_t, uint64_t> LockPair;   // (from, to)
+
+struct LockPairHash {
+    size_t operator()(const LockPair& p) const {
+        return std::hash<uint64_t>()(p.first * 0x9e3779b97f4a7c15ull ^ p.second);
+    }
+};
+
+typedef std::unordered_map<LockPair, std::vector<EdgeLabel>, LockPairHash> LockOrderGraph;
+
+static EdgeLabel* find_label(std::vector<EdgeLabel>& labels, uint64_t tid, const std::vector<uint64_t>& guards,
+                             uint32_t from_site, uint32_t to_site) {
+    for (size_t i = 0; i < labels.size(); i++) {
+        EdgeLabel& l = labels[i];
+        if (l.tid == tid && l.from_site == from_site && l.to_site == to_site && l.guards == guards) {
+            return &l;
+        }
+    }
+    return nullptr;
+}
+
+static void add_label(std::vector<EdgeLabel>& labels, const EdgeLabel& label, size_t max_labels) {
+    EdgeLabel* existing = find_label(labels, label.tid, label.guards, label.from_site, label.to_site);
+    if (existing) {
+        existing->count += label.count;
+        existing->first_epoch = std::min(existing->first_epoch, label.first_epoch);
+        existing->last_epoch = std::max(existing->last_epoch, label.last_epoch);
+    } else if (labels.size() < max_labels) {
+        labels.push_back(label);
+    }
+}
+
+// ============================================
+// happens-before：稀疏向量时钟
+// ============================================
+typedef std::pair<uint32_t, uint32_t> ClockEntry;   // (线程下标, 计数)
+
+// 只保存非零分量，按线程下标排序
+class SparseClock {
+public:
+    uint32_t get(uint32_t thread) const {
+        auto it = std::lower_bound(entries_.begin(), entries_.end(), ClockEntry(thread, 0));
+        return it != entries_.end() && it->first == thread ? it->second : 0;
+    }
+
+    void set(uint32_t thread, uint32_t value) {
+        auto it = std::lower_bound(entries_.begin(), entries_.end(), ClockEntry(thread, 0));
+        if (it != entries_.end() && it->first == thread) {
+            it->second = value;
+        } else {
+            entries_.insert(it, ClockEntry(thread, value));
+        }
+    }
+
+    // 逐分量取最大；changed 非空时追加发生变化的分量
+    void join(const SparseClock& other, std::vector<ClockEntry>* changed) {
+        std::vector<ClockEntry> merged;
+        merged.reserve(entries_.size() + other.entries_.size());
+        size_t i = 0, j = 0;
+        while (i < entries_.size() || j < other.entries_.size()) {
+            if (j == other.entries_.size() ||
+                (i < entries_.size() && entries_[i].first < other.entries_[j].first)) {
+                merged.push_back(entries_[i++]);
+            } else if (i == entries_.size() || other.entries_[j].first < entries_[i].first) {
+                merged.push_back(other.entries_[j]);
+                if (changed) changed->push_back(other.entries_[j]);
+                j++;
+            } else {
+                if (other.entries_[j].second > entries_[i].second) {
+                    merged.push_back(other.entries_[j]);
+                    if (changed) changed->push_back(other.entries_[j]);
+                } else {
+                    merged.push_back(entries_[i]);
+                }
+                i++;
+                j++;
+            }
+        }
+        entries_.swap(merged);
+    }
+
+    size_t size() const { return entries_.size(); }
+
+private:
+    std::vector<ClockEntry> entries_;
+};
+
+// 一个线程各 epoch 的向量时钟。每个 epoch 只存与上一个 epoch 相比变化的分量，
+// 每 kKeyframeInterval 个 epoch 存一份完整时钟，查询最多回扫 kKeyframeInterval 个增量
+class ClockHistory {
+public:
+    static const uint32_t kKeyframeInterval = 64;
+
+    ClockHistory() : stored_(0) {}
+
+    // 追加下一个 epoch 的时钟；changed 为相对上一个 epoch 变化的分量
+    void append(const SparseClock& clock, const std::vector<ClockEntry>& changed) {
+        uint32_t index = static_cast<uint32_t>(delta_begin_.size());
+        delta_begin_.push_back(static_cast<uint32_t>(deltas_.size()));
+        if (index % kKeyframeInterval == 0) {
+            keyframes_.push_back(clock);
+            stored_ += clock.size();
+        } else {
+            deltas_.insert(deltas_.end(), changed.begin(), changed.end());
+            stored_ += changed.size();
+        }
+    }
+
+    // epoch（从 1 开始）时刻时钟的 thread 分量
+    uint32_t component(uint32_t epoch, uint32_t thread) const {
+        if (epoch == 0 || delta_begin_.empty()) {
+            return 0;
+        }
+        uint32_t index = std::min<uint32_t>(epoch, static_cast<uint32_t>(delta_begin_.size())) - 1;
+        uint32_t keyframe = index / kKeyframeInterval;
+        for (uint32_t i = index; i > keyframe * kKeyframeInterval; i--) {
+            uint32_t end = i + 1 < delta_begin_.size() ? delta_begin_[i + 1] : static_cast<uint32_t>(deltas_.size());
+            for (uint32_t d = end; d > delta_begin_[i]; d--) {
+                if (deltas_[d - 1].first == thread) {
+                    return deltas_[d - 1].second;
+                }
+            }
+        }
+        return keyframes_[keyframe].get(thread);
+    }
+
+    size_t epochs() const { return delta_begin_.size(); }
+    size_t stored_entries() const { return stored_; }
+
+private:
+    std::vector<uint32_t> delta_begin_;   // 第 i 个 epoch 的增量在 deltas_ 中的起点（关键帧 epoch 无增量）
+    std::vector<ClockEntry> deltas_;
+    std::vector<SparseClock> keyframes_;
+    size_t stored_;
+};
+
+struct SyncEvent {
+    uint64_t ticks;
+    uint64_t tid;
+    uint64_t object;
+    uint16_t kind;            // TRACE_SYNC_RELEASE / TRACE_SYNC_ACQUIRE
+};
+
+class HappensBefore {
+public:
+    HappensBefore() : events_(0) {}
+
+    // rings[r] 为第 r 个环按顺序出现的同步事件；按时间归并回放（同一线程保持环内顺序）
+    void build(const std::vector<std::vector<SyncEvent> >& rings) {
+        typedef std::pair<uint64_t, size_t> Head;   // (ticks, 环下标)
+        std::priority_queue<Head, std::vector<Head>, std::greater<Head> > heap;
+        std::vector<size_t> pos(rings.size(), 0);
+        for (size_t r = 0; r < rings.size(); r++) {
+            if (!rings[r].empty()) {
+                heap.push(Head(rings[r][0].ticks, r));
+            }
+        }
+        std::vector<ClockEntry> changed;
+        while (!heap.empty()) {
+            size_t r = heap.top().second;
+            heap.pop();
+            const SyncEvent& ev = rings[r][pos[r]++];
+            if (pos[r] < rings[r].size()) {
+                heap.push(Head(rings[r][pos[r]].ticks, r));
+            }
+            uint32_t t = index_of(ev.tid);
+            SparseClock& clock = clocks_[t];
+            changed.clear();
+            if (ev.kind == TRACE_SYNC_RELEASE) {
+                objects_[ev.object].join(clock, nullptr);
+            } else {
+                auto obj = objects_.find(ev.object);
+                if (obj != objects_.end()) {
+                    clock.join(obj->second, &changed);
+                }
+            }
+            uint32_t next = clock.get(t) + 1;
+            clock.set(t, next);
+            changed.push_back(ClockEntry(t, next));
+            history_[t].append(clock, changed);
+            events_++;
+        }
+    }
+
+    // 线程 a_tid 在 a_epoch 的事件是否 happens-before 线程 b_tid 在 b_epoch 的事件
+    bool ordered(uint64_t a_tid, uint32_t a_epoch, uint64_t b_tid, uint32_t b_epoch) const {
+        if (a_tid == b_tid) {
+            return a_epoch <= b_epoch;
+        }
+        auto a = index_.find(a_tid);
+        auto b = index_.find(b_tid);
+        if (a == index_.end() || b == index_.end()) {
+            return false;   // 没有同步事件的线程与其他线程没有先后关系
+        }
+        return history_[b->second].component(b_epoch, a->second) >= a_epoch;
+    }
+
+    uint64_t events() const { return events_; }
+    size_t threads() const { return history_.size(); }
+
+    size_t epochs() const {
+        size_t n = 0;
+        for (size_t i = 0; i < history_.size(); i++) n += history_[i].epochs();
+        return n;
+    }
+
+    size_t stored_entries() const {
+        size_t n = 0;
+        for (size_t i = 0; i < history_.size(); i++) n += history_[i].stored_entries();
+        return n;
+    }
+
+private:
+    // 首次出现的线程：初始时钟 {t: 1}，作为 epoch 1
+    uint32_t index_of(uint64_t tid) {
+        auto it = index_.find(tid);
+        if (it != index_.end()) {
+            return it->second;
+        }
+        uint32_t t = static_cast<uint32_t>(history_.size());
+        index_[tid] = t;
+        clocks_.push_back(SparseClock());
+        clocks_.back().set(t, 1);
+        history_.push_back(ClockHistory());
+        history_.back().append(clocks_.back(), std::vector<ClockEntry>());
+        return t;
+    }
+
+    std::unordered_map<uint64_t, uint32_t> index_;      // tid → 线程下标
+    std::vector<SparseClock> clocks_;                   // 各线程当前时钟
+    std::vector<ClockHistory> history_;
+    std::unordered_map<uint64_t, SparseClock> objects_; // 同步对象的时钟
+    uint64_t events_;
+};
+
+// ============================================
+// 第 1 步：单环构图
+// ============================================
+struct RingGraph {
+    LockOrderGraph edges;
+    std::vector<SyncEvent> sync;
+    uint64_t acquisitions;
+
+    RingGraph() : acquisitions(0) {}
+};
+
+static void build_ring_graph(const TraceReader& reader, uint32_t ring, const PredictOptions& opt, RingGraph& out) {
+    TraceRingView view = reader.ring(ring);
+    if (view.size() == 0) {
+        return;
+    }
+    TraceRingCursor cursor(view);
+
+    struct Held {
+        uint64_t lock_addr;
+        uint32_t site_id;
+    };
+    uint64_t current_tid = 0;
+    uint32_t epoch = 1;               // 与 HappensBefore 中的编号一致：每个同步事件后加一
+    std::vector<Held> held;
+    std::vector<uint64_t> guards;
+
+    const TraceEvent* ev;
+    uint64_t tid;
+    while (cursor.next(ev, tid)) {
+        if (tid != current_tid) {
+            current_tid = tid;
+            epoch = 1;
+            held.clear();
+        }
+        if (ev->kind == TRACE_SYNC_RELEASE || ev->kind == TRACE_SYNC_ACQUIRE) {
+            if (opt.happens_before) {
+                SyncEvent s = {ev->ticks, tid, ev->lock_addr, ev->kind};
+                out.sync.push_back(s);
+                epoch++;
+            }
+        } else if (ev->kind == TRACE_LOCK_AFTER) {
+            out.acquisitions++;
+            if (!held.empty()) {
+                guards.clear();
+                for (size_t i = 0; i < held.size(); i++) {
+                    guards.push_back(held[i].lock_addr);
+                }
+                std::sort(guards.begin(), guards.end());
+                for (size_t i = 0; i < held.size(); i++) {
+                    if (held[i].lock_addr == ev->lock_addr) {
+                        continue; // 递归获取同一把锁，不构成顺序
+                    }
+                    std::vector<EdgeLabel>& labels = out.edges[LockPair(held[i].lock_addr, ev->lock_addr)];
+                    EdgeLabel* existing = find_label(labels, tid, guards, held[i].site_id, ev->site_id);
+                    if (existing) {
+                        existing->count++;
+                        existing->last_epoch = epoch;
+                    } else if (labels.size() < opt.max_labels) {
+                        EdgeLabel label;
+                        label.tid = tid;
+                        label.guards = guards;
+                        label.from_site = held[i].site_id;
+                        label.to_site = ev->site_id;
+                        label.count = 1;
+                        label.first_epoch = epoch;
+                        label.last_epoch = epoch;
+                        labels.push_back(label);
+                    }
+                }
+            }
+            Held h = {ev->lock_addr, ev->site_id};
+            held.push_back(h);
+        } else if (ev->kind == TRACE_UNLOCK) {
+            for (size_t i = held.size(); i > 0; i--) {
+                if (held[i - 1].lock_addr == ev->lock_addr) {
+                    held.erase(held.begin() + static_cast<long>(i - 1));
+                    break;
+                }
+            }
+        }
+    }
+}
+
+// ============================================
+// 第 2 步：找环并检查标注
+// ============================================
+struct PotentialDeadlock {
+    std::vector<uint64_t> locks;                  // l0 → l1 → ... → l0
+    std::vector<const EdgeLabel*> labels;         // labels[i] 对应边 locks[i] → locks[i+1]
+};
+
+struct PredictResult {
+    uint64_t lock_cycles;        // 锁序图中的环
+    uint64_t single_thread;      // 被过滤：只有同一线程的标注
+    uint64_t guarded;            // 被过滤：有公共守护锁
+    uint64_t hb_ordered;         // 被过滤：各边之间有 happens-before 关系
+    std::vector<PotentialDeadlock> deadlocks;
+
+    PredictResult() : lock_cycles(0), single_thread(0), guarded(0), hb_ordered(0) {}
+};
+
+static bool disjoint(const std::vector<uint64_t>& a, const std::vector<uint64_t>& b) {
+    size_t i = 0, j = 0;
+    while (i < a.size() && j < b.size()) {
+        if (a[i] == b[j]) return false;
+        if (a[i] < b[j]) i++; else j++;
+    }
+    return true;
+}
+
+class CycleChecker {
+public:
+    CycleChecker(const LockOrderGraph& graph, const HappensBefore& hb, const PredictOptions& opt,
+                 PredictResult& result)
+        : graph_(graph), hb_(hb), opt_(opt), result_(result) {
+        for (const auto& pair : graph) {
+            adjacency_[pair.first.first].push_back(pair.first.second);
+        }
+        for (auto& pair : adjacency_) {
+            std::sort(pair.second.begin(), pair.second.end());
+        }
+    }
+
+    void run() {
+        // 规范化：环从其中最小的锁出发，只经过更大的锁，每个环恰好枚举一次
+        for (const auto& pair : adjacency_) {
+            path_.assign(1, pair.first);
+            dfs(pair.first);
+        }
+    }
+
+private:
+    void dfs(uint64_t current) {
+        auto adj = adjacency_.find(current);
+        if (adj == adjacency_.end()) {
+            return;
+        }
+        uint64_t start = path_[0];
+        for (size_t i = 0; i < adj->second.size(); i++) {
+            uint64_t next = adj->second[i];
+            if (next == start && path_.size() >= 2) {
+                check_cycle();
+                continue;
+            }
+            if (next <= start || path_.size() >= opt_.max_length ||
+                std::find(path_.begin(), path_.end(), next) != path_.end()) {
+                continue;
+            }
+            path_.push_back(next);
+            dfs(next);
+            path_.pop_back();
+        }
+    }
+
+    void check_cycle() {
+        result_.lock_cycles++;
+        chosen_.clear();
+        if (choose(0, true, opt_.happens_before)) {
+            if (result_.deadlocks.size() < opt_.max_reports) {
+                PotentialDeadlock d;
+                d.locks = path_;
+                d.labels = chosen_;
+                result_.deadlocks.push_back(d);
+            }
+            return;
+        }
+        // 分类：依次放宽 happens-before、守护锁条件，看是哪一条排除了它
+        chosen_.clear();
+        if (opt_.happens_before && choose(0, true, false)) {
+            result_.hb_ordered++;
+            return;
+        }
+        chosen_.clear();
+        if (choose(0, false, false)) {
+            result_.guarded++;
+        } else {
+            result_.single_thread++;
+        }
+    }
+
+    // 回溯：为第 i 条边选一个与已选标注兼容的标注
+    bool choose(size_t i, bool check_guards, bool check_hb) {
+        if (i == path_.size()) {
+            return true;
+        }
+        LockPair edge(path_[i], path_[(i + 1) % path_.size()]);
+        const std::vector<EdgeLabel>& labels = graph_.find(edge)->second;
+        for (size_t l = 0; l < labels.size(); l++) {
+            const EdgeLabel& label = labels[l];
+            bool compatible = true;
+            for (size_t c = 0; c < chosen_.size() && compatible; c++) {
+                compatible = chosen_[c]->tid != label.tid &&
+                             (!check_guards || disjoint(chosen_[c]->guards, label.guards)) &&
+                             (!check_hb || concurrent(*chosen_[c], label));
+            }
+            if (!compatible) {
+                continue;
+            }
+            chosen_.push_back(&label);
+            if (choose(i + 1, check_guards, check_hb)) {
+                return true;
+            }
+            chosen_.pop_back();
+        }
+        return false;
+    }
+
+    // 两条标注的某些出现可能交错：a 最晚的出现不先于 b 最早的出现，反之亦然
+    bool concurrent(const EdgeLabel& a, const EdgeLabel& b) const {
+        return !hb_.ordered(a.tid, a.last_epoch, b.tid, b.first_epoch) &&
+               !hb_.ordered(b.tid, b.last_epoch, a.tid, a.first_epoch);
+    }
+
+    const LockOrderGraph& graph_;
+    const HappensBefore& hb_;
+    const PredictOptions& opt_;
+    PredictResult& result_;
+    std::unordered_map<uint64_t, std::vector<uint64_t> > adjacency_;
+    std::vector<uint64_t> path_;
+    std::vector<const EdgeLabel*> chosen_;
+};
+
+// ============================================
+// 输出
+// ============================================
+static std::string format_tid(uint64_t tid) {
+    char buf[48];
+    if (TraceRingView::is_unknown_tid(tid)) {
+        snprintf(buf, sizeof(buf), "ring%u(earlier thread)", static_cast<unsigned>(tid & 0xffffffffu));
+    } else {
+        snprintf(buf, sizeof(buf), "%llu", static_cast<unsigned long long>(tid));
+    }
+    return buf;
+}
+
+static void print_deadlock(const TraceReader& reader, size_t index, const PotentialDeadlock& d) {
+    printf("Potential deadlock #%zu: %zu locks\n", index, d.locks.size());
+    for (size_t i = 0; i < d.locks.size(); i++) {
+        const EdgeLabel& label = *d.labels[i];
+        uint64_t from = d.locks[i];
+        uint64_t to = d.locks[(i + 1) % d.locks.size()];
+        printf("  thread %s acquires 0x%llx at %s\n", format_tid(label.tid).c_str(),
+               static_cast<unsigned long long>(to), reader.site(label.to_site));
+        printf("      while holding 0x%llx (acquired at %s)", static_cast<unsigned long long>(from),
+               reader.site(label.from_site));
+        if (label.guards.size() > 1) {
+            printf(" and %zu other lock(s)", label.guards.size() - 1);
+        }
+        printf(", seen %llu time(s)\n", static_cast<unsigned long long>(label.count));
+    }
+}
+
+static void predict_usage() {
+    fprintf(stderr,
+            "usage: ddtrace predict [options] <trace-file>...\n"
+            "  --max-length N   longest lock cycle to search (default 4)\n"
+            "  --max-labels N   distinct (thread, lockset, site) labels kept per lock pair (default 32)\n"
+            "  --max-reports N  potential deadlocks to print per file (default 100)\n"
+            "  --no-hb          ignore thread create/join, condvar, barrier and semaphore ordering\n"
+            "  --jobs N         graph-building threads (default: hardware concurrency)\n");
+}
+
+int run_predict(int argc, char* argv[]) {
+    PredictOptions opt;
+    static const struct option long_options[] = {
+        {"max-length", required_argument, nullptr, 'l'},
+        {"max-labels", required_argument, nullptr, 'b'},
+        {"max-reports", required_argument, nullptr, 'r'},
+        {"jobs", required_argument, nullptr, 'j'},
+        {"no-hb", no_argument, nullptr, 'n'},
+        {"help", no_argument, nullptr, 'h'},
+        {nullptr, 0, nullptr, 0}
+    };
+    int c;
+    while ((c = getopt_long(argc, argv, "j:h", long_options, nullptr)) != -1) {
+        switch (c) {
+            case 'l': opt.max_length = static_cast<size_t>(atoi(optarg)); break;
+            case 'b': opt.max_labels = static_cast<size_t>(atoi(optarg)); break;
+            case 'r': opt.max_reports = static_cast<size_t>(atoi(optarg)); break;
+            case 'j': opt.jobs = static_cast<unsigned>(atoi(optarg)); break;
+            case 'n': opt.happens_before = false; break;
+            default: predict_usage(); return c == 'h' ? 0 : 2;
+        }
+    }
+    if (optind >= argc || opt.max_length < 2) {
+        predict_usage();
+        return 2;
+    }
+
+    int status = 0;
+    for (int f = optind; f < argc; f++) {
+        TraceReader reader;
+        if (!reader.open(argv[f])) {
+            fprintf(stderr, "ddtrace: %s\n", reader.error().c_str());
+            status = 1;
+            continue;
+        }
+
+        // 各环并行构图，再合并
+        std::vector<RingGraph> graphs(reader.ring_count());
+        parallel_for(graphs.size(), opt.jobs, [&](size_t r) {
+            build_ring_graph(reader, static_cast<uint32_t>(r), opt, graphs[r]);
+        });
+        LockOrderGraph merged;
+        uint64_t acquisitions = 0;
+        std::vector<std::vector<SyncEvent> > sync(graphs.size());
+        for (size_t r = 0; r < graphs.size(); r++) {
+            acquisitions += graphs[r].acquisitions;
+            sync[r].swap(graphs[r].sync);
+            for (auto& pair : graphs[r].edges) {
+                std::vector<EdgeLabel>& labels = merged[pair.first];
+                for (size_t l = 0; l < pair.second.size(); l++) {
+                    add_label(labels, pair.second[l], opt.max_labels);
+                }
+            }
+            graphs[r].edges.clear();
+        }
+
+        HappensBefore hb;
+        hb.build(sync);
+        sync.clear();
+
+        PredictResult result;
+        CycleChecker checker(merged, hb, opt, result);
+        checker.run();
+
+        printf("==== %s (pid %u) ====\n", reader.path().c_str(), reader.header().pid);
+        printf("%llu acquisitions, %zu lock-order edges, %llu lock cycle(s): "
+               "%zu potential deadlock(s), %llu single-thread, %llu guarded, %llu happens-before ordered\n",
+               static_cast<unsigned long long>(acquisitions), merged.size(),
+               static_cast<unsigned long long>(result.lock_cycles), result.deadlocks.size(),
+               static_cast<unsigned long long>(result.single_thread),
+               static_cast<unsigned long long>(result.guarded),
+               static_cast<unsigned long long>(result.hb_ordered));
+        if (hb.events() > 0) {
+            printf("%llu sync events, %zu threads, %zu epochs, %zu vector clock entries stored\n",
+                   static_cast<unsigned long long>(hb.events()), hb.threads(), hb.epochs(),
+                   hb.stored_entries());
+        }
+        for (size_t i = 0; i < result.deadlocks.size(); i++) {
+            print_deadlock(reader, i + 1, result.deadlocks[i]);
+        }
+        printf("\n");
+    }
+    return status;
+}